@@ -0,0 +1,165 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "AhoCorasick.h"
+
+#include <algorithm>
+#include <queue>
+
+
+AhoCorasick::AhoCorasick()
+	:
+	fBuilt(false)
+{
+	fStates.push_back({ {}, 0, 0, -1, 0 });
+	std::fill(fRootTable, fRootTable + 256, 0);
+}
+
+
+// Adds a pattern and returns its index. Adding the same pattern twice returns
+// the index of the first one.
+int32
+AhoCorasick::AddPattern(const char* pattern, int32 length)
+{
+	if (length <= 0)
+		return -1;
+
+	fBuilt = false;
+
+	int32 state = 0;
+	for (int32 i = 0; i < length; i++) {
+		uint8 byte = (uint8)pattern[i];
+		int32 next = _Goto(state, byte);
+		if (next < 0) {
+			next = (int32)fStates.size();
+			fStates.push_back({ {}, 0, fStates[state].depth + 1, -1, 0 });
+
+			std::vector<Edge>& edges = fStates[state].edges;
+			auto position = std::lower_bound(edges.begin(), edges.end(), byte,
+				[](const Edge& edge, uint8 value) { return edge.byte < value; });
+			edges.insert(position, { byte, next });
+		}
+		state = next;
+	}
+
+	if (fStates[state].pattern >= 0)
+		return fStates[state].pattern;
+
+	int32 index = (int32)fPatternLengths.size();
+	fStates[state].pattern = index;
+	fStates[state].patternLength = length;
+	fPatternLengths.push_back(length);
+	return index;
+}
+
+
+// Computes the failure links breadth-first. Each state also inherits the
+// longest pattern that ends in one of its suffixes, so a match lookup during
+// the scan is a single field access.
+void
+AhoCorasick::Build()
+{
+	std::fill(fRootTable, fRootTable + 256, 0);
+
+	std::queue<int32> queue;
+	for (const Edge& edge : fStates[0].edges) {
+		fRootTable[edge.byte] = edge.target;
+		fStates[edge.target].failure = 0;
+		queue.push(edge.target);
+	}
+
+	while (!queue.empty()) {
+		int32 state = queue.front();
+		queue.pop();
+
+		for (const Edge& edge : fStates[state].edges) {
+			int32 failure = fStates[state].failure;
+			while (failure != 0 && _Goto(failure, edge.byte) < 0)
+				failure = fStates[failure].failure;
+
+			int32 target = _Goto(failure, edge.byte);
+			if (target < 0 || target == edge.target)
+				target = 0;
+
+			State& child = fStates[edge.target];
+			child.failure = target;
+			if (child.pattern < 0) {
+				child.pattern = fStates[target].pattern;
+				child.patternLength = fStates[target].patternLength;
+			}
+			queue.push(edge.target);
+		}
+	}
+
+	fBuilt = true;
+}
+
+
+// Finds non-overlapping matches, preferring the leftmost match and, among
+// matches starting at the same offset, the longest one.
+int32
+AhoCorasick::FindAll(const char* text, int32 length, std::vector<PatternMatch>& matches) const
+{
+	matches.clear();
+	if (!fBuilt || fPatternLengths.empty())
+		return 0;
+
+	PatternMatch candidate = { -1, -1, -1 };
+	int32 state = 0;
+	int32 i = 0;
+
+	while (true) {
+		if (i < length) {
+			state = _Step(state, (uint8)text[i++]);
+			const State& current = fStates[state];
+
+			if (current.pattern >= 0) {
+				int32 start = i - current.patternLength;
+				if (candidate.start < 0 || start <= candidate.start)
+					candidate = { start, i, current.pattern };
+			}
+
+			// No later match can start at or before the candidate any more
+			if (candidate.start < 0 || i - current.depth <= candidate.start)
+				continue;
+		} else if (candidate.start < 0) {
+			break;
+		}
+
+		matches.push_back(candidate);
+		i = candidate.end;
+		state = 0;
+		candidate = { -1, -1, -1 };
+	}
+
+	return (int32)matches.size();
+}
+
+
+int32
+AhoCorasick::_Goto(int32 state, uint8 byte) const
+{
+	const std::vector<Edge>& edges = fStates[state].edges;
+	auto position = std::lower_bound(edges.begin(), edges.end(), byte,
+		[](const Edge& edge, uint8 value) { return edge.byte < value; });
+	if (position == edges.end() || position->byte != byte)
+		return -1;
+
+	return position->target;
+}
+
+
+int32
+AhoCorasick::_Step(int32 state, uint8 byte) const
+{
+	while (state != 0) {
+		int32 next = _Goto(state, byte);
+		if (next >= 0)
+			return next;
+		state = fStates[state].failure;
+	}
+
+	return fRootTable[byte];
+}
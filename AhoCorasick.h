@@ -0,0 +1,52 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef AHO_CORASICK_H
+#define AHO_CORASICK_H
+
+#include <SupportDefs.h>
+#include <vector>
+
+struct PatternMatch {
+	int32 start;
+	int32 end;
+	int32 pattern;
+};
+
+// Multi-pattern matcher: all patterns are compiled into one automaton, so a
+// text is scanned once no matter how many patterns there are.
+class AhoCorasick {
+public:
+	AhoCorasick();
+
+	int32 AddPattern(const char* pattern, int32 length);
+	void Build();
+
+	int32 CountPatterns() const { return (int32)fPatternLengths.size(); }
+	int32 FindAll(const char* text, int32 length, std::vector<PatternMatch>& matches) const;
+
+private:
+	struct Edge {
+		uint8 byte;
+		int32 target;
+	};
+
+	struct State {
+		std::vector<Edge> edges; // sorted by byte
+		int32 failure;
+		int32 depth;
+		int32 pattern; // longest pattern ending here, or -1
+		int32 patternLength;
+	};
+
+	int32 _Goto(int32 state, uint8 byte) const;
+	int32 _Step(int32 state, uint8 byte) const;
+
+	std::vector<State> fStates;
+	std::vector<int32> fPatternLengths;
+	int32 fRootTable[256];
+	bool fBuilt;
+};
+
+#endif // AHO_CORASICK_H
@@ -1,7 +1,15 @@
 #include "App.h"
 #include "Constants.h"
+#include "NGramIndex.h"
+#include "TextFile.h"
 #include <Catalog.h>
+#include <DataIO.h>
+#include <File.h>
 #include <Path.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
 
 #include <AboutWindow.h>
 
@@ -51,9 +59,79 @@ App::AboutRequested()
 }
 
 
+// Counts the n-grams of the given files, or standard input, and writes them
+// as TSV to standard output. The files are streamed and the counter is
+// bounded, so the input may be larger than memory. Compressed input is
+// decompressed on the fly.
+static int
+_CountNGrams(int argc, char** argv)
+{
+	NGramKind kind = NGRAM_WORDS;
+	int32 size = 2;
+	size_t top = SIZE_MAX;
+	size_t capacity = 100000;
+
+	int i = 2;
+	for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+		if (strcmp(argv[i], "--chars") == 0)
+			kind = NGRAM_CHARACTERS;
+		else if (strcmp(argv[i], "--words") == 0)
+			kind = NGRAM_WORDS;
+		else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+			size = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc)
+			top = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--capacity") == 0 && i + 1 < argc)
+			capacity = strtoul(argv[++i], NULL, 10);
+		else {
+			fprintf(stderr, "Usage: %s --ngrams [--words | --chars] [--size <n>] [--top <n>] "
+				"[--capacity <n>] [<file> ...]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	NGramScanner scanner(kind, size, capacity);
+	if (scanner.InitCheck() != B_OK) {
+		fprintf(stderr, "Could not create the word break iterator\n");
+		return 1;
+	}
+
+	status_t status = B_OK;
+	if (i == argc) {
+		DescriptorIO input(STDIN_FILENO);
+		DecompressingIO decompressed(&input);
+		status = scanner.AddStream(&decompressed);
+	}
+	for (; i < argc && status == B_OK; i++) {
+		BFile file;
+		status = file.SetTo(argv[i], B_READ_ONLY);
+		if (status == B_OK) {
+			DecompressingIO decompressed(&file);
+			status = scanner.AddStream(&decompressed);
+		}
+		if (status != B_OK)
+			fprintf(stderr, "%s: %s\n", argv[i], strerror(status));
+	}
+	if (status != B_OK)
+		return 1;
+
+	DescriptorIO output(STDOUT_FILENO);
+	if (WriteNGramsTSV(scanner.Counter(), &output, top) != B_OK)
+		return 1;
+	if (!scanner.Counter().IsExact()) {
+		fprintf(stderr, "More than %zu different n-grams, counts may be too high by up to "
+			"the error column\n", capacity);
+	}
+	return 0;
+}
+
+
 int
-main(void)
+main(int argc, char** argv)
 {
+	if (argc > 1 && strcmp(argv[1], "--ngrams") == 0)
+		return _CountNGrams(argc, argv);
+
 	App* app = new App();
 	app->Run();
 	delete app;
@@ -0,0 +1,516 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "Compression.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <strings.h>
+#include <lzma.h>
+#include <new>
+#include <zlib.h>
+#include <zstd.h>
+
+static const size_t kBufferSize = 256 * 1024;
+
+// The longest header DetectCompression() looks at
+static const size_t kHeaderLength = 10;
+
+
+// Turns data from one form into the other, a piece at a time
+class StreamCodec {
+public:
+	virtual ~StreamCodec() {}
+
+	virtual status_t InitCheck() const = 0;
+
+	// Moves input and output past what was consumed and produced, and sets
+	// ended once the end of a stream was reached. Compressing, finish ends the
+	// stream; decompressing, it tells that there is no more input.
+	virtual status_t Run(const uint8*& input, size_t& inputLength, uint8*& output,
+		size_t& outputLength, bool finish, bool& ended) = 0;
+
+	// Starts over for a stream that follows the last one
+	virtual status_t Reset() = 0;
+};
+
+
+class GzipCodec : public StreamCodec {
+public:
+	GzipCodec(bool compress, int32 level)
+		:
+		fCompress(compress)
+	{
+		memset(&fStream, 0, sizeof(fStream));
+		// A window of 15 bits, and 16 more for a gzip rather than a zlib header
+		int result = compress
+			? deflateInit2(&fStream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY)
+			: inflateInit2(&fStream, 15 + 16);
+		fInitStatus = result == Z_OK ? B_OK : B_NO_MEMORY;
+	}
+
+	~GzipCodec()
+	{
+		if (fInitStatus != B_OK)
+			return;
+		if (fCompress)
+			deflateEnd(&fStream);
+		else
+			inflateEnd(&fStream);
+	}
+
+	status_t InitCheck() const { return fInitStatus; }
+
+	status_t Run(const uint8*& input, size_t& inputLength, uint8*& output, size_t& outputLength,
+		bool finish, bool& ended)
+	{
+		uInt availableInput = std::min(inputLength, (size_t)UINT_MAX);
+		uInt availableOutput = std::min(outputLength, (size_t)UINT_MAX);
+		fStream.next_in = (Bytef*)input;
+		fStream.avail_in = availableInput;
+		fStream.next_out = output;
+		fStream.avail_out = availableOutput;
+
+		int result = fCompress ? deflate(&fStream, finish ? Z_FINISH : Z_NO_FLUSH)
+			: inflate(&fStream, Z_NO_FLUSH);
+
+		input += availableInput - fStream.avail_in;
+		inputLength -= availableInput - fStream.avail_in;
+		output += availableOutput - fStream.avail_out;
+		outputLength -= availableOutput - fStream.avail_out;
+		ended = result == Z_STREAM_END;
+
+		// A buffer error only means that no progress was possible
+		if (result == Z_OK || result == Z_STREAM_END || result == Z_BUF_ERROR)
+			return B_OK;
+		return result == Z_MEM_ERROR ? B_NO_MEMORY : B_BAD_DATA;
+	}
+
+	status_t Reset()
+	{
+		int result = fCompress ? deflateReset(&fStream) : inflateReset(&fStream);
+		return result == Z_OK ? B_OK : B_ERROR;
+	}
+
+private:
+	z_stream fStream;
+	bool fCompress;
+	status_t fInitStatus;
+};
+
+
+class ZstdCodec : public StreamCodec {
+public:
+	ZstdCodec(bool compress, int32 level)
+		:
+		fCompressContext(nullptr),
+		fDecompressContext(nullptr)
+	{
+		if (compress) {
+			fCompressContext = ZSTD_createCCtx();
+			if (fCompressContext != nullptr)
+				ZSTD_CCtx_setParameter(fCompressContext, ZSTD_c_compressionLevel, level);
+		} else
+			fDecompressContext = ZSTD_createDCtx();
+	}
+
+	~ZstdCodec()
+	{
+		ZSTD_freeCCtx(fCompressContext);
+		ZSTD_freeDCtx(fDecompressContext);
+	}
+
+	status_t InitCheck() const
+	{
+		return fCompressContext != nullptr || fDecompressContext != nullptr ? B_OK : B_NO_MEMORY;
+	}
+
+	status_t Run(const uint8*& input, size_t& inputLength, uint8*& output, size_t& outputLength,
+		bool finish, bool& ended)
+	{
+		ZSTD_inBuffer in = {input, inputLength, 0};
+		ZSTD_outBuffer out = {output, outputLength, 0};
+		size_t result = fCompressContext != nullptr
+			? ZSTD_compressStream2(fCompressContext, &out, &in,
+				finish ? ZSTD_e_end : ZSTD_e_continue)
+			: ZSTD_decompressStream(fDecompressContext, &out, &in);
+
+		input += in.pos;
+		inputLength -= in.pos;
+		output += out.pos;
+		outputLength -= out.pos;
+		if (ZSTD_isError(result))
+			return B_BAD_DATA;
+
+		// Nothing left to flush, or a complete frame
+		ended = result == 0 && (finish || fDecompressContext != nullptr);
+		return B_OK;
+	}
+
+	status_t Reset()
+	{
+		// The next frame starts by itself
+		return B_OK;
+	}
+
+private:
+	ZSTD_CCtx* fCompressContext;
+	ZSTD_DCtx* fDecompressContext;
+};
+
+
+class XzCodec : public StreamCodec {
+public:
+	XzCodec(bool compress, int32 level)
+	{
+		lzma_stream stream = LZMA_STREAM_INIT;
+		fStream = stream;
+
+		fInitStatus = compress ? _Result(lzma_easy_encoder(&fStream, level, LZMA_CHECK_CRC64))
+			: Reset();
+	}
+
+	~XzCodec()
+	{
+		lzma_end(&fStream);
+	}
+
+	status_t InitCheck() const { return fInitStatus; }
+
+	status_t Run(const uint8*& input, size_t& inputLength, uint8*& output, size_t& outputLength,
+		bool finish, bool& ended)
+	{
+		fStream.next_in = input;
+		fStream.avail_in = inputLength;
+		fStream.next_out = output;
+		fStream.avail_out = outputLength;
+
+		lzma_ret result = lzma_code(&fStream, finish ? LZMA_FINISH : LZMA_RUN);
+
+		input = fStream.next_in;
+		inputLength = fStream.avail_in;
+		output = fStream.next_out;
+		outputLength = fStream.avail_out;
+		ended = result == LZMA_STREAM_END;
+
+		if (result == LZMA_STREAM_END || result == LZMA_BUF_ERROR)
+			return B_OK;
+		return _Result(result);
+	}
+
+	status_t Reset()
+	{
+		// Reuses the memory of the previous decoder
+		return _Result(lzma_stream_decoder(&fStream, UINT64_MAX, 0));
+	}
+
+private:
+	static status_t _Result(lzma_ret result)
+	{
+		if (result == LZMA_OK)
+			return B_OK;
+		return result == LZMA_MEM_ERROR ? B_NO_MEMORY : B_BAD_DATA;
+	}
+
+	lzma_stream fStream;
+	status_t fInitStatus;
+};
+
+
+static StreamCodec*
+_CreateCodec(const Compression& compression, bool compress)
+{
+	switch (compression.format) {
+		case COMPRESSION_GZIP:
+			return new(std::nothrow) GzipCodec(compress,
+				compression.level != 0 ? compression.level : Z_DEFAULT_COMPRESSION);
+		case COMPRESSION_ZSTD:
+			// Level 0 is the default of zstd too
+			return new(std::nothrow) ZstdCodec(compress, compression.level);
+		case COMPRESSION_XZ:
+			return new(std::nothrow) XzCodec(compress,
+				compression.level != 0 ? compression.level : LZMA_PRESET_DEFAULT);
+		default:
+			return nullptr;
+	}
+}
+
+
+Compression::Compression(CompressionFormat format, int32 level)
+	:
+	format(format),
+	level(level)
+{
+}
+
+
+const char*
+Compression::Name() const
+{
+	switch (format) {
+		case COMPRESSION_GZIP:
+			return "gzip";
+		case COMPRESSION_ZSTD:
+			return "zstd";
+		case COMPRESSION_XZ:
+			return "xz";
+		default:
+			return "";
+	}
+}
+
+
+//	#pragma mark - DecompressingIO
+
+
+DecompressingIO::DecompressingIO(BDataIO* source)
+	:
+	fSource(source),
+	fBuffer(new(std::nothrow) uint8[kBufferSize]),
+	fStart(0),
+	fLength(0),
+	fDetected(false),
+	fSourceEnded(false),
+	fEnded(false)
+{
+}
+
+
+DecompressingIO::~DecompressingIO()
+{
+}
+
+
+ssize_t
+DecompressingIO::Read(void* buffer, size_t size)
+{
+	if (!fDetected) {
+		status_t status = _Detect();
+		if (status != B_OK)
+			return status;
+	}
+
+	if (!fCodec) {
+		// Hand out what was read to recognize the data first
+		if (fLength == 0)
+			return fSource->Read(buffer, size);
+		size_t length = std::min(fLength, size);
+		memcpy(buffer, fBuffer.get() + fStart, length);
+		fStart += length;
+		fLength -= length;
+		return length;
+	}
+
+	uint8* output = (uint8*)buffer;
+	size_t outputLength = size;
+	while (outputLength == size && size > 0 && !fEnded) {
+		if (fLength == 0 && !fSourceEnded) {
+			status_t status = _Fill();
+			if (status != B_OK)
+				return status;
+		}
+
+		const uint8* input = fBuffer.get() + fStart;
+		size_t inputLength = fLength;
+		bool ended = false;
+		status_t status = fCodec->Run(input, inputLength, output, outputLength, fSourceEnded,
+			ended);
+		if (status != B_OK)
+			return status;
+		bool progress = inputLength != fLength || outputLength != size;
+		fStart = input - fBuffer.get();
+		fLength = inputLength;
+
+		if (ended) {
+			// A compressed file may be several streams one after the other.
+			// Anything else after the end is ignored, as gzip does.
+			while (fLength < kHeaderLength && !fSourceEnded) {
+				status = _Fill();
+				if (status != B_OK)
+					return status;
+			}
+			if (fLength > 0
+				&& DetectCompression(fBuffer.get() + fStart, fLength).format
+					== fCompression.format) {
+				status = fCodec->Reset();
+				if (status != B_OK)
+					return status;
+			} else
+				fEnded = true;
+		} else if (!progress) {
+			// The stream ends before it is complete
+			if (fSourceEnded)
+				return B_BAD_DATA;
+			status = _Fill();
+			if (status != B_OK)
+				return status;
+		}
+	}
+	return size - outputLength;
+}
+
+
+ssize_t
+DecompressingIO::Write(const void* buffer, size_t size)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
+status_t
+DecompressingIO::_Detect()
+{
+	if (!fBuffer)
+		return B_NO_MEMORY;
+
+	while (fLength < kHeaderLength && !fSourceEnded) {
+		status_t status = _Fill();
+		if (status != B_OK)
+			return status;
+	}
+
+	fCompression = DetectCompression(fBuffer.get(), fLength);
+	if (fCompression.format != COMPRESSION_NONE) {
+		fCodec.reset(_CreateCodec(fCompression, false));
+		if (!fCodec)
+			return B_NO_MEMORY;
+		status_t status = fCodec->InitCheck();
+		if (status != B_OK)
+			return status;
+	}
+
+	fDetected = true;
+	return B_OK;
+}
+
+
+status_t
+DecompressingIO::_Fill()
+{
+	// Move what is left to the front, and read as much as fits behind it
+	memmove(fBuffer.get(), fBuffer.get() + fStart, fLength);
+	fStart = 0;
+
+	ssize_t bytesRead = fSource->Read(fBuffer.get() + fLength, kBufferSize - fLength);
+	if (bytesRead < 0)
+		return bytesRead;
+	if (bytesRead == 0)
+		fSourceEnded = true;
+	fLength += bytesRead;
+	return B_OK;
+}
+
+
+//	#pragma mark - CompressingIO
+
+
+CompressingIO::CompressingIO(BDataIO* target, const Compression& compression)
+	:
+	fTarget(target),
+	fCodec(_CreateCodec(compression, true)),
+	fBuffer(new(std::nothrow) uint8[kBufferSize])
+{
+}
+
+
+CompressingIO::~CompressingIO()
+{
+}
+
+
+status_t
+CompressingIO::InitCheck() const
+{
+	if (!fCodec || !fBuffer)
+		return B_NO_MEMORY;
+	return fCodec->InitCheck();
+}
+
+
+ssize_t
+CompressingIO::Read(void* buffer, size_t size)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
+ssize_t
+CompressingIO::Write(const void* buffer, size_t size)
+{
+	status_t status = _Run((const uint8*)buffer, size, false);
+	return status != B_OK ? status : (ssize_t)size;
+}
+
+
+status_t
+CompressingIO::Finish()
+{
+	return _Run((const uint8*)"", 0, true);
+}
+
+
+status_t
+CompressingIO::_Run(const uint8* data, size_t length, bool finish)
+{
+	status_t status = InitCheck();
+	if (status != B_OK)
+		return status;
+
+	for (;;) {
+		uint8* output = fBuffer.get();
+		size_t outputLength = kBufferSize;
+		bool ended = false;
+		status = fCodec->Run(data, length, output, outputLength, finish, ended);
+		if (status != B_OK)
+			return status;
+
+		if (outputLength < kBufferSize) {
+			status = fTarget->WriteExactly(fBuffer.get(), kBufferSize - outputLength);
+			if (status != B_OK)
+				return status;
+		}
+
+		// A full buffer may mean there is more output waiting
+		if (finish ? ended : length == 0 && outputLength > 0)
+			return B_OK;
+	}
+}
+
+
+//	#pragma mark -
+
+
+Compression
+DetectCompression(const void* data, size_t length)
+{
+	const uint8* bytes = (const uint8*)data;
+	if (length >= kHeaderLength && bytes[0] == 0x1f && bytes[1] == 0x8b && bytes[2] == 8) {
+		// The header tells if the best or the fastest compression was used
+		int32 level = bytes[8] == 2 ? 9 : bytes[8] == 4 ? 1 : 0;
+		return Compression(COMPRESSION_GZIP, level);
+	}
+	if (length >= 4 && memcmp(bytes, "\x28\xb5\x2f\xfd", 4) == 0)
+		return Compression(COMPRESSION_ZSTD);
+	if (length >= 6 && memcmp(bytes, "\xfd" "7zXZ\0", 6) == 0)
+		return Compression(COMPRESSION_XZ);
+	return Compression();
+}
+
+
+Compression
+CompressionForPath(const char* path)
+{
+	const char* extension = strrchr(path, '.');
+	if (extension == nullptr || strchr(extension, '/') != nullptr)
+		return Compression();
+	if (strcasecmp(extension, ".gz") == 0)
+		return Compression(COMPRESSION_GZIP);
+	if (strcasecmp(extension, ".zst") == 0)
+		return Compression(COMPRESSION_ZSTD);
+	if (strcasecmp(extension, ".xz") == 0)
+		return Compression(COMPRESSION_XZ);
+	return Compression();
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <DataIO.h>
+#include <SupportDefs.h>
+#include <memory>
+
+enum CompressionFormat {
+	COMPRESSION_NONE = 0,
+	COMPRESSION_GZIP,
+	COMPRESSION_ZSTD,
+	COMPRESSION_XZ
+};
+
+// How a file is compressed. A level of 0 is the default of the format.
+struct Compression {
+	Compression(CompressionFormat format = COMPRESSION_NONE, int32 level = 0);
+
+	const char* Name() const;
+
+	CompressionFormat format;
+	int32 level;
+};
+
+class StreamCodec;
+
+// Reads the decompressed contents of a gzip, zstd or xz stream, which it
+// recognizes by its first bytes. Other data is passed through unchanged.
+class DecompressingIO : public BDataIO {
+public:
+	DecompressingIO(BDataIO* source);
+	virtual ~DecompressingIO();
+
+	virtual ssize_t Read(void* buffer, size_t size);
+	virtual ssize_t Write(const void* buffer, size_t size);
+
+	// Only known after the first Read()
+	const Compression& GetCompression() const { return fCompression; }
+
+private:
+	status_t _Detect();
+	status_t _Fill();
+
+	BDataIO* fSource;
+	Compression fCompression;
+	std::unique_ptr<StreamCodec> fCodec;
+	std::unique_ptr<uint8[]> fBuffer;
+	size_t fStart;
+	size_t fLength;
+	bool fDetected;
+	bool fSourceEnded;
+	bool fEnded;
+};
+
+// Compresses what is written to it into the target. Finish() has to be called
+// after the last write to complete the stream.
+class CompressingIO : public BDataIO {
+public:
+	CompressingIO(BDataIO* target, const Compression& compression);
+	virtual ~CompressingIO();
+
+	status_t InitCheck() const;
+
+	virtual ssize_t Read(void* buffer, size_t size);
+	virtual ssize_t Write(const void* buffer, size_t size);
+	status_t Finish();
+
+private:
+	status_t _Run(const uint8* data, size_t length, bool finish);
+
+	BDataIO* fTarget;
+	std::unique_ptr<StreamCodec> fCodec;
+	std::unique_ptr<uint8[]> fBuffer;
+};
+
+Compression DetectCompression(const void* data, size_t length);
+// From the extension of the file name: ".gz", ".zst" or ".xz"
+Compression CompressionForPath(const char* path);
+
+#endif // COMPRESSION_H
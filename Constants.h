@@ -27,6 +27,12 @@ enum {
 	M_TRANSFORM_PREFIX_SUFFIX          = 'psfx',
 	M_TRANSFORM_REMOVE_PREFIX_SUFFIX   = 'rmpf',
 	M_TRANSFORM_REPLACE                = 'repl',
+	M_SEARCH_CHANGED                   = 'srch',
+	M_FIND_NEXT                        = 'fnxt',
+	M_FIND_PREVIOUS                    = 'fprv',
+	M_TRANSFORM_BATCH_REPLACE          = 'btrp',
+	M_BATCH_LOAD_PAIRS                 = 'btld',
+	M_BATCH_PAIRS_SELECTED             = 'btsl',
 	M_TRANSFORM_WIP                    = 'twip',
 
 	// Line/Block Operations
@@ -53,6 +59,10 @@ enum {
 	M_FILE_OPEN                        = 'flop',
 	M_FILE_SAVE                        = 'flsv',
 	M_FILE_SAVE_AS                     = 'flsa',
+	M_FILE_LOAD_PROGRESS               = 'flpr',
+	M_FILE_LOADED                      = 'flld',
+	M_FILE_CANCEL_LOAD                 = 'flcl',
+	M_FILE_SAVED                       = 'flsd',
 	M_INSERT_EXAMPLE_TEXT              = 'expl',
 
 	// Settings
@@ -64,6 +74,8 @@ enum {
 	M_SETTINGS_CLIPBOARD               = 'sclp',
 	M_TOGGLE_WORD_WRAP                 = 'tgww',
 	M_TOGGLE_APPLY_TO_SELECTION        = 'tgsl',
+	M_TOGGLE_PREVIEW                   = 'tgpv',
+	M_PREVIEW_APPLY                    = 'pvap',
 
 	// UI / Status
 	M_UPDATE_STATUSBAR                 = 'stbr',
@@ -77,7 +89,10 @@ enum {
 	// Help & Feedback
 	M_REPORT_A_BUG                     = 'rbug',
 	M_SHOW_HELP                        = 'shlp',
-	M_SHOW_STATS                       = 'stat'
+	M_SHOW_STATS                       = 'stat',
+	M_EXPORT_WORD_FREQUENCY            = 'exwf',
+	M_WORD_FREQUENCY_SELECTED          = 'wfsl',
+	M_SHOW_NGRAMS                      = 'shng'
 };
 
 enum BreakMode { BREAK_REMOVE_ALL = 0, BREAK_ON, BREAK_REPLACE, BREAK_AFTER_CHARS };
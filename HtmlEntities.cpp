@@ -0,0 +1,367 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "HtmlEntities.h"
+#include "HtmlEntityTrie.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unicode/utf.h>
+
+struct HtmlEntity {
+	const char* name;
+	uint32 codepoint;
+};
+
+// The HTML 4 entities and &apos;, sorted by code point
+static constexpr HtmlEntity kHtmlEntities[] = {
+	{ "quot",      34 }, { "amp",       38 }, { "apos",      39 },
+	{ "lt",        60 }, { "gt",        62 }, { "nbsp",     160 },
+	{ "iexcl",    161 }, { "cent",     162 }, { "pound",    163 },
+	{ "curren",   164 }, { "yen",      165 }, { "brvbar",   166 },
+	{ "sect",     167 }, { "uml",      168 }, { "copy",     169 },
+	{ "ordf",     170 }, { "laquo",    171 }, { "not",      172 },
+	{ "shy",      173 }, { "reg",      174 }, { "macr",     175 },
+	{ "deg",      176 }, { "plusmn",   177 }, { "sup2",     178 },
+	{ "sup3",     179 }, { "acute",    180 }, { "micro",    181 },
+	{ "para",     182 }, { "middot",   183 }, { "cedil",    184 },
+	{ "sup1",     185 }, { "ordm",     186 }, { "raquo",    187 },
+	{ "frac14",   188 }, { "frac12",   189 }, { "frac34",   190 },
+	{ "iquest",   191 }, { "Agrave",   192 }, { "Aacute",   193 },
+	{ "Acirc",    194 }, { "Atilde",   195 }, { "Auml",     196 },
+	{ "Aring",    197 }, { "AElig",    198 }, { "Ccedil",   199 },
+	{ "Egrave",   200 }, { "Eacute",   201 }, { "Ecirc",    202 },
+	{ "Euml",     203 }, { "Igrave",   204 }, { "Iacute",   205 },
+	{ "Icirc",    206 }, { "Iuml",     207 }, { "ETH",      208 },
+	{ "Ntilde",   209 }, { "Ograve",   210 }, { "Oacute",   211 },
+	{ "Ocirc",    212 }, { "Otilde",   213 }, { "Ouml",     214 },
+	{ "times",    215 }, { "Oslash",   216 }, { "Ugrave",   217 },
+	{ "Uacute",   218 }, { "Ucirc",    219 }, { "Uuml",     220 },
+	{ "Yacute",   221 }, { "THORN",    222 }, { "szlig",    223 },
+	{ "agrave",   224 }, { "aacute",   225 }, { "acirc",    226 },
+	{ "atilde",   227 }, { "auml",     228 }, { "aring",    229 },
+	{ "aelig",    230 }, { "ccedil",   231 }, { "egrave",   232 },
+	{ "eacute",   233 }, { "ecirc",    234 }, { "euml",     235 },
+	{ "igrave",   236 }, { "iacute",   237 }, { "icirc",    238 },
+	{ "iuml",     239 }, { "eth",      240 }, { "ntilde",   241 },
+	{ "ograve",   242 }, { "oacute",   243 }, { "ocirc",    244 },
+	{ "otilde",   245 }, { "ouml",     246 }, { "divide",   247 },
+	{ "oslash",   248 }, { "ugrave",   249 }, { "uacute",   250 },
+	{ "ucirc",    251 }, { "uuml",     252 }, { "yacute",   253 },
+	{ "thorn",    254 }, { "yuml",     255 }, { "OElig",    338 },
+	{ "oelig",    339 }, { "Scaron",   352 }, { "scaron",   353 },
+	{ "Yuml",     376 }, { "fnof",     402 }, { "circ",     710 },
+	{ "tilde",    732 }, { "Alpha",    913 }, { "Beta",     914 },
+	{ "Gamma",    915 }, { "Delta",    916 }, { "Epsilon",  917 },
+	{ "Zeta",     918 }, { "Eta",      919 }, { "Theta",    920 },
+	{ "Iota",     921 }, { "Kappa",    922 }, { "Lambda",   923 },
+	{ "Mu",       924 }, { "Nu",       925 }, { "Xi",       926 },
+	{ "Omicron",  927 }, { "Pi",       928 }, { "Rho",      929 },
+	{ "Sigma",    931 }, { "Tau",      932 }, { "Upsilon",  933 },
+	{ "Phi",      934 }, { "Chi",      935 }, { "Psi",      936 },
+	{ "Omega",    937 }, { "alpha",    945 }, { "beta",     946 },
+	{ "gamma",    947 }, { "delta",    948 }, { "epsilon",  949 },
+	{ "zeta",     950 }, { "eta",      951 }, { "theta",    952 },
+	{ "iota",     953 }, { "kappa",    954 }, { "lambda",   955 },
+	{ "mu",       956 }, { "nu",       957 }, { "xi",       958 },
+	{ "omicron",  959 }, { "pi",       960 }, { "rho",      961 },
+	{ "sigmaf",   962 }, { "sigma",    963 }, { "tau",      964 },
+	{ "upsilon",  965 }, { "phi",      966 }, { "chi",      967 },
+	{ "psi",      968 }, { "omega",    969 }, { "thetasym",  977 },
+	{ "upsih",    978 }, { "piv",      982 }, { "ensp",    8194 },
+	{ "emsp",    8195 }, { "thinsp",  8201 }, { "zwnj",    8204 },
+	{ "zwj",     8205 }, { "lrm",     8206 }, { "rlm",     8207 },
+	{ "ndash",   8211 }, { "mdash",   8212 }, { "lsquo",   8216 },
+	{ "rsquo",   8217 }, { "sbquo",   8218 }, { "ldquo",   8220 },
+	{ "rdquo",   8221 }, { "bdquo",   8222 }, { "dagger",  8224 },
+	{ "Dagger",  8225 }, { "bull",    8226 }, { "hellip",  8230 },
+	{ "permil",  8240 }, { "prime",   8242 }, { "Prime",   8243 },
+	{ "lsaquo",  8249 }, { "rsaquo",  8250 }, { "oline",   8254 },
+	{ "frasl",   8260 }, { "euro",    8364 }, { "image",   8465 },
+	{ "weierp",  8472 }, { "real",    8476 }, { "trade",   8482 },
+	{ "alefsym", 8501 }, { "larr",    8592 }, { "uarr",    8593 },
+	{ "rarr",    8594 }, { "darr",    8595 }, { "harr",    8596 },
+	{ "crarr",   8629 }, { "lArr",    8656 }, { "uArr",    8657 },
+	{ "rArr",    8658 }, { "dArr",    8659 }, { "hArr",    8660 },
+	{ "forall",  8704 }, { "part",    8706 }, { "exist",   8707 },
+	{ "empty",   8709 }, { "nabla",   8711 }, { "isin",    8712 },
+	{ "notin",   8713 }, { "ni",      8715 }, { "prod",    8719 },
+	{ "sum",     8721 }, { "minus",   8722 }, { "lowast",  8727 },
+	{ "radic",   8730 }, { "prop",    8733 }, { "infin",   8734 },
+	{ "ang",     8736 }, { "and",     8743 }, { "or",      8744 },
+	{ "cap",     8745 }, { "cup",     8746 }, { "int",     8747 },
+	{ "there4",  8756 }, { "sim",     8764 }, { "cong",    8773 },
+	{ "asymp",   8776 }, { "ne",      8800 }, { "equiv",   8801 },
+	{ "le",      8804 }, { "ge",      8805 }, { "sub",     8834 },
+	{ "sup",     8835 }, { "nsub",    8836 }, { "sube",    8838 },
+	{ "supe",    8839 }, { "oplus",   8853 }, { "otimes",  8855 },
+	{ "perp",    8869 }, { "sdot",    8901 }, { "lceil",   8968 },
+	{ "rceil",   8969 }, { "lfloor",  8970 }, { "rfloor",  8971 },
+	{ "lang",    9001 }, { "rang",    9002 }, { "loz",     9674 },
+	{ "spades",  9824 }, { "clubs",   9827 }, { "hearts",  9829 },
+	{ "diams",   9830 },
+};
+
+static constexpr int32 kHtmlEntityCount
+	= (int32)(sizeof(kHtmlEntities) / sizeof(kHtmlEntities[0]));
+static_assert(kHtmlEntityCount < 255, "entity indices must fit in the hash slots");
+
+static const int16 kNoEntity = -1;
+
+
+// Entity index for every Latin-1 code point
+struct Latin1EntityTable {
+	int16 index[256];
+
+	constexpr Latin1EntityTable()
+		:
+		index()
+	{
+		for (int32 c = 0; c < 256; c++)
+			index[c] = kNoEntity;
+		for (int32 i = 0; i < kHtmlEntityCount; i++) {
+			if (kHtmlEntities[i].codepoint < 256)
+				index[kHtmlEntities[i].codepoint] = i;
+		}
+	}
+};
+
+// The remaining code points are found through a perfect hash. The multiplier
+// was searched offline so that no two of them share a slot; the table checks
+// this at compile time, so a changed entity list cannot silently break it.
+static const uint32 kEntityHashMultiplier = 1011789;
+static const int32 kEntityHashBits = 12;
+
+
+static constexpr uint32
+_EntityHash(uint32 codepoint)
+{
+	return (codepoint * kEntityHashMultiplier) >> (32 - kEntityHashBits);
+}
+
+
+struct EntityHashTable {
+	uint8 slots[1 << kEntityHashBits]; // Entity index + 1, 0 if empty
+	bool perfect;
+
+	constexpr EntityHashTable()
+		:
+		slots(),
+		perfect(true)
+	{
+		for (int32 i = 0; i < kHtmlEntityCount; i++) {
+			if (kHtmlEntities[i].codepoint < 256)
+				continue;
+			uint32 hash = _EntityHash(kHtmlEntities[i].codepoint);
+			if (slots[hash] != 0)
+				perfect = false;
+			slots[hash] = i + 1;
+		}
+	}
+};
+
+static constexpr Latin1EntityTable kLatin1Entities;
+static constexpr EntityHashTable kEntityHash;
+static_assert(kEntityHash.perfect, "entity hash has collisions, pick a new multiplier");
+
+
+static inline int32
+_FindEntity(uint32 codepoint)
+{
+	if (codepoint < 256)
+		return kLatin1Entities.index[codepoint];
+
+	uint8 slot = kEntityHash.slots[_EntityHash(codepoint)];
+	if (slot != 0 && kHtmlEntities[slot - 1].codepoint == codepoint)
+		return slot - 1;
+
+	return kNoEntity;
+}
+
+
+static inline void
+_Write(char* output, size_t& written, const void* data, size_t length)
+{
+	if (output != nullptr)
+		memcpy(output + written, data, length);
+	written += length;
+}
+
+
+size_t
+HtmlEncode(const char* data, size_t length, char* output, bool encodeByName)
+{
+	const uint8* input = (const uint8*)data;
+	const uint8* end = input + length;
+	size_t written = 0;
+
+	while (input < end) {
+		// Plain ASCII is copied a whole run at a time
+		const uint8* run = input;
+		while (input < end && *input < 0x80 && kLatin1Entities.index[*input] == kNoEntity)
+			input++;
+		if (input > run)
+			_Write(output, written, run, input - run);
+		if (input == end)
+			break;
+
+		UChar32 codepoint;
+		int32 offset = 0;
+		int32 available = end - input < 4 ? (int32)(end - input) : 4;
+		U8_NEXT(input, offset, available, codepoint);
+		if (codepoint < 0) {
+			// Keep malformed bytes as they are
+			_Write(output, written, input, offset);
+			input += offset;
+			continue;
+		}
+		input += offset;
+
+		char entity[16];
+		int32 entityLength = 0;
+		int32 index = _FindEntity(codepoint);
+		entity[entityLength++] = '&';
+		if (encodeByName && index != kNoEntity) {
+			int32 nameLength = strlen(kHtmlEntities[index].name);
+			memcpy(entity + entityLength, kHtmlEntities[index].name, nameLength);
+			entityLength += nameLength;
+		} else {
+			entity[entityLength++] = '#';
+			char digits[10];
+			int32 count = 0;
+			do {
+				digits[count++] = '0' + codepoint % 10;
+				codepoint /= 10;
+			} while (codepoint > 0);
+			while (count > 0)
+				entity[entityLength++] = digits[--count];
+		}
+		entity[entityLength++] = ';';
+		_Write(output, written, entity, entityLength);
+	}
+
+	return written;
+}
+
+
+// Replacements for the numeric references in the C1 control range, which
+// HTML reads as Windows-1252
+static const uint16 kWindows1252[32] = {
+	0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+	0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178
+};
+
+
+// Parses "&#..." at input and writes the character. Returns the number of
+// bytes consumed, or 0 if there are no digits and it is not a reference.
+static size_t
+_DecodeNumericReference(const char* input, const char* end, char* output, size_t& written)
+{
+	const char* p = input + 2;
+	bool hex = p < end && (*p == 'x' || *p == 'X');
+	if (hex)
+		p++;
+
+	const char* digits = p;
+	uint32 codepoint = 0;
+	bool overflow = false;
+	for (; p < end; p++) {
+		int32 digit;
+		if (*p >= '0' && *p <= '9')
+			digit = *p - '0';
+		else if (hex && *p >= 'a' && *p <= 'f')
+			digit = *p - 'a' + 10;
+		else if (hex && *p >= 'A' && *p <= 'F')
+			digit = *p - 'A' + 10;
+		else
+			break;
+
+		codepoint = codepoint * (hex ? 16 : 10) + digit;
+		if (codepoint > 0x10FFFF) {
+			overflow = true;
+			codepoint = 0x10FFFF;
+		}
+	}
+
+	if (p == digits)
+		return 0;
+	if (p < end && *p == ';')
+		p++;
+
+	if (overflow || codepoint == 0 || U_IS_SURROGATE(codepoint))
+		codepoint = 0xFFFD;
+	else if (codepoint >= 0x80 && codepoint <= 0x9F)
+		codepoint = kWindows1252[codepoint - 0x80];
+
+	U8_APPEND_UNSAFE(output, written, codepoint);
+	return p - input;
+}
+
+
+// Walks the entity trie from the character after '&' and returns the length
+// of the longest name found, with its value index, or 0.
+static size_t
+_MatchNamedReference(const char* input, const char* end, uint16& value)
+{
+	size_t matched = 0;
+	int32 node = 0;
+	for (const char* p = input; p < end; p++) {
+		const char* first = kEntityTrieLabels + kEntityTrieFirstEdge[node];
+		const char* last = kEntityTrieLabels + kEntityTrieFirstEdge[node + 1];
+		const char* edge = std::lower_bound(first, last, *p);
+		if (edge == last || *edge != *p)
+			break;
+
+		node = kEntityTrieTargets[edge - kEntityTrieLabels];
+		if (kEntityTrieValues[node] != 0) {
+			value = kEntityTrieValues[node];
+			matched = p + 1 - input;
+		}
+	}
+	return matched;
+}
+
+
+size_t
+HtmlDecode(const char* data, size_t length, char* output)
+{
+	const char* input = data;
+	const char* end = data + length;
+	size_t written = 0;
+
+	while (input < end) {
+		const char* reference = (const char*)memchr(input, '&', end - input);
+		const char* runEnd = reference != nullptr ? reference : end;
+		memcpy(output + written, input, runEnd - input);
+		written += runEnd - input;
+		input = runEnd;
+		if (reference == nullptr)
+			break;
+
+		size_t consumed = 0;
+		if (input + 1 < end && input[1] == '#')
+			consumed = _DecodeNumericReference(input, end, output, written);
+		else {
+			uint16 value = 0;
+			size_t matched = _MatchNamedReference(input + 1, end, value);
+			if (matched > 0) {
+				U8_APPEND_UNSAFE(output, written, kEntityTrieCodepoints[value][0]);
+				if (kEntityTrieCodepoints[value][1] != 0)
+					U8_APPEND_UNSAFE(output, written, kEntityTrieCodepoints[value][1]);
+				consumed = matched + 1;
+			}
+		}
+
+		if (consumed == 0) {
+			output[written++] = '&';
+			consumed = 1;
+		}
+		input += consumed;
+	}
+
+	return written;
+}
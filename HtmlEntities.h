@@ -0,0 +1,26 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef HTML_ENTITIES_H
+#define HTML_ENTITIES_H
+
+#include <SupportDefs.h>
+
+// Writes the encoded text to output and returns its length. With a nullptr
+// output only the length is computed, so the buffer can be sized first.
+size_t HtmlEncode(const char* data, size_t length, char* output, bool encodeByName);
+
+// Decodes numeric and named character references the way an HTML5 parser does
+// in text content, including the legacy names without a trailing ';'. The
+// output may be slightly longer than the input, see HtmlDecodedMaxLength().
+size_t HtmlDecode(const char* data, size_t length, char* output);
+
+inline size_t
+HtmlDecodedMaxLength(size_t length)
+{
+	// The worst case is "&nGt;", five bytes that decode to six
+	return length + length / 5 + 4;
+}
+
+#endif // HTML_ENTITIES_H
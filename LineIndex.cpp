@@ -0,0 +1,86 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "LineIndex.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+LineIndex::LineIndex()
+	:
+	fLength(0)
+{
+	fStarts.push_back(0);
+}
+
+
+void
+LineIndex::SetTo(const char* text, int32 length)
+{
+	fStarts.clear();
+	fStarts.push_back(0);
+	fLength = length;
+
+	int32 i = 0;
+#if defined(__SSE2__)
+	// Compare 16 bytes at once, and only look at single bytes where a line
+	// break was found
+	const __m128i newline = _mm_set1_epi8('\n');
+	for (; i + 16 <= length; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i*)(text + i));
+		uint32 mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+		while (mask != 0) {
+			fStarts.push_back(i + __builtin_ctz(mask) + 1);
+			mask &= mask - 1;
+		}
+	}
+#endif
+	for (; i < length; i++) {
+		if (text[i] == '\n')
+			fStarts.push_back(i + 1);
+	}
+}
+
+
+int32
+LineIndex::LineEnd(int32 line) const
+{
+	if (line + 1 < (int32)fStarts.size())
+		return fStarts[line + 1] - 1;
+	return fLength;
+}
+
+
+int32
+LineIndex::LineAt(int32 offset) const
+{
+	return std::upper_bound(fStarts.begin(), fStarts.end(), offset) - fStarts.begin() - 1;
+}
+
+
+LineRange::LineRange(const LineIndex& index, const char* text, int32 start, int32 end)
+	:
+	fIndex(index),
+	fText(text),
+	fStart(start),
+	fEnd(end),
+	fFirstLine(index.LineAt(start)),
+	fCount(index.LineAt(end) - fFirstLine + 1)
+{
+}
+
+
+std::string_view
+LineRange::LineAt(int32 line) const
+{
+	line += fFirstLine;
+	int32 start = std::max(fIndex.LineStart(line), fStart);
+	int32 end = std::min(fIndex.LineEnd(line), fEnd);
+	return std::string_view(fText + start, std::max(end - start, (int32)0));
+}
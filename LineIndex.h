@@ -0,0 +1,49 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+#include <SupportDefs.h>
+#include <string_view>
+#include <vector>
+
+// Start offsets of all lines of a text. The text is split at every '\n', so
+// a text ending with a line break has an empty last line. Only offsets are
+// stored, the index stays valid as long as the text is not changed.
+class LineIndex {
+public:
+	LineIndex();
+
+	void SetTo(const char* text, int32 length);
+
+	int32 CountLines() const { return fStarts.size(); }
+	int32 LineStart(int32 line) const { return fStarts[line]; }
+	int32 LineEnd(int32 line) const; // Offset of the line break, or of the text end
+	int32 LineAt(int32 offset) const;
+
+private:
+	std::vector<int32> fStarts;
+	int32 fLength;
+};
+
+// The lines of the range [start, end) of an indexed text, as views into the
+// text. The range must start at the beginning of a line.
+class LineRange {
+public:
+	LineRange(const LineIndex& index, const char* text, int32 start, int32 end);
+
+	int32 CountLines() const { return fCount; }
+	std::string_view LineAt(int32 line) const;
+
+private:
+	const LineIndex& fIndex;
+	const char* fText;
+	int32 fStart;
+	int32 fEnd;
+	int32 fFirstLine;
+	int32 fCount;
+};
+
+#endif // LINE_INDEX_H
@@ -25,15 +25,24 @@
 #include <TranslatorRoster.h>
 #include <Url.h>
 #include <View.h>
+#include <cstring>
 #include <string>
 
 #include "Constants.h"
 #include "IconMenuItem.h"
+#include "NGramWindow.h"
+#include "PreviewWindow.h"
+#include "SessionJournal.h"
 #include "SettingsWindow.h"
+#include "TextFile.h"
 #include "TextUtils.h"
 #include "Toolbar.h"
 
 static const char* kSettingsFile = "TextWorker_settings";
+static const char* kSessionFile = "TextWorker_session";
+// Replacement pairs are shown in a text field; a file larger than this is
+// most likely the wrong one
+static const off_t kMaxBatchPairsSize = 1024 * 1024;
 static const char* kIssueTracker = "https://github.com/dospuntos/TextWorker/issues/";
 
 
@@ -45,7 +54,15 @@ MainWindow::MainWindow(void)
 	:
 	BWindow(BRect(100, 100, 900, 800), kApplicationName, B_DOCUMENT_WINDOW,
 		B_ASYNCHRONOUS_CONTROLS | B_QUIT_ON_WINDOW_CLOSE),
+		fJournal(new SessionJournal(kSessionFile)),
 		fSettingsWindow(nullptr),
+		fPreviewWindow(nullptr),
+		fNGramWindow(nullptr),
+		fLoader(nullptr),
+		fSaver(nullptr),
+		fLoadID(0),
+		fPreviewWhat(0),
+		fPreviewChanges(false),
 		fPendingMessage(nullptr)
 {
 	BMenuBar* menuBar = _BuildMenu();
@@ -97,6 +114,11 @@ MainWindow::MainWindow(void)
 	BMessenger messenger(this);
 	fOpenPanel = new BFilePanel(B_OPEN_PANEL, &messenger, NULL, B_FILE_NODE, false);
 	fSavePanel = new BFilePanel(B_SAVE_PANEL, &messenger, NULL, B_FILE_NODE, false);
+	fBatchPanel = new BFilePanel(B_OPEN_PANEL, &messenger, NULL, B_FILE_NODE, false,
+		new BMessage(M_BATCH_PAIRS_SELECTED));
+	fWordFrequencyPanel = new BFilePanel(B_SAVE_PANEL, &messenger, NULL, B_FILE_NODE, false,
+		new BMessage(M_WORD_FREQUENCY_SELECTED));
+	fWordFrequencyPanel->SetSaveText("word-frequency.csv");
 
 	BRect frame;
 	if (settings.FindRect("main_window_rect", &frame) == B_OK) {
@@ -114,10 +136,11 @@ MainWindow::MainWindow(void)
 	if (!fSaveTextOnExit && fInsertClipboard) {
 		BString clipboardText;
 		if (_GetClipboardText(clipboardText)) {
-			fTextView->SetText(clipboardText);
-			fTextView->ClearHistory();
+			fTextView->LoadText(clipboardText.String(), clipboardText.Length());
 			fLastSavedText = clipboardText;
 			fFilePath = "";
+			fEncoding = TextEncoding();
+			fCompression = Compression();
 		}
 	}
 
@@ -128,8 +151,14 @@ MainWindow::MainWindow(void)
 MainWindow::~MainWindow()
 {
 	_SaveSettings();
+	fTextView->SetJournal(nullptr);
+	delete fJournal;
 	delete fOpenPanel;
 	delete fSavePanel;
+	delete fBatchPanel;
+	delete fWordFrequencyPanel;
+	delete fLoader;
+	delete fSaver;
 }
 
 
@@ -162,9 +191,11 @@ MainWindow::MessageReceived(BMessage* msg)
 			// Ask to save
 			if (!_CheckSaveAndContinue(new BMessage(M_FILE_NEW)))
 				break;
-			fTextView->SetText("");
-			fTextView->ClearHistory();
+			_CancelLoading();
+			fTextView->LoadText("", 0);
 			fFilePath = "";
+			fEncoding = TextEncoding();
+			fCompression = Compression();
 			fLastSavedText = "";
 			_UpdateWindowTitle();
 			break;
@@ -191,23 +222,50 @@ MainWindow::MessageReceived(BMessage* msg)
 			if (msg->FindRef("directory", &dir) == B_OK && msg->FindString("name", &name) == B_OK) {
 				BPath path(&dir);
 				path.Append(name);
-				SaveFile(path.Path());
+				// Saved as another file, compressed as its name says
+				SaveFile(path.Path(), CompressionForPath(path.Path()));
 			}
 			break;
 		}
 		case M_FILE_OPEN:
 			fOpenPanel->Show();
 			break;
+		case M_FILE_LOAD_PROGRESS:
+		{
+			int32 id;
+			int32 percent;
+			if (fLoader != nullptr && msg->FindInt32("id", &id) == B_OK && id == fLoader->ID()
+				&& msg->FindInt32("percent", &percent) == B_OK) {
+				BString text;
+				text.SetToFormat(B_TRANSLATE("Opening file: %" B_PRId32 "%% (Esc to cancel)"),
+					percent);
+				_UpdateStatusMessage(text);
+			}
+			break;
+		}
+		case M_FILE_LOADED:
+		{
+			int32 id;
+			if (fLoader != nullptr && msg->FindInt32("id", &id) == B_OK && id == fLoader->ID())
+				_FinishLoading();
+			break;
+		}
+		case M_FILE_CANCEL_LOAD:
+			if (fLoader != nullptr)
+				fLoader->Cancel();
+			break;
 		case M_FILE_SAVE:
 			if (fFilePath.IsEmpty()) {
 				// First time save, show Save As panel
 				fSavePanel->Show();
 			} else {
-				if (SaveFile(fFilePath.String()) == B_OK && fPendingQuitAfterSave) {
-					be_app->PostMessage(B_QUIT_REQUESTED);
-				}
+				SaveFile(fFilePath.String(), fCompression);
 			}
 			break;
+		case M_FILE_SAVED:
+			if (fSaver != nullptr)
+				_FinishSaving();
+			break;
 		case M_FILE_SAVE_AS:
 			fSavePanel->Show();
 			break;
@@ -221,7 +279,8 @@ MainWindow::MessageReceived(BMessage* msg)
 			if (!fSettingsWindow) {
 				fSettingsWindow
 					= new SettingsWindow(fSaveTextOnExit, fSaveFieldsOnExit, fInsertClipboard,
-						fClearSettingsAfterUse, fFontSize, fFontFamily, fCloseOnEsc, fAskToSave);
+						fClearSettingsAfterUse, fFontSize, fFontFamily, fCloseOnEsc, fAskToSave,
+						fStatsWordCount);
 				fSettingsWindow->CenterIn(Frame());
 				fSettingsWindow->Show();
 			} else {
@@ -237,116 +296,96 @@ MainWindow::MessageReceived(BMessage* msg)
 			break;
 		}
 		case M_TRANSFORM_UPPERCASE:
-			ConvertToUppercase(fTextView);
-			break;
 		case M_TRANSFORM_LOWERCASE:
-			ConvertToLowercase(fTextView);
-			break;
 		case M_TRANSFORM_CAPITALIZE:
-			Capitalize(fTextView);
-			break;
 		case M_TRANSFORM_TITLE_CASE:
-			ConvertToTitlecase(fTextView);
-			break;
 		case M_TRANSFORM_RANDOM_CASE:
-			ConvertToRandomCase(fTextView);
-			break;
 		case M_TRANSFORM_ALTERNATING_CASE:
-			ConvertToAlternatingCase(fTextView);
-			break;
 		case M_TRANSFORM_TOGGLE_CASE:
-			ToggleCase(fTextView);
-			break;
 		case M_REMOVE_LINE_BREAKS_DEFAULT:
-			RemoveLineBreaks(fTextView);
-			break;
 		case M_REMOVE_LINE_BREAKS:
-			if (fSidebar->getBreakMode() == BREAK_REMOVE_ALL) {
-				RemoveLineBreaks(fTextView);
-			} else if (fSidebar->getBreakMode() == BREAK_ON) {
-				BreakLinesOnDelimiter(fTextView, fSidebar->getBreakModeInput(),
-					fSidebar->getKeepDelimiterValue());
-			} else if (fSidebar->getBreakMode() == BREAK_REPLACE) {
-				RemoveLineBreaks(fTextView, fSidebar->getBreakModeInput());
-			} else if (fSidebar->getBreakMode() == BREAK_AFTER_CHARS) {
-				InsertLineBreaks(fTextView, fSidebar->getBreakOnCharsSpinner(),
-					fSidebar->getSplitOnWords());
-			}
-			if (fClearSettingsAfterUse)
-				fSidebar->setBreakModeInput("");
-			break;
 		case M_TRIM_LINES:
-			TrimWhitespace(fTextView);
-			break;
 		case M_TRANSFORM_REPLACE:
-			ReplaceAll(fTextView, fSidebar->getSearchText(), fSidebar->getReplaceText(),
-				fSidebar->getReplaceCaseSensitive(), fSidebar->getReplaceFullWords());
-			if (fClearSettingsAfterUse) {
-				fSidebar->setSearchText("");
-				fSidebar->setReplaceText("");
-				fSidebar->setReplaceCaseSensitive(false);
-				fSidebar->setReplaceFullWords(false);
-			}
-			break;
+		case M_TRANSFORM_BATCH_REPLACE:
 		case M_TRIM_EMPTY_LINES:
-			TrimEmptyLines(fTextView);
-			break;
 		case M_TRANSFORM_PREFIX_SUFFIX:
-			AddStringsToEachLine(fTextView, fSidebar->getPrefixText(), fSidebar->getSuffixText());
-			if (fClearSettingsAfterUse) {
-				fSidebar->setPrefixText("");
-				fSidebar->setSuffixText("");
-			}
-			break;
 		case M_TRANSFORM_REMOVE_PREFIX_SUFFIX:
-			RemoveStringsFromEachLine(fTextView, fSidebar->getPrefixText(),
-				fSidebar->getSuffixText());
-			if (fClearSettingsAfterUse) {
-				fSidebar->setPrefixText("");
-				fSidebar->setSuffixText("");
-			}
-			break;
 		case M_TRANSFORM_ROT13:
-			ConvertToROT13(fTextView);
-			break;
 		case M_TRANSFORM_ENCODE_URL:
-			URLEncode(fTextView);
-			break;
 		case M_TRANSFORM_DECODE_URL:
-			URLDecode(fTextView);
-			break;
 		case M_TRANSFORM_BASE64:
-			Base64(fTextView);
-			break;
 		case M_TRANSFORM_HTML_ENCODE_NAME:
-			EncodeHTMLEntities(fTextView, true);
-			break;
 		case M_TRANSFORM_HTML_ENCODE_NUM:
-			EncodeHTMLEntities(fTextView, false);
-			break;
 		case M_TRANSFORM_HTML_DECODE:
-			DecodeHTMLEntities(fTextView);
-			break;
 		case M_SORT_LINES:
+		case M_INDENT_LINES:
+		case M_UNINDENT_LINES:
+		case M_REMOVE_DUPLICATES:
+			if (fPreviewChanges)
+				_PreviewTransform(msg->what);
+			else {
+				fTextView->BeginUndoGroup();
+				_RunTransform(msg->what, fTextView);
+				fTextView->EndUndoGroup();
+				_ClearUsedFields(msg->what);
+			}
+			break;
+		case M_TOGGLE_PREVIEW:
+			fPreviewChanges = !fPreviewChanges;
+			fPreviewItem->SetMarked(fPreviewChanges);
+			break;
+		case M_PREVIEW_APPLY:
 		{
-			bool sortAlphabetically = fSidebar->getAlphaSortRadio();
-			bool sortAscending = fSidebar->getSortAsc();
-			bool caseSensitive = fSidebar->getCaseSortCheck();
-
-			if (sortAlphabetically)
-				SortLines(fTextView, sortAscending, caseSensitive);
-			else
-				SortLinesByLength(fTextView, sortAscending, caseSensitive);
+			status_t status = fPreview.Apply(fTextView);
+			if (status == B_MISMATCHED_VALUES) {
+				_UpdateStatusMessage(
+					B_TRANSLATE("The text was changed after the preview, nothing was applied"));
+			} else if (status == B_OK) {
+				_ClearUsedFields(fPreviewWhat);
+				if (!fPreview.StatusMessage().IsEmpty())
+					_UpdateStatusMessage(fPreview.StatusMessage());
+			}
+			fPreview.Clear();
 			break;
 		}
-		case M_INDENT_LINES:
-		case M_UNINDENT_LINES:
+		case M_SEARCH_CHANGED:
+			_UpdateSearchTerm();
+			break;
+		case M_FIND_NEXT:
+		case M_FIND_PREVIOUS:
+			if (!fTextView->SelectNextMatch(msg->what == M_FIND_NEXT))
+				_UpdateStatusMessage(B_TRANSLATE("No matches found"));
+			break;
+		case M_BATCH_LOAD_PAIRS:
+			fBatchPanel->Show();
+			break;
+		case M_BATCH_PAIRS_SELECTED:
 		{
-			if (msg->what == M_INDENT_LINES) {
-				IndentLines(fTextView, fSidebar->getTabsRadio(), fSidebar->getIndentSpinner());
-			} else {
-				UnindentLines(fTextView, fSidebar->getTabsRadio(), fSidebar->getIndentSpinner());
+			entry_ref ref;
+			if (msg->FindRef("refs", &ref) != B_OK)
+				break;
+
+			BFile file(&ref, B_READ_ONLY);
+			off_t size;
+			if (file.InitCheck() != B_OK || file.GetSize(&size) != B_OK) {
+				_UpdateStatusMessage(B_TRANSLATE("Could not read the replacement pairs file"));
+				break;
+			}
+
+			if (size > kMaxBatchPairsSize) {
+				_UpdateStatusMessage(B_TRANSLATE("The replacement pairs file is too large"));
+				break;
 			}
+
+			BString pairs;
+			char* buffer = pairs.LockBuffer(size);
+			if (buffer == nullptr) {
+				_UpdateStatusMessage(B_TRANSLATE("Could not read the replacement pairs file"));
+				break;
+			}
+			ssize_t bytesRead = file.Read(buffer, size);
+			pairs.UnlockBuffer(bytesRead > 0 ? bytesRead : 0);
+			fSidebar->setBatchPairs(pairs);
 			break;
 		}
 		case M_MODE_REMOVE_ALL:
@@ -355,9 +394,6 @@ MainWindow::MessageReceived(BMessage* msg)
 		case M_MODE_BREAK_AFTER_CHARS:
 			fSidebar->MessageReceived(msg);
 			break;
-		case M_REMOVE_DUPLICATES:
-			RemoveDuplicateLines(fTextView);
-			break;
 		case M_INSERT_EXAMPLE_TEXT:
 			fTextView->SetText(B_TRANSLATE("Haiku is an open-source operating system.\n"
 										   "It is fast, simple and elegant.\n"
@@ -396,8 +432,26 @@ MainWindow::MessageReceived(BMessage* msg)
 			break;
 		}
 		case M_SHOW_STATS:
-			ShowTextStats(fTextView);
+			ShowTextStats(fTextView, fWordList, fStatsWordCount);
+			break;
+		case M_SHOW_NGRAMS:
+			_ShowNGrams();
+			break;
+		case M_EXPORT_WORD_FREQUENCY:
+			fWordFrequencyPanel->Show();
 			break;
+		case M_WORD_FREQUENCY_SELECTED:
+		{
+			entry_ref dir;
+			BString name;
+			if (msg->FindRef("directory", &dir) == B_OK && msg->FindString("name", &name) == B_OK) {
+				BPath path(&dir);
+				path.Append(name);
+				ExportWordFrequency(fWordList, path.Path());
+				fWordList = WordFrequency();
+			}
+			break;
+		}
 		case M_SHOW_STATUS:
 		{
 			BString text;
@@ -434,6 +488,14 @@ MainWindow::QuitRequested()
 		fSettingsWindow->Quit();
 		fSettingsWindow = nullptr;
 	}
+	if (fPreviewWindow && fPreviewWindow->LockLooper()) {
+		fPreviewWindow->Quit();
+		fPreviewWindow = nullptr;
+	}
+	if (fNGramWindow && fNGramWindow->LockLooper()) {
+		fNGramWindow->Quit();
+		fNGramWindow = nullptr;
+	}
 
 	if (!_CheckSaveAndContinue(new BMessage(B_QUIT_REQUESTED)))
         return false;
@@ -507,8 +569,13 @@ MainWindow::_BuildMenu()
 	menu->AddSeparatorItem();
 	menu->AddItem(fSelectAllItem);
 	menu->AddSeparatorItem();
+	fPreviewItem = new BMenuItem(B_TRANSLATE("Preview changes"), new BMessage(M_TOGGLE_PREVIEW));
+	menu->AddItem(fPreviewItem);
 	menu->AddItem(new BMenuItem(B_TRANSLATE("Insert example text"),
 		new BMessage(M_INSERT_EXAMPLE_TEXT), 'E'));
+	menu->AddSeparatorItem();
+	menu->AddItem(new BMenuItem(B_TRANSLATE("N-gram frequency" B_UTF8_ELLIPSIS),
+		new BMessage(M_SHOW_NGRAMS)));
 
 	menuBar->AddItem(menu);
 
@@ -613,12 +680,10 @@ MainWindow::_SaveSettings()
 	settings.AddBool("wrapLines", fTextView->DoesWordWrap());
 	settings.AddBool("closeOnEsc", fCloseOnEsc);
 	settings.AddBool("askToSave", fAskToSave);
+	settings.AddInt32("statsWordCount", fStatsWordCount);
+	settings.AddBool("previewChanges", fPreviewChanges);
 	settings.AddString("filePath", fFilePath);
 
-	// Save textView
-	if (fTextView && fSaveTextOnExit)
-		settings.AddString("textViewContent", fTextView->Text());
-
 	// Save sidebar text inputs
 	if (fSidebar && fSaveFieldsOnExit) {
 		settings.AddInt32("activeTab", fSidebar->Selection());
@@ -627,6 +692,11 @@ MainWindow::_SaveSettings()
 		settings.AddString("replaceWithString", fSidebar->getReplaceText());
 		settings.AddBool("replaceCaseSensitive", fSidebar->getReplaceCaseSensitive());
 		settings.AddBool("replaceFullWords", fSidebar->getReplaceFullWords());
+		settings.AddBool("replaceRegex", fSidebar->getReplaceRegex());
+
+		// Batch replace
+		settings.AddString("batchPairs", fSidebar->getBatchPairs());
+		settings.AddBool("batchCaseSensitive", fSidebar->getBatchCaseSensitive());
 
 		// Line breaks
 		settings.AddInt32("breakMode", fSidebar->getBreakMode());
@@ -647,6 +717,10 @@ MainWindow::_SaveSettings()
 		settings.AddBool("sortType", fSidebar->getAlphaSortRadio());
 		settings.AddBool("sortAsc", fSidebar->getSortAsc());
 		settings.AddBool("sortCase", fSidebar->getCaseSortCheck());
+
+		// Encode/decode
+		settings.AddInt32("urlEncodeSet", fSidebar->getUrlEncodeSet());
+		settings.AddInt32("base64Variant", fSidebar->getBase64Variant());
 	}
 
 	if (status == B_OK)
@@ -668,6 +742,7 @@ MainWindow::_RestoreValues(BMessage& settings)
 	fClearSettingsAfterUse = false;
 	fCloseOnEsc = false;
 	fAskToSave = true;
+	fStatsWordCount = 10;
 	fFilePath = "";
 
 	BString text;
@@ -702,6 +777,14 @@ MainWindow::_RestoreValues(BMessage& settings)
 	if (settings.FindBool("askToSave", &flag) == B_OK)
 		fAskToSave = flag;
 
+	if (settings.FindInt32("statsWordCount", &number) == B_OK)
+		fStatsWordCount = number;
+
+	if (settings.FindBool("previewChanges", &flag) == B_OK) {
+		fPreviewChanges = flag;
+		fPreviewItem->SetMarked(flag);
+	}
+
 	if (settings.FindString("filePath", &text) == B_OK && fSaveTextOnExit)
 		fFilePath = text;
 
@@ -715,15 +798,21 @@ MainWindow::_RestoreValues(BMessage& settings)
 	font.SetSize(fFontSize);
 	fTextView->SetFontAndColor(&font);
 
-	if (settings.FindString("textViewContent", &text) == B_OK && fSaveTextOnExit) {
-		fTextView->SetText(text);
-		fTextView->ClearHistory();
+	std::string restoredText;
+	bool restored = fSaveTextOnExit && fJournal->Restore(restoredText) == B_OK;
+	if (restored) {
+		fTextView->LoadText(restoredText.data(), restoredText.size());
+		fLastSavedText.SetTo(restoredText.data(), restoredText.size());
+	} else if (settings.FindString("textViewContent", &text) == B_OK && fSaveTextOnExit) {
+		// Older versions kept the text in the settings
+		fTextView->LoadText(text.String(), text.Length());
 		fLastSavedText = text;
 	} else {
-		fTextView->SetText("");
-		fTextView->ClearHistory();
+		fTextView->LoadText("", 0);
 		fLastSavedText = text;
 	}
+	if (fSaveTextOnExit)
+		_StartJournal(restored);
 
 	if (fSidebar && fSaveFieldsOnExit) {
 		if (settings.FindInt32("activeTab", &number) == B_OK)
@@ -738,6 +827,14 @@ MainWindow::_RestoreValues(BMessage& settings)
 			fSidebar->setReplaceCaseSensitive(flag);
 		if (settings.FindBool("replaceFullWords", &flag) == B_OK)
 			fSidebar->setReplaceFullWords(flag);
+		if (settings.FindBool("replaceRegex", &flag) == B_OK)
+			fSidebar->setReplaceRegex(flag);
+
+		// Batch replace
+		if (settings.FindString("batchPairs", &text) == B_OK)
+			fSidebar->setBatchPairs(text);
+		if (settings.FindBool("batchCaseSensitive", &flag) == B_OK)
+			fSidebar->setBatchCaseSensitive(flag);
 
 		// Line breaks
 		if (settings.FindInt32("breakMode", &number) == B_OK)
@@ -770,6 +867,14 @@ MainWindow::_RestoreValues(BMessage& settings)
 			fSidebar->setSortAsc(flag);
 		if (settings.FindBool("sortCase", &flag) == B_OK)
 			fSidebar->setCaseSortCheck(flag);
+
+		// Encode/decode
+		if (settings.FindInt32("urlEncodeSet", &number) == B_OK)
+			fSidebar->setUrlEncodeSet(number);
+		if (settings.FindInt32("base64Variant", &number) == B_OK)
+			fSidebar->setBase64Variant(number);
+
+		_UpdateSearchTerm();
 	}
 
 	// Restore last file if "Restore session"
@@ -791,14 +896,42 @@ MainWindow::_RestoreValues(BMessage& settings)
 }
 
 
+// Keeps the text in the session journal from now on. Unless it was just
+// restored from the journal, the journal starts over from the current text.
+void
+MainWindow::_StartJournal(bool restored)
+{
+	if (fJournal->Start() != B_OK)
+		return;
+
+	if (!restored)
+		fJournal->Reset(fTextView->Text(), fTextView->TextLength());
+	fTextView->SetJournal(fJournal);
+}
+
+
+void
+MainWindow::_StopJournal()
+{
+	fTextView->SetJournal(nullptr);
+	fJournal->Stop();
+	fJournal->Clear();
+}
+
+
 void
 MainWindow::_ApplySettings(const BMessage& msg)
 {
 	bool flag;
 	int32 number;
 	BString text;
-	if (msg.FindBool("saveText", &flag) == B_OK)
+	if (msg.FindBool("saveText", &flag) == B_OK && flag != fSaveTextOnExit) {
 		fSaveTextOnExit = flag;
+		if (flag)
+			_StartJournal(false);
+		else
+			_StopJournal();
+	}
 
 	if (msg.FindBool("saveSettings", &flag) == B_OK)
 		fSaveFieldsOnExit = flag;
@@ -821,6 +954,9 @@ MainWindow::_ApplySettings(const BMessage& msg)
 	if (msg.FindBool("askToSave", &flag) == B_OK)
 		fAskToSave = flag;
 
+	if (msg.FindInt32("statsWordCount", &number) == B_OK)
+		fStatsWordCount = number;
+
 	// Apply font to the textView
 	BFont newFont(be_fixed_font); // Default fallback
 	if (!fFontFamily.IsEmpty() || fFontFamily != "System default")
@@ -855,12 +991,206 @@ MainWindow::_UpdateStatusBar()
 	statusText.SetToFormat(B_TRANSLATE_COMMENT("%d:%d | Chars: %d | Words: %d | Lines: %d",
 							   "Statusbar text - only change Chars, Words and Lines"),
 		row, col, charCount, wordCount, lineCount);
+	int32 matchCount = fTextView->CountMatches();
+	if (matchCount > 0) {
+		BString matchText;
+		int32 current = fTextView->CurrentMatchIndex();
+		if (current >= 0)
+			matchText.SetToFormat(B_TRANSLATE("Match %d of %d"), current + 1, matchCount);
+		else
+			matchText.SetToFormat(B_TRANSLATE("Matches: %d"), matchCount);
+		statusText << " | " << matchText;
+	}
 	if (IsDocumentModified())
 		statusText << " | " << B_TRANSLATE("Modified");
 	fStatusBar->SetText(statusText.String());
 }
 
 
+void
+MainWindow::_RunTransform(uint32 what, BTextView* textView)
+{
+	switch (what) {
+		case M_TRANSFORM_UPPERCASE:
+			ConvertToUppercase(textView);
+			break;
+		case M_TRANSFORM_LOWERCASE:
+			ConvertToLowercase(textView);
+			break;
+		case M_TRANSFORM_CAPITALIZE:
+			Capitalize(textView);
+			break;
+		case M_TRANSFORM_TITLE_CASE:
+			ConvertToTitlecase(textView);
+			break;
+		case M_TRANSFORM_RANDOM_CASE:
+			ConvertToRandomCase(textView);
+			break;
+		case M_TRANSFORM_ALTERNATING_CASE:
+			ConvertToAlternatingCase(textView);
+			break;
+		case M_TRANSFORM_TOGGLE_CASE:
+			ToggleCase(textView);
+			break;
+		case M_REMOVE_LINE_BREAKS_DEFAULT:
+			RemoveLineBreaks(textView);
+			break;
+		case M_REMOVE_LINE_BREAKS:
+			if (fSidebar->getBreakMode() == BREAK_REMOVE_ALL) {
+				RemoveLineBreaks(textView);
+			} else if (fSidebar->getBreakMode() == BREAK_ON) {
+				BreakLinesOnDelimiter(textView, fSidebar->getBreakModeInput(),
+					fSidebar->getKeepDelimiterValue());
+			} else if (fSidebar->getBreakMode() == BREAK_REPLACE) {
+				RemoveLineBreaks(textView, fSidebar->getBreakModeInput());
+			} else if (fSidebar->getBreakMode() == BREAK_AFTER_CHARS) {
+				InsertLineBreaks(textView, fSidebar->getBreakOnCharsSpinner(),
+					fSidebar->getSplitOnWords());
+			}
+			break;
+		case M_TRIM_LINES:
+			TrimWhitespace(textView);
+			break;
+		case M_TRANSFORM_REPLACE:
+			ReplaceAll(textView, fSidebar->getSearchText(), fSidebar->getReplaceText(),
+				fSidebar->getReplaceCaseSensitive(), fSidebar->getReplaceFullWords(),
+				fSidebar->getReplaceRegex());
+			break;
+		case M_TRANSFORM_BATCH_REPLACE:
+			BatchReplace(textView, fSidebar->getBatchPairs(), fSidebar->getBatchCaseSensitive());
+			break;
+		case M_TRIM_EMPTY_LINES:
+			TrimEmptyLines(textView);
+			break;
+		case M_TRANSFORM_PREFIX_SUFFIX:
+			AddStringsToEachLine(textView, fSidebar->getPrefixText(), fSidebar->getSuffixText());
+			break;
+		case M_TRANSFORM_REMOVE_PREFIX_SUFFIX:
+			RemoveStringsFromEachLine(textView, fSidebar->getPrefixText(),
+				fSidebar->getSuffixText());
+			break;
+		case M_TRANSFORM_ROT13:
+			ConvertToROT13(textView);
+			break;
+		case M_TRANSFORM_ENCODE_URL:
+			URLEncode(textView, (UrlEncodeSet)fSidebar->getUrlEncodeSet());
+			break;
+		case M_TRANSFORM_DECODE_URL:
+			URLDecode(textView, (UrlEncodeSet)fSidebar->getUrlEncodeSet());
+			break;
+		case M_TRANSFORM_BASE64:
+			Base64(textView, (Base64Variant)fSidebar->getBase64Variant());
+			break;
+		case M_TRANSFORM_HTML_ENCODE_NAME:
+			EncodeHTMLEntities(textView, true);
+			break;
+		case M_TRANSFORM_HTML_ENCODE_NUM:
+			EncodeHTMLEntities(textView, false);
+			break;
+		case M_TRANSFORM_HTML_DECODE:
+			DecodeHTMLEntities(textView);
+			break;
+		case M_SORT_LINES:
+		{
+			bool sortAlphabetically = fSidebar->getAlphaSortRadio();
+			bool sortAscending = fSidebar->getSortAsc();
+			bool caseSensitive = fSidebar->getCaseSortCheck();
+
+			if (sortAlphabetically)
+				SortLines(textView, sortAscending, caseSensitive);
+			else
+				SortLinesByLength(textView, sortAscending, caseSensitive);
+			break;
+		}
+		case M_INDENT_LINES:
+			IndentLines(textView, fSidebar->getTabsRadio(), fSidebar->getIndentSpinner());
+			break;
+		case M_UNINDENT_LINES:
+			UnindentLines(textView, fSidebar->getTabsRadio(), fSidebar->getIndentSpinner());
+			break;
+		case M_REMOVE_DUPLICATES:
+			RemoveDuplicateLines(textView);
+			break;
+	}
+}
+
+
+void
+MainWindow::_ClearUsedFields(uint32 what)
+{
+	if (!fClearSettingsAfterUse)
+		return;
+
+	switch (what) {
+		case M_REMOVE_LINE_BREAKS:
+			fSidebar->setBreakModeInput("");
+			break;
+		case M_TRANSFORM_REPLACE:
+			fSidebar->setSearchText("");
+			fSidebar->setReplaceText("");
+			fSidebar->setReplaceCaseSensitive(false);
+			fSidebar->setReplaceFullWords(false);
+			fSidebar->setReplaceRegex(false);
+			_UpdateSearchTerm();
+			break;
+		case M_TRANSFORM_PREFIX_SUFFIX:
+		case M_TRANSFORM_REMOVE_PREFIX_SUFFIX:
+			fSidebar->setPrefixText("");
+			fSidebar->setSuffixText("");
+			break;
+	}
+}
+
+
+void
+MainWindow::_PreviewTransform(uint32 what)
+{
+	fPreview.Run(fTextView, [this, what](BTextView* shadow) { _RunTransform(what, shadow); });
+	fPreviewWhat = what;
+
+	if (!fPreviewWindow) {
+		fPreviewWindow = new PreviewWindow(BMessenger(this));
+		fPreviewWindow->CenterIn(Frame());
+	}
+
+	if (fPreviewWindow->LockLooper()) {
+		fPreviewWindow->SetPreview(fPreview);
+		if (fPreviewWindow->IsHidden())
+			fPreviewWindow->Show();
+		fPreviewWindow->Activate();
+		fPreviewWindow->UnlockLooper();
+	}
+}
+
+
+void
+MainWindow::_ShowNGrams()
+{
+	if (!fNGramWindow) {
+		fNGramWindow = new NGramWindow();
+		fNGramWindow->CenterIn(Frame());
+	}
+
+	if (fNGramWindow->LockLooper()) {
+		fNGramWindow->SetText(fTextView->Text(), fTextView->TextLength());
+		if (fNGramWindow->IsHidden())
+			fNGramWindow->Show();
+		fNGramWindow->Activate();
+		fNGramWindow->UnlockLooper();
+	}
+}
+
+
+void
+MainWindow::_UpdateSearchTerm()
+{
+	// Regular expressions are only evaluated on replace, so they are not highlighted
+	BString term = fSidebar->getReplaceRegex() ? BString() : fSidebar->getSearchText();
+	fTextView->SetSearchTerm(term, fSidebar->getReplaceCaseSensitive(),
+		fSidebar->getReplaceFullWords());
+}
+
+
 void
 MainWindow::_UpdateStatusMessage(BString message)
 {
@@ -894,30 +1224,8 @@ MainWindow::OpenFile(const entry_ref& ref)
 	if (nodeInfo.GetType(mimeType) == B_OK && strncmp(mimeType, "text/", 5) == 0)
 		isText = true;
 
-	if (!isText) {
-		const off_t kMaxCheckSize = 1024;
-		off_t fileSize;
-		if (file.GetSize(&fileSize) == B_OK) {
-			uint8 buffer[kMaxCheckSize];
-			ssize_t bytesRead = file.ReadAt(0, buffer, std::min(fileSize, kMaxCheckSize));
-			if (bytesRead > 0) {
-
-				// Count non-printable characters
-				int nonPrintable = 0;
-				for (ssize_t i = 0; i < bytesRead; ++i) {
-					char c = buffer[i];
-					if ((c < 32 || c > 126) && c != '\n' && c != '\r' && c != '\t') {
-						if (++nonPrintable > 10)
-							break;
-					}
-				}
-				if (nonPrintable <= 10) {
-					isText = true;
-				}
-			}
-		}
-	}
-
+	if (!isText)
+		isText = IsProbablyText(file);
 
 	if (!isText) {
 		(new BAlert("Error", B_TRANSLATE("The selected file is not a recognized text file."),
@@ -926,41 +1234,228 @@ MainWindow::OpenFile(const entry_ref& ref)
 		return;
 	}
 
-	fTextView->SetText("");
+	BPath path(&realRef);
+	_CancelLoading();
 
-	if (BTranslationUtils::GetStyledText(&file, fTextView) == B_OK) {
-		BPath path(&realRef);
-		fFilePath = path.Path();
-	} else {
+	// Style runs are only needed by a stylable view, and only the
+	// translation kit reads them
+	attr_info info;
+	if (fTextView->IsStylable() && node.GetAttrInfo("styles", &info) == B_OK) {
+		_OpenWithTranslator(path.Path());
+		return;
+	}
+
+	fLoader = new TextFileLoader(path.Path(), BMessenger(this), ++fLoadID);
+	if (fLoader->Start() != B_OK) {
+		delete fLoader;
+		fLoader = nullptr;
+		_OpenWithTranslator(path.Path());
+		return;
+	}
+
+	// The document is replaced when the file is loaded, edits until then
+	// would be lost
+	fTextView->MakeEditable(false);
+	_UpdateStatusMessage(B_TRANSLATE("Opening file" B_UTF8_ELLIPSIS));
+}
+
+
+// Stops a file still being loaded, so it does not replace the document once it
+// is read. Its messages no longer match the load ID.
+void
+MainWindow::_CancelLoading()
+{
+	if (fLoader == nullptr)
+		return;
+
+	delete fLoader;
+	fLoader = nullptr;
+	fLoadID++;
+	fTextView->MakeEditable(true);
+}
+
+
+void
+MainWindow::_FinishLoading()
+{
+	TextFileLoader* loader = fLoader;
+	fLoader = nullptr;
+	fTextView->MakeEditable(true);
+
+	switch (loader->Status()) {
+		case B_OK:
+		{
+			fTextView->LoadText(loader->Text(), loader->TextLength());
+			fFilePath = loader->Path();
+			fEncoding = loader->Encoding();
+			fCompression = loader->GetCompression();
+			fLastSavedText.SetTo(fTextView->Text(), fTextView->TextLength());
+
+			// Tell how the file was read when it is not plain UTF-8
+			BString details;
+			if (fCompression.format != COMPRESSION_NONE)
+				details.SetToFormat(B_TRANSLATE("%s compressed"), fCompression.Name());
+			if (!fEncoding.IsUTF8()) {
+				if (!details.IsEmpty())
+					details << ", ";
+				details << fEncoding.name;
+			}
+
+			const char* lineEndings = NULL;
+			switch (loader->GetLineEndings()) {
+				case LINE_ENDINGS_CRLF:
+					lineEndings = B_TRANSLATE("Windows (CR LF) line endings");
+					break;
+				case LINE_ENDINGS_CR:
+					lineEndings = B_TRANSLATE("classic Mac OS (CR) line endings");
+					break;
+				case LINE_ENDINGS_MIXED:
+					lineEndings = B_TRANSLATE("mixed line endings");
+					break;
+				default:
+					break;
+			}
+			if (lineEndings != NULL) {
+				if (!details.IsEmpty())
+					details << ", ";
+				details << lineEndings;
+			}
+
+			BString status;
+			if (!details.IsEmpty())
+				status.SetToFormat(B_TRANSLATE("Opened: %s"), details.String());
+			_UpdateStatusMessage(status);
+			_UpdateWindowTitle();
+			break;
+		}
+		case B_CANCELED:
+			_UpdateStatusMessage(B_TRANSLATE("Opening the file was cancelled"));
+			break;
+		case B_FILE_TOO_LARGE:
+			_UpdateStatusMessage("");
+			(new BAlert("Error", B_TRANSLATE("The selected file is too large to open."),
+				 B_TRANSLATE("OK")))
+				->Go();
+			break;
+		default:
+			_UpdateStatusMessage("");
+			if (loader->GetCompression().format != COMPRESSION_NONE) {
+				(new BAlert("Error", B_TRANSLATE("The compressed file is damaged."),
+					 B_TRANSLATE("OK")))
+					->Go();
+				break;
+			}
+			// Files the loader cannot read go through the translation kit
+			_OpenWithTranslator(loader->Path().String());
+			break;
+	}
+
+	delete loader;
+}
+
+
+void
+MainWindow::_OpenWithTranslator(const char* path)
+{
+	// Read into a view of its own, so the document is replaced in one go
+	BFile file(path, B_READ_ONLY);
+	BTextView styledView("styled text");
+	styledView.SetStylable(true);
+	if (file.InitCheck() == B_OK && BTranslationUtils::GetStyledText(&file, &styledView) == B_OK)
+		fFilePath = path;
+	else {
+		styledView.SetText("");
 		fFilePath = "";
 	}
-	fTextView->ClearHistory();
-	fLastSavedText = fTextView->Text();
+
+	int32 runLength;
+	text_run_array* runs = styledView.RunArray(0, styledView.TextLength(), &runLength);
+	fTextView->LoadText(styledView.Text(), styledView.TextLength(), runs);
+	BTextView::FreeRunArray(runs);
+	fEncoding = TextEncoding();
+	fCompression = Compression();
+	fLastSavedText.SetTo(fTextView->Text(), fTextView->TextLength());
 	_UpdateWindowTitle();
 }
 
 
+// Saves a snapshot of the text on a background thread, so typing goes on
+// while a large file is written. The file is replaced only once the new
+// contents are complete.
 status_t
-MainWindow::SaveFile(const char* path)
+MainWindow::SaveFile(const char* path, const Compression& compression)
 {
-	BFile file;
-	status_t result = file.SetTo(path, B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
-	if (result != B_OK)
-		return result;
+	if (fSaver != nullptr) {
+		_UpdateStatusMessage(B_TRANSLATE("The file is still being saved"));
+		return B_BUSY;
+	}
 
-	result = BTranslationUtils::WriteStyledEditFile(fTextView, &file);
-	if (result != B_OK)
-		return result;
+	// Replace the file a link points to, not the link
+	BString realPath = path;
+	BEntry entry(path, true);
+	BPath resolved;
+	if (entry.Exists() && entry.GetPath(&resolved) == B_OK)
+		realPath = resolved.Path();
+
+	BString text(fTextView->Text(), fTextView->TextLength());
+	fSaver = new TextFileSaver(realPath.String(), text, fEncoding, compression,
+		BMessenger(this));
+	status_t status = fSaver->Start();
+	if (status != B_OK) {
+		delete fSaver;
+		fSaver = nullptr;
+		return status;
+	}
 
-	fFilePath = path;
+	_UpdateStatusMessage(B_TRANSLATE("Saving file" B_UTF8_ELLIPSIS));
+	return B_OK;
+}
+
+
+void
+MainWindow::_FinishSaving()
+{
+	TextFileSaver* saver = fSaver;
+	fSaver = nullptr;
+
+	status_t status = saver->Status();
+	if (status != B_OK) {
+		delete saver;
+		delete fPendingMessage;
+		fPendingMessage = nullptr;
+		fPendingQuitAfterSave = false;
+
+		_UpdateStatusMessage("");
+		BString text;
+		text.SetToFormat(B_TRANSLATE("Could not save the file:\n%s"), strerror(status));
+		(new BAlert("Error", text.String(), B_TRANSLATE("OK"), NULL, NULL, B_WIDTH_AS_USUAL,
+			B_STOP_ALERT))
+			->Go();
+		return;
+	}
+
+	BString statusMsg(B_TRANSLATE("File saved"));
+	if (saver->Encoding().name != fEncoding.name) {
+		statusMsg.SetToFormat(B_TRANSLATE("Saved as UTF-8, the text has characters that %s "
+			"cannot hold"), fEncoding.name.String());
+	} else if (saver->GetCompression().format == COMPRESSION_ZSTD
+		|| saver->GetCompression().format == COMPRESSION_XZ) {
+		// Their files do not tell the level they were compressed with
+		statusMsg.SetToFormat(B_TRANSLATE("File saved, %s compressed at the default level"),
+			saver->GetCompression().Name());
+	}
 
-	BNodeInfo nodeInfo(&file);
-	nodeInfo.SetType("text/plain");
+	fFilePath = saver->Path();
+	fEncoding = saver->Encoding();
+	fCompression = saver->GetCompression();
+	fLastSavedText = saver->Text();
+	delete saver;
 
-	fLastSavedText = fTextView->Text();
+	_UpdateStatusMessage(statusMsg);
 	_UpdateWindowTitle();
 	_OnSaveComplete();
-	return B_OK;
+	if (fPendingQuitAfterSave)
+		be_app->PostMessage(B_QUIT_REQUESTED);
 }
 
 
@@ -1107,8 +1602,9 @@ MainWindow::IsDocumentModified() const
 	if (!fTextView)
 		return false;
 
-	BString currentText = fTextView->Text();
-	return currentText != fLastSavedText;
+	// Compare in place, copying the document would take as long again
+	return fTextView->TextLength() != fLastSavedText.Length()
+		|| memcmp(fTextView->Text(), fLastSavedText.String(), fLastSavedText.Length()) != 0;
 }
 
 void
@@ -1117,10 +1613,15 @@ MainWindow::DispatchMessage(BMessage* message, BHandler* target)
 	if (message->what == B_KEY_DOWN) {
 		const char* bytes;
 
-		if (message->FindString("bytes", &bytes) == B_OK
-			&& bytes[0] == B_ESCAPE && fCloseOnEsc) {
-			PostMessage(B_QUIT_REQUESTED);
-			return;
+		if (message->FindString("bytes", &bytes) == B_OK && bytes[0] == B_ESCAPE) {
+			if (fLoader != nullptr) {
+				PostMessage(M_FILE_CANCEL_LOAD);
+				return;
+			}
+			if (fCloseOnEsc) {
+				PostMessage(B_QUIT_REQUESTED);
+				return;
+			}
 		}
 	}
 
@@ -1134,6 +1635,15 @@ MainWindow::DispatchMessage(BMessage* message, BHandler* target)
 bool
 MainWindow::_CheckSaveAndContinue(BMessage* pendingMessage)
 {
+    if (fSaver != nullptr) {
+        // Go on once the running save is done
+        if (pendingMessage) {
+            delete fPendingMessage;
+            fPendingMessage = new BMessage(*pendingMessage);
+        }
+        return false;
+    }
+
     if (!IsDocumentModified() || !fAskToSave)
         return true;
 
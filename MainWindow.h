@@ -1,7 +1,11 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include "Compression.h"
 #include "Sidebar.h"
+#include "TextEncoding.h"
+#include "TextPreview.h"
+#include "TextStats.h"
 #include "UndoableTextView.h"
 #include <Application.h>
 #include <Bitmap.h>
@@ -15,6 +19,12 @@
 #include <Window.h>
 #include <private/shared/ToolBar.h>
 
+class NGramWindow;
+class SessionJournal;
+class TextFileLoader;
+class TextFileSaver;
+class PreviewWindow;
+
 class MainWindow : public BWindow {
 public:
 	MainWindow(void);
@@ -26,7 +36,7 @@ public:
 	bool QuitRequested(void);
 
 	void OpenFile(const entry_ref& ref);
-	status_t SaveFile(const char* path);
+	status_t SaveFile(const char* path, const Compression& compression);
 	void MenusBeginning();
 	void _ApplySettings(const BMessage& msg);
 	void DispatchMessage(BMessage* message, BHandler* target);
@@ -38,6 +48,15 @@ private:
 	Sidebar* fSidebar;
 	void _UpdateStatusBar();
 	void _UpdateStatusMessage(BString message);
+	void _UpdateSearchTerm();
+	void _RunTransform(uint32 what, BTextView* textView);
+	void _ClearUsedFields(uint32 what);
+	void _PreviewTransform(uint32 what);
+	void _ShowNGrams();
+	void _CancelLoading();
+	void _FinishLoading();
+	void _OpenWithTranslator(const char* path);
+	void _FinishSaving();
 	void _UpdateToolbarState();
 	void _UpdateWindowTitle();
 	bool _ClipboardHasText() const;
@@ -50,12 +69,16 @@ private:
 	int32 fFontSize;
 	bool fCloseOnEsc;
 	bool fAskToSave;
+	int32 fStatsWordCount;
 	BString fFontFamily;
 	status_t _LoadSettings(BMessage& settings);
 	status_t _SaveSettings();
 	void _RestoreValues(BMessage& settings);
+	void _StartJournal(bool restored);
+	void _StopJournal();
 
 	UndoableTextView* fTextView;
+	SessionJournal* fJournal;
 	BScrollView* fScrollView;
 	BStringView* fStatusBar;
 	BStringView* fMessageBar;
@@ -65,8 +88,21 @@ private:
 	BMenuItem* fSaveMenuItem;
 	BFilePanel* fOpenPanel;
 	BFilePanel* fSavePanel;
+	BFilePanel* fBatchPanel;
+	BFilePanel* fWordFrequencyPanel;
+	WordFrequency fWordList; // Counted by the statistics, until exported
 	BString fFilePath;
+	TextEncoding fEncoding;
+	Compression fCompression;
 	BWindow* fSettingsWindow;
+	PreviewWindow* fPreviewWindow;
+	NGramWindow* fNGramWindow;
+	TextFileLoader* fLoader;
+	TextFileSaver* fSaver;
+	int32 fLoadID;
+	TransformPreview fPreview;
+	uint32 fPreviewWhat;
+	bool fPreviewChanges;
 
 	BMenuItem* fUndoItem;
 	BMenuItem* fRedoItem;
@@ -74,6 +110,7 @@ private:
 	BMenuItem* fCopyItem;
 	BMenuItem* fPasteItem;
 	BMenuItem* fSelectAllItem;
+	BMenuItem* fPreviewItem;
 
 	BString fLastSavedText;
 	bool IsDocumentModified() const;
@@ -0,0 +1,442 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "NGramIndex.h"
+#include "TextBuilder.h"
+#include "TextStats.h"
+
+#include <DataIO.h>
+#include <OS.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <unicode/brkiter.h>
+#include <unicode/locid.h>
+#include <unicode/uchar.h>
+#include <unicode/utext.h>
+#include <unicode/utf8.h>
+
+static const int32 kMaxNGramSize = 5;
+static const size_t kInitialSlots = 1024;
+static const size_t kBlockSize = 1024 * 1024;
+static const size_t kWriteBufferSize = 64 * 1024;
+
+
+static inline uint32
+_HashNGram(const char* text, size_t length)
+{
+	// FNV-1a
+	uint32 hash = 2166136261u;
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ (uint8)text[i]) * 16777619u;
+	return hash;
+}
+
+
+static bool
+_MoreFrequent(const NGramCount& a, const NGramCount& b)
+{
+	if (a.count != b.count)
+		return a.count > b.count;
+	return a.text < b.text;
+}
+
+
+// Returns where a block of text ends, preferably behind a line break, so
+// neither words nor characters are cut in two.
+static size_t
+_BlockEnd(const char* text, size_t length)
+{
+	for (size_t i = length; i > 0; i--) {
+		if (text[i - 1] == '\n')
+			return i;
+	}
+	for (size_t i = length; i > 0; i--) {
+		if (text[i - 1] == ' ' || text[i - 1] == '\t')
+			return i;
+	}
+	// Cut before the last character, which may be incomplete
+	size_t end = length - 1;
+	while (end > 0 && ((uint8)text[end] & 0xc0) == 0x80)
+		end--;
+	return end > 0 ? end : length;
+}
+
+
+//	#pragma mark - NGramCounter
+
+
+NGramCounter::NGramCounter(size_t capacity)
+	:
+	fCapacity(std::max(capacity, (size_t)1)),
+	fTotal(0),
+	fEvicted(false)
+{
+}
+
+
+void
+NGramCounter::Add(const char* text, size_t length)
+{
+	uint32 hash = _HashNGram(text, length);
+	fTotal++;
+
+	int32 index = _Find(text, length, hash);
+	if (index >= 0) {
+		fEntries[index].count++;
+		_SiftDown(fEntries[index].heapIndex);
+		return;
+	}
+
+	if (fEntries.size() < fCapacity) {
+		index = fEntries.size();
+		Entry& entry = fEntries.emplace_back();
+		entry.text.assign(text, length);
+		entry.hash = hash;
+		entry.count = 1;
+		entry.error = 0;
+		_Insert(index);
+
+		// No entry has a lower count, so the new one goes to the top
+		entry.heapIndex = fHeap.size();
+		fHeap.push_back(index);
+		for (int32 i = entry.heapIndex; i > 0 && fEntries[fHeap[(i - 1) / 2]].count > 1;) {
+			int32 parent = (i - 1) / 2;
+			std::swap(fHeap[i], fHeap[parent]);
+			fEntries[fHeap[i]].heapIndex = i;
+			fEntries[fHeap[parent]].heapIndex = parent;
+			i = parent;
+		}
+		return;
+	}
+
+	// Replace the least frequent n-gram, whose count becomes the error
+	fEvicted = true;
+	index = fHeap[0];
+	Entry& entry = fEntries[index];
+	_Remove(index);
+	entry.text.assign(text, length);
+	entry.hash = hash;
+	entry.error = entry.count;
+	entry.count++;
+	_Insert(index);
+	_SiftDown(0);
+}
+
+
+void
+NGramCounter::GetTopNGrams(size_t count, std::vector<NGramCount>& ngrams) const
+{
+	ngrams.clear();
+	ngrams.reserve(fEntries.size());
+	for (const Entry& entry : fEntries)
+		ngrams.push_back({std::string_view(entry.text), entry.count, entry.error});
+
+	count = std::min(count, ngrams.size());
+	std::partial_sort(ngrams.begin(), ngrams.begin() + count, ngrams.end(), _MoreFrequent);
+	ngrams.resize(count);
+}
+
+
+int32
+NGramCounter::_Find(const char* text, size_t length, uint32 hash) const
+{
+	if (fSlots.empty())
+		return -1;
+
+	size_t mask = fSlots.size() - 1;
+	for (size_t i = hash & mask; fSlots[i] >= 0; i = (i + 1) & mask) {
+		const Entry& entry = fEntries[fSlots[i]];
+		if (entry.hash == hash && entry.text.length() == length
+			&& memcmp(entry.text.data(), text, length) == 0) {
+			return fSlots[i];
+		}
+	}
+	return -1;
+}
+
+
+void
+NGramCounter::_Insert(int32 index)
+{
+	// Keep the table at most half full. Growing it inserts all entries,
+	// including this one.
+	if (fEntries.size() * 2 > fSlots.size()) {
+		size_t size = std::max(fSlots.size() * 2, kInitialSlots);
+		fSlots.assign(size, -1);
+		for (size_t i = 0; i < fEntries.size(); i++)
+			_Insert(i);
+		return;
+	}
+
+	size_t mask = fSlots.size() - 1;
+	size_t i = fEntries[index].hash & mask;
+	while (fSlots[i] >= 0)
+		i = (i + 1) & mask;
+	fSlots[i] = index;
+}
+
+
+void
+NGramCounter::_Remove(int32 index)
+{
+	size_t mask = fSlots.size() - 1;
+	size_t i = fEntries[index].hash & mask;
+	while (fSlots[i] != index)
+		i = (i + 1) & mask;
+
+	// Shift the following entries back into the hole, unless that would move
+	// them before their home slot, so no tombstones are needed
+	for (size_t j = (i + 1) & mask; fSlots[j] >= 0; j = (j + 1) & mask) {
+		size_t home = fEntries[fSlots[j]].hash & mask;
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			fSlots[i] = fSlots[j];
+			i = j;
+		}
+	}
+	fSlots[i] = -1;
+}
+
+
+void
+NGramCounter::_SiftDown(int32 heapIndex)
+{
+	int32 size = fHeap.size();
+	int32 i = heapIndex;
+	for (;;) {
+		int32 smallest = i;
+		int32 left = 2 * i + 1;
+		int32 right = left + 1;
+		if (left < size && fEntries[fHeap[left]].count < fEntries[fHeap[smallest]].count)
+			smallest = left;
+		if (right < size && fEntries[fHeap[right]].count < fEntries[fHeap[smallest]].count)
+			smallest = right;
+		if (smallest == i)
+			break;
+
+		std::swap(fHeap[i], fHeap[smallest]);
+		fEntries[fHeap[i]].heapIndex = i;
+		fEntries[fHeap[smallest]].heapIndex = smallest;
+		i = smallest;
+	}
+}
+
+
+//	#pragma mark - NGramScanner
+
+
+NGramScanner::NGramScanner(NGramKind kind, int32 size, size_t capacity)
+	:
+	fKind(kind),
+	fSize(std::min(std::max(size, (int32)1), kMaxNGramSize)),
+	fCounter(capacity),
+	fLineBreaks(0)
+{
+	UErrorCode status = U_ZERO_ERROR;
+	fWordIterator.reset(
+		icu::BreakIterator::createWordInstance(icu::Locale::getDefault(), status));
+	if (U_FAILURE(status))
+		fWordIterator.reset();
+}
+
+
+NGramScanner::~NGramScanner()
+{
+}
+
+
+status_t
+NGramScanner::InitCheck() const
+{
+	return fWordIterator ? B_OK : B_NO_INIT;
+}
+
+
+status_t
+NGramScanner::Add(const char* text, size_t length, int32* cancelled)
+{
+	// The break iterator works with 32 bit offsets
+	for (size_t offset = 0; offset < length;) {
+		if (cancelled != nullptr && atomic_get(cancelled) != 0)
+			return B_CANCELED;
+
+		size_t end = length - offset;
+		if (end > kBlockSize)
+			end = _BlockEnd(text + offset, kBlockSize);
+
+		status_t status = _AddBlock(text + offset, end);
+		if (status != B_OK)
+			return status;
+		offset += end;
+	}
+	return B_OK;
+}
+
+
+// Reads the input in blocks, so files larger than memory only take as much of
+// it as the block and the bounded counter need.
+status_t
+NGramScanner::AddStream(BDataIO* input)
+{
+	std::unique_ptr<char[]> buffer(new(std::nothrow) char[kBlockSize]);
+	if (!buffer)
+		return B_NO_MEMORY;
+
+	size_t length = 0;
+	for (;;) {
+		ssize_t bytesRead = input->Read(buffer.get() + length, kBlockSize - length);
+		if (bytesRead < 0)
+			return bytesRead;
+		if (bytesRead == 0)
+			break;
+
+		length += bytesRead;
+		if (length < kBlockSize)
+			continue;
+
+		size_t end = _BlockEnd(buffer.get(), length);
+		status_t status = _AddBlock(buffer.get(), end);
+		if (status != B_OK)
+			return status;
+		memmove(buffer.get(), buffer.get() + end, length - end);
+		length -= end;
+	}
+
+	return _AddBlock(buffer.get(), length);
+}
+
+
+status_t
+NGramScanner::_AddBlock(const char* text, size_t length)
+{
+	if (!fWordIterator)
+		return B_NO_INIT;
+	if (length == 0)
+		return B_OK;
+
+	UErrorCode status = U_ZERO_ERROR;
+	UText* utext = utext_openUTF8(nullptr, text, length, &status);
+	fWordIterator->setText(utext, status);
+	if (U_FAILURE(status)) {
+		utext_close(utext);
+		return B_ERROR;
+	}
+
+	int32 start = fWordIterator->first();
+	for (int32 end = fWordIterator->next(); end != icu::BreakIterator::DONE;
+		start = end, end = fWordIterator->next()) {
+		int32 wordStart = -1;
+		UChar32 first = 0;
+		for (int32 i = start; i < end;) {
+			int32 characterStart = i;
+			UChar32 c;
+			U8_NEXT(text, i, end, c);
+			if (c == '\n')
+				fLineBreaks++;
+			else if (!u_isUWhiteSpace(c)) {
+				wordStart = characterStart;
+				first = c;
+				break;
+			}
+		}
+
+		if (wordStart < 0) {
+			// An empty line ends the phrase
+			if (fLineBreaks > 1)
+				fWords.clear();
+			continue;
+		}
+
+		fLineBreaks = 0;
+		if (first >= 0x30 && u_isalnum(first))
+			_AddWord(text + wordStart, end - wordStart);
+		else
+			fWords.clear();
+	}
+
+	utext_close(utext);
+	return B_OK;
+}
+
+
+void
+NGramScanner::_AddWord(const char* word, size_t length)
+{
+	FoldWordCase(word, length, fWord);
+	if (fKind == NGRAM_CHARACTERS) {
+		_AddCharacters(fWord);
+		return;
+	}
+
+	// Rotate the strings rather than erasing the oldest, to keep their memory
+	if ((int32)fWords.size() < fSize)
+		fWords.emplace_back();
+	else
+		std::rotate(fWords.begin(), fWords.begin() + 1, fWords.end());
+	fWords.back().swap(fWord);
+
+	if ((int32)fWords.size() < fSize)
+		return;
+
+	fNGram.clear();
+	for (const std::string& phraseWord : fWords) {
+		if (!fNGram.empty())
+			fNGram += ' ';
+		fNGram += phraseWord;
+	}
+	fCounter.Add(fNGram.data(), fNGram.length());
+}
+
+
+void
+NGramScanner::_AddCharacters(const std::string& word)
+{
+	// The starts of the last characters, in a ring indexed by character count
+	int32 starts[kMaxNGramSize];
+	int32 count = 0;
+	int32 length = word.length();
+	for (int32 i = 0; i < length;) {
+		starts[count % fSize] = i;
+		U8_FWD_1(word.data(), i, length);
+		count++;
+		if (count >= fSize) {
+			int32 start = starts[(count - fSize) % fSize];
+			fCounter.Add(word.data() + start, i - start);
+		}
+	}
+}
+
+
+status_t
+WriteNGramsTSV(const NGramCounter& counter, BDataIO* output, size_t count)
+{
+	std::vector<NGramCount> ngrams;
+	counter.GetTopNGrams(count, ngrams);
+
+	// N-grams are made of words, which never contain tabs or line breaks
+	TextBuilder buffer(kWriteBufferSize);
+	buffer << "ngram\tcount\terror\n";
+	for (const NGramCount& ngram : ngrams) {
+		char numbers[48];
+		int length = snprintf(numbers, sizeof(numbers), "\t%" B_PRId64 "\t%" B_PRId64 "\n",
+			ngram.count, ngram.error);
+		buffer << ngram.text;
+		buffer.Append(numbers, length);
+
+		if ((size_t)buffer.Length() >= kWriteBufferSize) {
+			status_t status = buffer.InitCheck();
+			if (status == B_OK)
+				status = output->WriteExactly(buffer.View().data(), buffer.Length());
+			if (status != B_OK)
+				return status;
+			buffer.Clear();
+		}
+	}
+
+	if (buffer.InitCheck() != B_OK)
+		return buffer.InitCheck();
+	return output->WriteExactly(buffer.View().data(), buffer.Length());
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef NGRAM_INDEX_H
+#define NGRAM_INDEX_H
+
+#include <SupportDefs.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unicode/uversion.h>
+#include <vector>
+
+class BDataIO;
+
+U_NAMESPACE_BEGIN
+class BreakIterator;
+U_NAMESPACE_END
+
+enum NGramKind { NGRAM_CHARACTERS = 0, NGRAM_WORDS };
+
+struct NGramCount {
+	std::string_view text;
+	int64 count; // Never below the true count
+	int64 error; // The count exceeds the true count by at most this much
+};
+
+// Counts the most frequent n-grams in bounded memory with the Space-Saving
+// algorithm. Up to the capacity every n-gram is counted exactly. After that,
+// a new n-gram replaces the least frequent one and inherits its count as the
+// error, so any n-gram occurring more often than total / capacity times is
+// guaranteed to be kept.
+class NGramCounter {
+public:
+	NGramCounter(size_t capacity);
+
+	void Add(const char* text, size_t length);
+
+	size_t Capacity() const { return fCapacity; }
+	int64 CountTotal() const { return fTotal; }
+	int32 CountNGrams() const { return fEntries.size(); }
+	bool IsExact() const { return !fEvicted; }
+
+	// Most frequent n-grams first, ties in alphabetical order
+	void GetTopNGrams(size_t count, std::vector<NGramCount>& ngrams) const;
+
+private:
+	struct Entry {
+		std::string text;
+		uint32 hash;
+		int32 heapIndex;
+		int64 count;
+		int64 error;
+	};
+
+	int32 _Find(const char* text, size_t length, uint32 hash) const;
+	void _Insert(int32 entry);
+	void _Remove(int32 entry);
+	void _SiftDown(int32 heapIndex);
+
+	size_t fCapacity;
+	std::vector<Entry> fEntries;
+	std::vector<int32> fSlots; // Entry indices, open addressing
+	std::vector<int32> fHeap; // Entry indices, least frequent first
+	int64 fTotal;
+	bool fEvicted;
+};
+
+// Splits text into character or word n-grams and counts them. Text is fed in
+// blocks, which should end at line breaks; word n-grams continue across
+// blocks. Words are lowercased. Character n-grams are taken within words,
+// word n-grams within a run of words not interrupted by punctuation or an
+// empty line.
+class NGramScanner {
+public:
+	NGramScanner(NGramKind kind, int32 size, size_t capacity = 100000);
+	~NGramScanner();
+
+	status_t InitCheck() const;
+
+	// Gives up with B_CANCELED before the next block once *cancelled is set
+	status_t Add(const char* text, size_t length, int32* cancelled = nullptr);
+	status_t AddStream(BDataIO* input);
+
+	NGramKind Kind() const { return fKind; }
+	int32 Size() const { return fSize; }
+	const NGramCounter& Counter() const { return fCounter; }
+
+private:
+	status_t _AddBlock(const char* text, size_t length);
+	void _AddWord(const char* word, size_t length);
+	void _AddCharacters(const std::string& word);
+
+	NGramKind fKind;
+	int32 fSize;
+	NGramCounter fCounter;
+	std::unique_ptr<icu::BreakIterator> fWordIterator;
+	std::vector<std::string> fWords; // The last words, oldest first
+	std::string fWord;
+	std::string fNGram;
+	int32 fLineBreaks; // Consecutive line breaks since the last word
+};
+
+status_t WriteNGramsTSV(const NGramCounter& counter, BDataIO* output, size_t count = SIZE_MAX);
+
+#endif // NGRAM_INDEX_H
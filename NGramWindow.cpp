@@ -0,0 +1,337 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "NGramWindow.h"
+#include "NGramIndex.h"
+#include "TextUtils.h"
+#include <Button.h>
+#include <Catalog.h>
+#include <ColumnListView.h>
+#include <ColumnTypes.h>
+#include <File.h>
+#include <LayoutBuilder.h>
+#include <MenuField.h>
+#include <MenuItem.h>
+#include <NodeInfo.h>
+#include <Path.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "N-grams"
+
+enum {
+	M_NGRAM_OPTIONS_CHANGED = 'ngop',
+	M_NGRAM_EXPORT = 'ngex',
+	M_NGRAM_EXPORT_SELECTED = 'ngsl',
+	M_NGRAMS_COUNTED = 'ngct'
+};
+
+// The list shows the most frequent n-grams, the export has all counted ones
+static const size_t kMaxRows = 1000;
+
+
+// Counts the n-grams of a copy of the text on a thread of its own, and tells
+// the target with M_NGRAMS_COUNTED once it is done.
+class NGramTask {
+public:
+	NGramTask(const BString& text, NGramKind kind, int32 size, BMessenger target, int32 id);
+	~NGramTask();
+
+	status_t Start();
+	void Cancel();
+
+	status_t Status() const { return fStatus; }
+	NGramScanner* DetachScanner() { return fScanner.release(); }
+
+private:
+	static status_t _CountThread(void* data);
+
+	BString fText;
+	std::unique_ptr<NGramScanner> fScanner;
+	BMessenger fTarget;
+	int32 fID;
+	thread_id fThread;
+	int32 fCancelled;
+	status_t fStatus;
+};
+
+
+NGramTask::NGramTask(const BString& text, NGramKind kind, int32 size, BMessenger target,
+	int32 id)
+	:
+	fText(text),
+	fScanner(new(std::nothrow) NGramScanner(kind, size)),
+	fTarget(target),
+	fID(id),
+	fThread(-1),
+	fCancelled(0),
+	fStatus(B_NO_INIT)
+{
+}
+
+
+NGramTask::~NGramTask()
+{
+	Cancel();
+	if (fThread >= 0) {
+		status_t result;
+		wait_for_thread(fThread, &result);
+	}
+}
+
+
+status_t
+NGramTask::Start()
+{
+	if (!fScanner)
+		return B_NO_MEMORY;
+	if (fScanner->InitCheck() != B_OK)
+		return fScanner->InitCheck();
+
+	fThread = spawn_thread(_CountThread, "count n-grams", B_NORMAL_PRIORITY, this);
+	if (fThread < B_OK)
+		return fThread;
+
+	status_t status = resume_thread(fThread);
+	if (status != B_OK) {
+		kill_thread(fThread);
+		fThread = -1;
+	}
+	return status;
+}
+
+
+void
+NGramTask::Cancel()
+{
+	atomic_set(&fCancelled, 1);
+}
+
+
+status_t
+NGramTask::_CountThread(void* data)
+{
+	NGramTask* task = (NGramTask*)data;
+	task->fStatus = task->fScanner->Add(task->fText.String(), task->fText.Length(),
+		&task->fCancelled);
+
+	BMessage message(M_NGRAMS_COUNTED);
+	message.AddInt32("id", task->fID);
+	task->fTarget.SendMessage(&message);
+	return task->fStatus;
+}
+
+
+//	#pragma mark - NGramWindow
+
+
+NGramWindow::NGramWindow()
+	:
+	BWindow(BRect(150, 150, 550, 650), B_TRANSLATE("N-gram frequency"), B_TITLED_WINDOW,
+		B_NOT_MINIMIZABLE | B_AUTO_UPDATE_SIZE_LIMITS | B_CLOSE_ON_ESCAPE),
+	fTaskID(0)
+{
+	fKindMenu = new BMenu("NGramKind");
+	fKindMenu->AddItem(
+		new BMenuItem(B_TRANSLATE("Words"), new BMessage(M_NGRAM_OPTIONS_CHANGED)));
+	fKindMenu->AddItem(
+		new BMenuItem(B_TRANSLATE("Characters"), new BMessage(M_NGRAM_OPTIONS_CHANGED)));
+	fKindMenu->SetLabelFromMarked(true);
+	fKindMenu->SetRadioMode(true);
+	fKindMenu->ItemAt(0L)->SetMarked(true);
+	BMenuField* kindField = new BMenuField("NGramKindField", B_TRANSLATE("Count:"), fKindMenu);
+
+	fSizeMenu = new BMenu("NGramSize");
+	fSizeMenu->AddItem(
+		new BMenuItem(B_TRANSLATE("Bigrams"), new BMessage(M_NGRAM_OPTIONS_CHANGED)));
+	fSizeMenu->AddItem(
+		new BMenuItem(B_TRANSLATE("Trigrams"), new BMessage(M_NGRAM_OPTIONS_CHANGED)));
+	fSizeMenu->SetLabelFromMarked(true);
+	fSizeMenu->SetRadioMode(true);
+	fSizeMenu->ItemAt(0L)->SetMarked(true);
+	BMenuField* sizeField = new BMenuField("NGramSizeField", B_TRANSLATE("Size:"), fSizeMenu);
+
+	fListView = new BColumnListView("NGramList", 0, B_FANCY_BORDER, false);
+	fListView->AddColumn(new BStringColumn(B_TRANSLATE("N-gram"), 240, 50, 1000,
+		B_TRUNCATE_END), 0);
+	fListView->AddColumn(new BIntegerColumn(B_TRANSLATE("Count"), 80, 40, 200, B_ALIGN_RIGHT), 1);
+	fListView->SetSortColumn(fListView->ColumnAt(1), false, false);
+
+	fStatusView = new BStringView("NGramStatus", "");
+
+	BButton* exportButton = new BButton("Export",
+		B_TRANSLATE("Export TSV" B_UTF8_ELLIPSIS), new BMessage(M_NGRAM_EXPORT));
+
+	BMessenger messenger(this);
+	fExportPanel = new BFilePanel(B_SAVE_PANEL, &messenger, NULL, B_FILE_NODE, false,
+		new BMessage(M_NGRAM_EXPORT_SELECTED));
+	fExportPanel->SetSaveText("ngrams.tsv");
+
+	// clang-format off
+	BLayoutBuilder::Group<>(this, B_VERTICAL, B_USE_DEFAULT_SPACING)
+		.SetInsets(B_USE_WINDOW_INSETS)
+		.AddGroup(B_HORIZONTAL, B_USE_DEFAULT_SPACING)
+			.Add(kindField)
+			.Add(sizeField)
+			.AddGlue()
+		.End()
+		.Add(fListView, 1)
+		.AddGroup(B_HORIZONTAL, B_USE_DEFAULT_SPACING)
+			.Add(fStatusView)
+			.AddGlue()
+			.Add(exportButton)
+		.End();
+	// clang-format on
+}
+
+
+NGramWindow::~NGramWindow()
+{
+	delete fExportPanel;
+}
+
+
+// Only copies the text, the counting happens on a thread of its own. A count
+// still running for the previous text is cancelled.
+void
+NGramWindow::SetText(const char* text, int32 length)
+{
+	if (fTask)
+		fTask->Cancel();
+	fText.SetTo(text, length);
+	_Update();
+}
+
+
+void
+NGramWindow::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case M_NGRAM_OPTIONS_CHANGED:
+			_Update();
+			break;
+		case M_NGRAMS_COUNTED:
+		{
+			int32 id;
+			if (!fTask || message->FindInt32("id", &id) != B_OK || id != fTaskID)
+				break;
+
+			status_t status = fTask->Status();
+			if (status == B_OK)
+				fScanner.reset(fTask->DetachScanner());
+			fTask.reset();
+			if (status == B_OK)
+				_ShowNGrams();
+			else
+				fStatusView->SetText(B_TRANSLATE("Could not count n-grams"));
+			break;
+		}
+		case M_NGRAM_EXPORT:
+			fExportPanel->Show();
+			break;
+		case M_NGRAM_EXPORT_SELECTED:
+		{
+			entry_ref dir;
+			BString name;
+			if (message->FindRef("directory", &dir) == B_OK
+				&& message->FindString("name", &name) == B_OK) {
+				BPath path(&dir);
+				path.Append(name);
+				_Export(path.Path());
+			}
+			break;
+		}
+		default:
+			BWindow::MessageReceived(message);
+			break;
+	}
+}
+
+
+// Closing the window only hides it. The application asks from a thread of
+// its own when it quits, and then the window goes too.
+bool
+NGramWindow::QuitRequested()
+{
+	if (find_thread(NULL) != Thread())
+		return true;
+
+	if (!IsHidden())
+		Hide();
+	return false;
+}
+
+
+void
+NGramWindow::_Update()
+{
+	NGramKind kind = fKindMenu->IndexOf(fKindMenu->FindMarked()) == 1
+		? NGRAM_CHARACTERS : NGRAM_WORDS;
+	int32 size = fSizeMenu->IndexOf(fSizeMenu->FindMarked()) + 2;
+
+	fListView->Clear();
+	fScanner.reset();
+
+	// The previous task gives up after its current block
+	fTask.reset(new NGramTask(fText, kind, size, BMessenger(this), ++fTaskID));
+	if (fTask->Start() != B_OK) {
+		fTask.reset();
+		fStatusView->SetText(B_TRANSLATE("Could not count n-grams"));
+		return;
+	}
+	fStatusView->SetText(B_TRANSLATE("Counting n-grams" B_UTF8_ELLIPSIS));
+}
+
+
+void
+NGramWindow::_ShowNGrams()
+{
+	const NGramCounter& counter = fScanner->Counter();
+	std::vector<NGramCount> ngrams;
+	counter.GetTopNGrams(kMaxRows, ngrams);
+	for (const NGramCount& ngram : ngrams) {
+		BRow* row = new BRow();
+		row->SetField(new BStringField(BString(ngram.text.data(), ngram.text.length())), 0);
+		row->SetField(new BIntegerField(std::min(ngram.count, (int64)INT32_MAX)), 1);
+		fListView->AddRow(row);
+	}
+
+	BString status;
+	if (counter.IsExact()) {
+		status.SetToFormat(B_TRANSLATE("%" B_PRId32 " different n-grams, %" B_PRId64 " in total"),
+			counter.CountNGrams(), counter.CountTotal());
+	} else {
+		status.SetToFormat(B_TRANSLATE("Most frequent of %" B_PRId64 " n-grams, "
+			"counts are estimates"), counter.CountTotal());
+	}
+	fStatusView->SetText(status.String());
+}
+
+
+void
+NGramWindow::_Export(const char* path)
+{
+	if (!fScanner)
+		return;
+
+	BFile file;
+	status_t status = file.SetTo(path, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	if (status == B_OK)
+		status = WriteNGramsTSV(fScanner->Counter(), &file);
+	if (status != B_OK) {
+		SendStatusMessage(B_TRANSLATE("Could not write the n-gram list"));
+		return;
+	}
+
+	BNodeInfo nodeInfo(&file);
+	nodeInfo.SetType("text/tab-separated-values");
+
+	BString statusMsg;
+	statusMsg.SetToFormat(B_TRANSLATE("Exported %" B_PRId32 " n-grams to the n-gram list"),
+		fScanner->Counter().CountNGrams());
+	SendStatusMessage(statusMsg);
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#ifndef NGRAM_WINDOW_H
+#define NGRAM_WINDOW_H
+
+#include <FilePanel.h>
+#include <Menu.h>
+#include <String.h>
+#include <StringView.h>
+#include <Window.h>
+#include <memory>
+
+class BColumnListView;
+class NGramScanner;
+class NGramTask;
+
+class NGramWindow : public BWindow {
+public:
+	NGramWindow();
+	~NGramWindow();
+	virtual void MessageReceived(BMessage* message);
+	bool QuitRequested();
+
+	void SetText(const char* text, int32 length);
+
+private:
+	void _Update();
+	void _ShowNGrams();
+	void _Export(const char* path);
+
+	BString fText;
+	std::unique_ptr<NGramScanner> fScanner;
+	std::unique_ptr<NGramTask> fTask;
+	int32 fTaskID;
+	BMenu* fKindMenu;
+	BMenu* fSizeMenu;
+	BColumnListView* fListView;
+	BStringView* fStatusView;
+	BFilePanel* fExportPanel;
+};
+
+#endif // NGRAM_WINDOW_H
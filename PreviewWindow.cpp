@@ -0,0 +1,164 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "PreviewWindow.h"
+#include "Constants.h"
+#include "TextPreview.h"
+#include <Catalog.h>
+#include <LayoutBuilder.h>
+#include <ScrollView.h>
+#include <vector>
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "Preview"
+
+enum {
+	M_PREVIEW_CANCEL = 'pvcn'
+};
+
+static const rgb_color kRemovedColor = { 200, 30, 30, 255 };
+static const rgb_color kAddedColor = { 20, 140, 40, 255 };
+
+
+PreviewWindow::PreviewWindow(BMessenger target)
+	:
+	BWindow(BRect(150, 150, 750, 600), B_TRANSLATE("Preview changes"), B_TITLED_WINDOW,
+		B_NOT_MINIMIZABLE | B_AUTO_UPDATE_SIZE_LIMITS | B_CLOSE_ON_ESCAPE),
+	fTarget(target)
+{
+	fSummaryView = new BStringView("PreviewSummary", "");
+	fStatusView = new BStringView("PreviewStatus", "");
+
+	fDiffView = new BTextView("PreviewDiff");
+	fDiffView->MakeEditable(false);
+	fDiffView->SetStylable(true);
+	fDiffView->SetWordWrap(false);
+	BScrollView* scrollView
+		= new BScrollView("PreviewDiffScroll", fDiffView, B_WILL_DRAW | B_FRAME_EVENTS, true, true);
+
+	BButton* cancelButton
+		= new BButton("Cancel", B_TRANSLATE("Cancel"), new BMessage(M_PREVIEW_CANCEL));
+	fApplyButton = new BButton("Apply", B_TRANSLATE("Apply"), new BMessage(M_PREVIEW_APPLY));
+	fApplyButton->MakeDefault(true);
+
+	// clang-format off
+	BLayoutBuilder::Group<>(this, B_VERTICAL, B_USE_DEFAULT_SPACING)
+		.SetInsets(B_USE_WINDOW_INSETS)
+		.Add(fSummaryView)
+		.Add(fStatusView)
+		.Add(scrollView, 1)
+		.AddGroup(B_HORIZONTAL, B_USE_DEFAULT_SPACING)
+			.AddGlue()
+			.Add(cancelButton)
+			.Add(fApplyButton)
+		.End();
+	// clang-format on
+}
+
+
+void
+PreviewWindow::SetPreview(const TransformPreview& preview)
+{
+	BString summary;
+	if (!preview.HasChanges()) {
+		summary = B_TRANSLATE("No changes");
+	} else {
+		summary.SetToFormat(B_TRANSLATE("Changed regions: %d | Lines removed: %d | "
+										"Lines added: %d | Size difference: %+d bytes"),
+			preview.CountChangedRegions(), preview.CountRemovedLines(),
+			preview.CountAddedLines(), preview.SizeDifference());
+	}
+	fSummaryView->SetText(summary.String());
+	fStatusView->SetText(preview.StatusMessage().String());
+	fApplyButton->SetEnabled(preview.HasChanges());
+
+	// Build the diff text with one colored run per hunk part
+	BString text;
+	std::vector<std::pair<int32, rgb_color>> runs;
+	rgb_color textColor = ui_color(B_DOCUMENT_TEXT_COLOR);
+
+	const std::vector<PreviewHunk>& hunks = preview.Hunks();
+	for (size_t i = 0; i < hunks.size(); i++) {
+		const PreviewHunk& hunk = hunks[i];
+
+		BString header;
+		header.SetToFormat(B_TRANSLATE("@@ Line %d @@"), hunk.originalLine + 1);
+		runs.push_back(std::make_pair(text.Length(), textColor));
+		text << header << '\n';
+
+		BString lines;
+		if (!hunk.removed.IsEmpty()) {
+			lines = hunk.removed;
+			lines.ReplaceAll("\n", "\n- ");
+			lines.Prepend("- ");
+			lines.Truncate(lines.Length() - 2);
+			runs.push_back(std::make_pair(text.Length(), kRemovedColor));
+			text << lines;
+		}
+		if (!hunk.added.IsEmpty()) {
+			lines = hunk.added;
+			lines.ReplaceAll("\n", "\n+ ");
+			lines.Prepend("+ ");
+			lines.Truncate(lines.Length() - 2);
+			runs.push_back(std::make_pair(text.Length(), kAddedColor));
+			text << lines;
+		}
+		text << '\n';
+	}
+
+	if (preview.CountChangedRegions() > (int32)hunks.size()) {
+		BString more;
+		more.SetToFormat(B_TRANSLATE("%d more changed regions not shown"),
+			preview.CountChangedRegions() - (int32)hunks.size());
+		runs.push_back(std::make_pair(text.Length(), textColor));
+		text << more << '\n';
+	}
+
+	if (runs.empty()) {
+		fDiffView->SetText(text.String());
+		return;
+	}
+
+	text_run_array* runArray = BTextView::AllocRunArray(runs.size());
+	for (size_t i = 0; i < runs.size(); i++) {
+		runArray->runs[i].offset = runs[i].first;
+		runArray->runs[i].font = *be_fixed_font;
+		runArray->runs[i].color = runs[i].second;
+	}
+	fDiffView->SetText(text.String(), runArray);
+	BTextView::FreeRunArray(runArray);
+}
+
+
+void
+PreviewWindow::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case M_PREVIEW_APPLY:
+			fTarget.SendMessage(M_PREVIEW_APPLY);
+			Hide();
+			break;
+		case M_PREVIEW_CANCEL:
+			Hide();
+			break;
+		default:
+			BWindow::MessageReceived(message);
+			break;
+	}
+}
+
+
+// Closing the window only hides it. The application asks from a thread of
+// its own when it quits, and then the window goes too.
+bool
+PreviewWindow::QuitRequested()
+{
+	if (find_thread(NULL) != Thread())
+		return true;
+
+	if (!IsHidden())
+		Hide();
+	return false;
+}
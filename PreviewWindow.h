@@ -0,0 +1,33 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#ifndef PREVIEW_WINDOW_H
+#define PREVIEW_WINDOW_H
+
+#include <Button.h>
+#include <Messenger.h>
+#include <StringView.h>
+#include <TextView.h>
+#include <Window.h>
+
+class TransformPreview;
+
+class PreviewWindow : public BWindow {
+public:
+	PreviewWindow(BMessenger target);
+	virtual void MessageReceived(BMessage* message);
+	bool QuitRequested();
+
+	void SetPreview(const TransformPreview& preview);
+
+private:
+	BMessenger fTarget;
+	BStringView* fSummaryView;
+	BStringView* fStatusView;
+	BTextView* fDiffView;
+	BButton* fApplyButton;
+};
+
+#endif // PREVIEW_WINDOW_H
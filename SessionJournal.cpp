@@ -0,0 +1,653 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "SessionJournal.h"
+#include "TextFile.h"
+
+#include <Autolock.h>
+#include <FindDirectory.h>
+#include <Path.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <new>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+static const uint32 kCheckpointMagic = 'TWcp';
+static const uint32 kJournalMagic = 'TWjl';
+
+// Magic, generation and text length
+static const size_t kCheckpointHeaderSize = 16;
+// Magic and the generation of the checkpoint the journal belongs to
+static const size_t kJournalHeaderSize = 8;
+// Type, offset and length, followed by the inserted text and a checksum
+static const size_t kRecordHeaderSize = 9;
+static const size_t kChecksumSize = 4;
+
+// Edits that follow each other this closely are written together
+static const bigtime_t kWriteDelay = 250000;
+
+// The journal is folded into the checkpoint once it holds this many records,
+// or more bytes than the checkpoint, but at least kCompactionSize
+static const int32 kMaxJournalRecords = 4096;
+static const off_t kCompactionSize = 1024 * 1024;
+
+// Room for edits left when the text is read
+static const size_t kMinimumGap = 64 * 1024;
+
+
+// The text rebuilt from the checkpoint and the journal. Edits move a gap to
+// where they are, so a run of edits close together costs little however long
+// the text is.
+class GapText {
+public:
+	GapText()
+		:
+		fSize(0),
+		fGapStart(0),
+		fGapEnd(0)
+	{
+	}
+
+	// Makes room for a text of the given length, to be read into the buffer
+	char* SetTo(size_t length)
+	{
+		size_t size = length + kMinimumGap;
+		fBuffer.reset(new(std::nothrow) char[size]);
+		if (!fBuffer)
+			return nullptr;
+
+		fSize = size;
+		fGapStart = length;
+		fGapEnd = size;
+		return fBuffer.get();
+	}
+
+	size_t Length() const { return fSize - (fGapEnd - fGapStart); }
+
+	bool Insert(size_t offset, const char* data, size_t length)
+	{
+		if (offset > Length())
+			return false;
+		if (length > fGapEnd - fGapStart && !_Grow(length))
+			return false;
+
+		_MoveGap(offset);
+		memcpy(fBuffer.get() + fGapStart, data, length);
+		fGapStart += length;
+		return true;
+	}
+
+	bool Delete(size_t offset, size_t length)
+	{
+		if (offset > Length() || length > Length() - offset)
+			return false;
+
+		_MoveGap(offset);
+		fGapEnd += length;
+		return true;
+	}
+
+	// The text is in two pieces, before and after the gap
+	const char* First() const { return fBuffer.get(); }
+	size_t FirstLength() const { return fGapStart; }
+	const char* Second() const { return fBuffer.get() + fGapEnd; }
+	size_t SecondLength() const { return fSize - fGapEnd; }
+
+private:
+	void _MoveGap(size_t offset)
+	{
+		char* buffer = fBuffer.get();
+		if (offset < fGapStart) {
+			size_t count = fGapStart - offset;
+			memmove(buffer + fGapEnd - count, buffer + offset, count);
+			fGapStart -= count;
+			fGapEnd -= count;
+		} else if (offset > fGapStart) {
+			size_t count = offset - fGapStart;
+			memmove(buffer + fGapStart, buffer + fGapEnd, count);
+			fGapStart += count;
+			fGapEnd += count;
+		}
+	}
+
+	bool _Grow(size_t needed)
+	{
+		size_t size = fSize + needed + std::max(fSize / 2, kMinimumGap);
+		char* buffer = new(std::nothrow) char[size];
+		if (buffer == nullptr)
+			return false;
+
+		size_t secondLength = SecondLength();
+		memcpy(buffer, First(), FirstLength());
+		memcpy(buffer + size - secondLength, Second(), secondLength);
+		fBuffer.reset(buffer);
+		fSize = size;
+		fGapEnd = size - secondLength;
+		return true;
+	}
+
+	std::unique_ptr<char[]> fBuffer;
+	size_t fSize;
+	size_t fGapStart;
+	size_t fGapEnd;
+};
+
+
+static uint32
+_Checksum(uint32 checksum, const void* data, size_t length)
+{
+	// zlib starts over when it is given no data
+	return length > 0 ? crc32(checksum, (const Bytef*)data, length) : checksum;
+}
+
+
+static status_t
+_ReadFile(const char* path, std::string& data)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return errno;
+
+	struct stat st;
+	status_t status = fstat(fd, &st) == 0 ? B_OK : errno;
+	if (status == B_OK) {
+		data.resize(st.st_size);
+		status = DescriptorIO(fd).ReadExactly(&data[0], data.size());
+	}
+	close(fd);
+	return status;
+}
+
+
+SessionJournal::SessionJournal(const char* name)
+	:
+	fLock("session journal"),
+	fSemaphore(-1),
+	fThread(-1),
+	fQuitting(false),
+	fJournalFD(-1),
+	fHasCheckpoint(false),
+	fGeneration(0),
+	fCheckpointLength(0),
+	fJournalLength(0),
+	fJournalRecords(0)
+{
+	BPath path;
+	if (find_directory(B_USER_SETTINGS_DIRECTORY, &path) == B_OK && path.Append(name) == B_OK) {
+		fCheckpointPath = path.Path();
+		fJournalPath.SetToFormat("%s.journal", path.Path());
+	}
+}
+
+
+SessionJournal::~SessionJournal()
+{
+	Stop();
+}
+
+
+status_t
+SessionJournal::Restore(std::string& text)
+{
+	if (fThread >= 0)
+		return B_NOT_ALLOWED;
+
+	GapText restored;
+	status_t status = _Read(restored);
+	fHasCheckpoint = status == B_OK;
+	if (status != B_OK)
+		return status;
+
+	text.reserve(restored.Length());
+	text.assign(restored.First(), restored.FirstLength());
+	text.append(restored.Second(), restored.SecondLength());
+	return B_OK;
+}
+
+
+status_t
+SessionJournal::Start()
+{
+	if (fThread >= 0)
+		return B_OK;
+	if (fCheckpointPath.IsEmpty())
+		return B_ENTRY_NOT_FOUND;
+
+	fSemaphore = create_sem(0, "session journal");
+	if (fSemaphore < B_OK)
+		return fSemaphore;
+
+	fQuitting = false;
+	fThread = spawn_thread(_WriterThread, "session journal", B_LOW_PRIORITY, this);
+	status_t status = fThread < B_OK ? fThread : resume_thread(fThread);
+	if (status != B_OK) {
+		if (fThread >= B_OK)
+			kill_thread(fThread);
+		fThread = -1;
+		delete_sem(fSemaphore);
+		fSemaphore = -1;
+	}
+	return status;
+}
+
+
+void
+SessionJournal::Stop()
+{
+	if (fThread < 0)
+		return;
+
+	fLock.Lock();
+	fQuitting = true;
+	fLock.Unlock();
+	release_sem(fSemaphore);
+
+	status_t result;
+	wait_for_thread(fThread, &result);
+	fThread = -1;
+	delete_sem(fSemaphore);
+	fSemaphore = -1;
+
+	if (fJournalFD >= 0) {
+		close(fJournalFD);
+		fJournalFD = -1;
+	}
+}
+
+
+void
+SessionJournal::Clear()
+{
+	unlink(fCheckpointPath.String());
+	unlink(fJournalPath.String());
+	fHasCheckpoint = false;
+	fCheckpointLength = 0;
+	fJournalLength = 0;
+	fJournalRecords = 0;
+}
+
+
+void
+SessionJournal::Reset(const char* text, int32 length)
+{
+	if (fThread < 0)
+		return;
+
+	Record record = { RECORD_RESET, 0, length, std::string(text, length) };
+
+	BAutolock _(fLock);
+	// Edits not written yet no longer matter
+	fPending.clear();
+	_Queue(record);
+}
+
+
+void
+SessionJournal::Insert(int32 offset, const char* text, int32 length)
+{
+	if (fThread < 0 || length <= 0)
+		return;
+
+	BAutolock _(fLock);
+	if (!fPending.empty()) {
+		// Typing adds to the insert before it
+		Record& last = fPending.back();
+		if (last.type == RECORD_INSERT && offset == last.offset + last.length) {
+			last.text.append(text, length);
+			last.length += length;
+			return;
+		}
+	}
+
+	Record record = { RECORD_INSERT, offset, length, std::string(text, length) };
+	_Queue(record);
+}
+
+
+void
+SessionJournal::Delete(int32 start, int32 finish)
+{
+	if (fThread < 0 || finish <= start)
+		return;
+
+	BAutolock _(fLock);
+	if (!fPending.empty()) {
+		Record& last = fPending.back();
+		if (last.type == RECORD_INSERT && start >= last.offset
+			&& finish == last.offset + last.length) {
+			// Backspace over what was just typed
+			last.length = start - last.offset;
+			last.text.resize(last.length);
+			if (last.length == 0)
+				fPending.pop_back();
+			return;
+		}
+		if (last.type == RECORD_DELETE && (finish == last.offset || start == last.offset)) {
+			// Backspace or delete again
+			last.offset = start;
+			last.length += finish - start;
+			return;
+		}
+	}
+
+	Record record = { RECORD_DELETE, start, finish - start, std::string() };
+	_Queue(record);
+}
+
+
+// Only with fLock held
+void
+SessionJournal::_Queue(Record& record)
+{
+	bool wasEmpty = fPending.empty();
+	fPending.push_back(std::move(record));
+	if (wasEmpty)
+		release_sem(fSemaphore);
+}
+
+
+status_t
+SessionJournal::_WriterThread(void* data)
+{
+	SessionJournal* journal = (SessionJournal*)data;
+	std::vector<Record> records;
+	bool quitting = false;
+	while (!quitting) {
+		status_t status = acquire_sem(journal->fSemaphore);
+		if (status == B_INTERRUPTED)
+			continue;
+		if (status != B_OK)
+			break;
+
+		journal->fLock.Lock();
+		quitting = journal->fQuitting;
+		journal->fLock.Unlock();
+
+		// Give the edits that follow the chance to join the first one. Stop()
+		// ends the wait early.
+		if (!quitting)
+			acquire_sem_etc(journal->fSemaphore, 1, B_RELATIVE_TIMEOUT, kWriteDelay);
+
+		journal->fLock.Lock();
+		records.swap(journal->fPending);
+		quitting = journal->fQuitting;
+		journal->fLock.Unlock();
+
+		journal->_WriteRecords(records);
+		records.clear();
+	}
+
+	return B_OK;
+}
+
+
+void
+SessionJournal::_WriteRecords(const std::vector<Record>& records)
+{
+	std::string data;
+	int32 count = 0;
+	for (const Record& record : records) {
+		if (record.type == RECORD_RESET) {
+			data.clear();
+			count = 0;
+			fHasCheckpoint = false;
+			_WriteCheckpoint(record.text.data(), record.text.size(), nullptr, 0);
+			continue;
+		}
+
+		size_t start = data.size();
+		data.append((const char*)&record.type, sizeof(record.type));
+		data.append((const char*)&record.offset, sizeof(record.offset));
+		data.append((const char*)&record.length, sizeof(record.length));
+		if (record.type == RECORD_INSERT)
+			data.append(record.text);
+		uint32 checksum = _Checksum(0, data.data() + start, data.size() - start);
+		data.append((const char*)&checksum, sizeof(checksum));
+		count++;
+	}
+
+	if (count > 0 && _Append(data, count) != B_OK)
+		return;
+
+	if (fHasCheckpoint
+		&& (fJournalRecords >= kMaxJournalRecords
+			|| fJournalLength > std::max(kCompactionSize, fCheckpointLength))) {
+		_Compact();
+	}
+}
+
+
+// A new checkpoint is written beside the old one and renamed over it, so there
+// is a complete one at any time. The journal of the old checkpoint is ignored
+// from then on, as its generation no longer matches.
+status_t
+SessionJournal::_WriteCheckpoint(const char* first, size_t firstLength, const char* second,
+	size_t secondLength)
+{
+	BString tempPath;
+	tempPath.SetToFormat("%s.new", fCheckpointPath.String());
+	int fd = open(tempPath.String(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0)
+		return errno;
+
+	uint32 generation = fGeneration + 1;
+	uint64 length = firstLength + secondLength;
+	uint8 header[kCheckpointHeaderSize];
+	memcpy(header, &kCheckpointMagic, 4);
+	memcpy(header + 4, &generation, 4);
+	memcpy(header + 8, &length, 8);
+	uint32 checksum = _Checksum(_Checksum(0, first, firstLength), second, secondLength);
+
+	DescriptorIO output(fd);
+	status_t status = output.WriteExactly(header, sizeof(header));
+	if (status == B_OK && firstLength > 0)
+		status = output.WriteExactly(first, firstLength);
+	if (status == B_OK && secondLength > 0)
+		status = output.WriteExactly(second, secondLength);
+	if (status == B_OK)
+		status = output.WriteExactly(&checksum, sizeof(checksum));
+	if (status == B_OK && fsync(fd) != 0)
+		status = errno;
+	close(fd);
+
+	if (status == B_OK && rename(tempPath.String(), fCheckpointPath.String()) != 0)
+		status = errno;
+	if (status != B_OK) {
+		unlink(tempPath.String());
+		return status;
+	}
+
+	fHasCheckpoint = true;
+	fGeneration = generation;
+	fCheckpointLength = length;
+	return _CreateJournal();
+}
+
+
+status_t
+SessionJournal::_CreateJournal()
+{
+	if (fJournalFD >= 0)
+		close(fJournalFD);
+
+	fJournalLength = 0;
+	fJournalRecords = 0;
+	fJournalFD = open(fJournalPath.String(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fJournalFD < 0)
+		return errno;
+
+	uint8 header[kJournalHeaderSize];
+	memcpy(header, &kJournalMagic, 4);
+	memcpy(header + 4, &fGeneration, 4);
+	status_t status = DescriptorIO(fJournalFD).WriteExactly(header, sizeof(header));
+	if (status != B_OK) {
+		close(fJournalFD);
+		fJournalFD = -1;
+		return status;
+	}
+
+	fJournalLength = kJournalHeaderSize;
+	return B_OK;
+}
+
+
+status_t
+SessionJournal::_OpenJournal()
+{
+	if (fJournalLength < (off_t)kJournalHeaderSize)
+		return _CreateJournal();
+
+	// Cuts off what a crash may have left of a record
+	fJournalFD = open(fJournalPath.String(), O_WRONLY);
+	if (fJournalFD < 0)
+		return errno;
+	if (ftruncate(fJournalFD, fJournalLength) != 0 || lseek(fJournalFD, 0, SEEK_END) < 0) {
+		status_t status = errno;
+		close(fJournalFD);
+		fJournalFD = -1;
+		return status;
+	}
+	return B_OK;
+}
+
+
+status_t
+SessionJournal::_Append(const std::string& data, int32 count)
+{
+	// Without a checkpoint to apply them to, edits are dropped until the next
+	// reset
+	if (!fHasCheckpoint)
+		return B_NO_INIT;
+
+	status_t status = fJournalFD >= 0 ? B_OK : _OpenJournal();
+	if (status == B_OK)
+		status = DescriptorIO(fJournalFD).WriteExactly(data.data(), data.size());
+	if (status != B_OK) {
+		fHasCheckpoint = false;
+		return status;
+	}
+
+	fJournalLength += data.size();
+	fJournalRecords += count;
+	return B_OK;
+}
+
+
+// Folds the journal into a new checkpoint. The text is read back from the
+// files, so the writer thread keeps no copy of it in memory.
+status_t
+SessionJournal::_Compact()
+{
+	// Should this fail, the old checkpoint and journal are still good
+	GapText text;
+	status_t status = _Read(text);
+	if (status == B_OK) {
+		status = _WriteCheckpoint(text.First(), text.FirstLength(), text.Second(),
+			text.SecondLength());
+	}
+	return status;
+}
+
+
+status_t
+SessionJournal::_Read(GapText& text)
+{
+	int fd = open(fCheckpointPath.String(), O_RDONLY);
+	if (fd < 0)
+		return errno;
+
+	DescriptorIO input(fd);
+	uint8 header[kCheckpointHeaderSize];
+	uint32 magic = 0;
+	uint32 generation = 0;
+	uint64 length = 0;
+	status_t status = input.ReadExactly(header, sizeof(header));
+	if (status == B_OK) {
+		memcpy(&magic, header, 4);
+		memcpy(&generation, header + 4, 4);
+		memcpy(&length, header + 8, 8);
+		if (magic != kCheckpointMagic || length > INT32_MAX)
+			status = B_BAD_DATA;
+	}
+
+	char* data = nullptr;
+	if (status == B_OK) {
+		data = text.SetTo(length);
+		if (data == nullptr)
+			status = B_NO_MEMORY;
+	}
+	uint32 checksum = 0;
+	if (status == B_OK)
+		status = input.ReadExactly(data, length);
+	if (status == B_OK)
+		status = input.ReadExactly(&checksum, sizeof(checksum));
+	close(fd);
+	if (status == B_OK && checksum != _Checksum(0, data, length))
+		status = B_BAD_DATA;
+	if (status != B_OK)
+		return status;
+
+	fGeneration = generation;
+	fCheckpointLength = length;
+	fJournalLength = 0;
+	fJournalRecords = 0;
+
+	// The journal only counts when it belongs to this checkpoint. Its records
+	// are applied up to the first one that is incomplete or damaged, as the
+	// last one is after a crash in the middle of writing it.
+	std::string journal;
+	if (_ReadFile(fJournalPath.String(), journal) != B_OK || journal.size() < kJournalHeaderSize)
+		return B_OK;
+
+	memcpy(&magic, journal.data(), 4);
+	memcpy(&generation, journal.data() + 4, 4);
+	if (magic != kJournalMagic || generation != fGeneration)
+		return B_OK;
+
+	size_t position = kJournalHeaderSize;
+	int32 records = 0;
+	while (journal.size() - position >= kRecordHeaderSize + kChecksumSize) {
+		const char* record = journal.data() + position;
+		uint8 type = record[0];
+		int32 offset;
+		int32 recordLength;
+		memcpy(&offset, record + 1, 4);
+		memcpy(&recordLength, record + 5, 4);
+		if (offset < 0 || recordLength < 0)
+			break;
+
+		size_t size = kRecordHeaderSize + kChecksumSize;
+		if (type == RECORD_INSERT)
+			size += recordLength;
+		if (journal.size() - position < size)
+			break;
+
+		memcpy(&checksum, record + size - kChecksumSize, 4);
+		if (checksum != _Checksum(0, record, size - kChecksumSize))
+			break;
+
+		bool applied = false;
+		if (type == RECORD_INSERT)
+			applied = text.Insert(offset, record + kRecordHeaderSize, recordLength);
+		else if (type == RECORD_DELETE)
+			applied = text.Delete(offset, recordLength);
+		if (!applied)
+			break;
+
+		position += size;
+		records++;
+	}
+
+	fJournalLength = position;
+	fJournalRecords = records;
+	return B_OK;
+}
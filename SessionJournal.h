@@ -0,0 +1,85 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef SESSION_JOURNAL_H
+#define SESSION_JOURNAL_H
+
+#include <Locker.h>
+#include <OS.h>
+#include <String.h>
+#include <SupportDefs.h>
+#include <string>
+#include <vector>
+
+class GapText;
+
+// Keeps the text of the window in the settings directory while it is edited,
+// so it is back after a quit as well as after a crash. Edits are appended to
+// a journal by a thread of their own, so an edit writes about as much as it
+// changes. Not so Reset(), which copies the whole text and has it written
+// and synced as a new checkpoint, or the compaction once the journal grows,
+// which reads and rewrites the whole text on the writer thread.
+class SessionJournal {
+public:
+	SessionJournal(const char* name);
+	~SessionJournal();
+
+	// Reads the text as it was last written. Only before Start().
+	status_t Restore(std::string& text);
+
+	status_t Start();
+	// Writes what is still pending and stops the thread
+	void Stop();
+	// Removes the files, after Stop()
+	void Clear();
+
+	// Replaces the whole text, as when a file is opened
+	void Reset(const char* text, int32 length);
+	void Insert(int32 offset, const char* text, int32 length);
+	void Delete(int32 start, int32 finish);
+
+private:
+	enum RecordType {
+		RECORD_RESET = 0,
+		RECORD_INSERT,
+		RECORD_DELETE
+	};
+
+	struct Record {
+		uint8 type;
+		int32 offset;
+		int32 length;
+		std::string text;
+	};
+
+	void _Queue(Record& record);
+	static status_t _WriterThread(void* data);
+	void _WriteRecords(const std::vector<Record>& records);
+	status_t _WriteCheckpoint(const char* first, size_t firstLength, const char* second,
+		size_t secondLength);
+	status_t _CreateJournal();
+	status_t _OpenJournal();
+	status_t _Append(const std::string& data, int32 count);
+	status_t _Compact();
+	status_t _Read(GapText& text);
+
+	BString fCheckpointPath;
+	BString fJournalPath;
+
+	BLocker fLock;
+	std::vector<Record> fPending;
+	sem_id fSemaphore;
+	thread_id fThread;
+	bool fQuitting;
+
+	// Owned by the writer thread once it runs
+	int fJournalFD;
+	bool fHasCheckpoint;
+	uint32 fGeneration;
+	off_t fCheckpointLength;
+	off_t fJournalLength;
+	int32 fJournalRecords;
+};
+
+#endif // SESSION_JOURNAL_H
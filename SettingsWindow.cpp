@@ -18,7 +18,8 @@
 
 
 SettingsWindow::SettingsWindow(bool saveText, bool saveSettings, bool clipboard, bool clearSettings,
-							int32 fontSize, BString fontFamily, bool closeOnEsc, bool askToSave)
+							int32 fontSize, BString fontFamily, bool closeOnEsc, bool askToSave,
+							int32 statsWordCount)
 :
 	BWindow(BRect(200, 200, 500, 400), B_TRANSLATE("Settings"), B_TITLED_WINDOW,
 		B_NOT_RESIZABLE | B_NOT_MINIMIZABLE | B_NOT_ZOOMABLE | B_AUTO_UPDATE_SIZE_LIMITS
@@ -40,6 +41,10 @@ SettingsWindow::SettingsWindow(bool saveText, bool saveSettings, bool clipboard,
 	fCloseOnEsc->SetValue(closeOnEsc ? B_CONTROL_ON : B_CONTROL_OFF);
 	fAskToSave = new BCheckBox("SaveSettings", B_TRANSLATE("Prompt to save changes before closing"), new BMessage(M_APPLY_SETTINGS));
 	fAskToSave->SetValue(askToSave ? B_CONTROL_ON : B_CONTROL_OFF);
+	fStatsWordCount = new BSpinner("StatsWordCount", B_TRANSLATE("Most used words in statistics:"),
+		new BMessage(M_APPLY_SETTINGS));
+	fStatsWordCount->SetRange(1, 1000);
+	fStatsWordCount->SetValue(statsWordCount);
 
 	BPopUpMenu* fontMenu = new BPopUpMenu("FontFamily");
 	PopulateFontMenu(fontMenu);
@@ -69,7 +74,8 @@ SettingsWindow::SettingsWindow(bool saveText, bool saveSettings, bool clipboard,
 		.Add(fSaveFieldsCheck)
 		.Add(fClearSettingsAfterUse)
 		.Add(fCloseOnEsc)
-		.Add(fAskToSave);
+		.Add(fAskToSave)
+		.Add(fStatsWordCount);
 
 	BBox* appearanceBox = new BBox("appearanceBox");
 	appearanceBox->SetLabel(B_TRANSLATE("Appearance"));
@@ -139,6 +145,7 @@ SettingsWindow::MessageReceived(BMessage* message)
 			applyMsg.AddBool("clearSettings", fClearSettingsAfterUse->Value() == B_CONTROL_ON);
 			applyMsg.AddBool("closeOnEsc", fCloseOnEsc->Value() == B_CONTROL_ON);
 			applyMsg.AddBool("askToSave", fAskToSave->Value() == B_CONTROL_ON);
+			applyMsg.AddInt32("statsWordCount", fStatsWordCount->Value());
 			applyMsg.AddInt32("fontSize", fFontSizeSlider->Value());
 			applyMsg.AddString("fontFamily", fontFamily);
 
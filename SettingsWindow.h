@@ -12,13 +12,15 @@
 #include <MenuField.h>
 #include <PopUpMenu.h>
 #include <Slider.h>
+#include <Spinner.h>
 #include <String.h>
 #include <Window.h>
 
 class SettingsWindow : public BWindow {
 public:
 	SettingsWindow(bool saveText, bool saveSettings, bool clipboard, bool clearSettings,
-		int32 fontSize, BString fontFamily, bool closeOnEsc, bool askToSave);
+		int32 fontSize, BString fontFamily, bool closeOnEsc, bool askToSave,
+		int32 statsWordCount);
 	virtual void MessageReceived(BMessage* message);
 	bool QuitRequested();
 
@@ -29,6 +31,7 @@ private:
 	BCheckBox* fClearSettingsAfterUse;
 	BCheckBox* fCloseOnEsc;
 	BCheckBox* fAskToSave;
+	BSpinner* fStatsWordCount;
 	BMenuField* fFontFamilyField;
 	BString fFontFamily;
 	BSlider* fFontSizeSlider;
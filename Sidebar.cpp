@@ -14,6 +14,7 @@
 #include <GroupView.h>
 #include <LayoutBuilder.h>
 #include <RadioButton.h>
+#include <ScrollView.h>
 #include <StringView.h>
 #include <TabView.h>
 #include <TextControl.h>
@@ -33,6 +34,7 @@ Sidebar::Sidebar()
 	_BuildLineTab();
 	_BuildPrefixTab();
 	_BuildSortTab();
+	_BuildBatchTab();
 	_BuildEncodeTab();
 }
 
@@ -92,12 +94,23 @@ Sidebar::_BuildLineTab()
 
 	fSearchInput = new BTextControl("SearchString",
 		B_TRANSLATE_COMMENT("Search:", "As short as possible"), "", nullptr);
+	fSearchInput->SetModificationMessage(new BMessage(M_SEARCH_CHANGED));
 	fReplaceInput = new BTextControl("ReplaceString",
 		B_TRANSLATE_COMMENT("Replace:", "As short as possible"), "", nullptr);
 	fCaseCheck = new BCheckBox("ReplaceCaseSensitiveCheckbox",
-		B_TRANSLATE_COMMENT("Case sensitive", "As short as possible"), nullptr);
+		B_TRANSLATE_COMMENT("Case sensitive", "As short as possible"),
+		new BMessage(M_SEARCH_CHANGED));
 	fWholeWordCheck = new BCheckBox("ReplaceFullWordsCheckbox",
-		B_TRANSLATE_COMMENT("Full words", "As short as possible"), nullptr);
+		B_TRANSLATE_COMMENT("Full words", "As short as possible"),
+		new BMessage(M_SEARCH_CHANGED));
+	fRegexCheck = new BCheckBox("ReplaceRegexCheckbox",
+		B_TRANSLATE_COMMENT("Regular expression", "As short as possible"),
+		new BMessage(M_SEARCH_CHANGED));
+
+	BButton* findPreviousBtn = new BButton("FindPreviousBtn", B_TRANSLATE("Previous"),
+		new BMessage(M_FIND_PREVIOUS));
+	BButton* findNextBtn = new BButton("FindNextBtn", B_TRANSLATE("Next"),
+		new BMessage(M_FIND_NEXT));
 
 	BButton* searchReplaceBtn = new BButton("SearchReplaceBtn", B_TRANSLATE("Replace"),
 		new BMessage(M_TRANSFORM_REPLACE));
@@ -116,6 +129,11 @@ Sidebar::_BuildLineTab()
 			.End()
 		.Add(fCaseCheck)
 		.Add(fWholeWordCheck)
+		.Add(fRegexCheck)
+		.AddGroup(B_HORIZONTAL, B_USE_HALF_ITEM_SPACING)
+			.Add(findPreviousBtn)
+			.Add(findNextBtn)
+			.End()
 		.Add(searchReplaceBtn)
 		.End();
 	// clang-format on
@@ -401,6 +419,65 @@ Sidebar::_BuildSortTab()
 }
 
 
+void
+Sidebar::_BuildBatchTab()
+{
+	// === Batch replace Box ===
+	BBox* batchBox = new BBox("BatchReplaceBox");
+	batchBox->SetLabel(B_TRANSLATE("Batch replace"));
+
+	BStringView* hint = new BStringView("BatchHint",
+		B_TRANSLATE("One pair per line: find<Tab>replace"));
+
+	fBatchPairsView = new BTextView("BatchPairs");
+	fBatchPairsView->SetWordWrap(false);
+	BScrollView* pairsScroll = new BScrollView("BatchPairsScroll", fBatchPairsView, 0, true, true);
+	pairsScroll->SetExplicitMinSize(BSize(B_SIZE_UNSET, 120));
+
+	fBatchCaseCheck = new BCheckBox("BatchCaseSensitiveCheckbox",
+		B_TRANSLATE_COMMENT("Case sensitive", "As short as possible"), nullptr);
+
+	BButton* loadButton = new BButton("BatchLoadBtn",
+		B_TRANSLATE_COMMENT("Load" B_UTF8_ELLIPSIS, "As short as possible"),
+		new BMessage(M_BATCH_LOAD_PAIRS));
+	BButton* replaceButton = new BButton("BatchReplaceBtn",
+		B_TRANSLATE_COMMENT("Replace all", "As short as possible"),
+		new BMessage(M_TRANSFORM_BATCH_REPLACE));
+
+	BView* batchView = new BView("batchView", B_WILL_DRAW);
+	// clang-format off
+	BLayoutBuilder::Group<>(batchView, B_VERTICAL, B_USE_SMALL_SPACING)
+		.SetInsets(B_USE_HALF_ITEM_INSETS, B_USE_ITEM_INSETS,
+			B_USE_HALF_ITEM_INSETS, B_USE_HALF_ITEM_INSETS)
+		.Add(hint)
+		.Add(pairsScroll)
+		.Add(fBatchCaseCheck)
+		.AddGroup(B_HORIZONTAL)
+			.Add(loadButton)
+			.AddGlue()
+			.Add(replaceButton)
+			.End()
+		.End();
+	// clang-format on
+
+	batchBox->AddChild(batchView);
+
+	// === Batch Tab ===
+	BView* batchTabView = new BView("batchTabView", B_WILL_DRAW);
+	// clang-format off
+	BLayoutBuilder::Group<>(batchTabView, B_VERTICAL, B_USE_SMALL_SPACING)
+		.SetInsets(B_USE_ITEM_INSETS)
+		.Add(batchBox)
+		.AddGlue()
+		.End();
+	// clang-format on
+
+	BTab* batchTab = new BTab();
+	AddTab(batchTabView, batchTab);
+	batchTab->SetLabel(B_TRANSLATE_COMMENT("Batch", "As short as possible"));
+}
+
+
 void
 Sidebar::_BuildEncodeTab()
 {
@@ -429,11 +506,23 @@ Sidebar::_BuildEncodeTab()
 	BButton* urlDecodeButton
 		= new BButton("urlDecBtn", B_TRANSLATE("Decode"), new BMessage(M_TRANSFORM_DECODE_URL));
 	urlDecodeButton->SetExplicitMaxSize(BSize(B_SIZE_UNLIMITED, B_SIZE_UNSET));
+
+	fUrlSetMenu = new BMenu("urlSets");
+	fUrlSetMenu->AddItem(new BMenuItem(B_TRANSLATE("Component"), nullptr));
+	fUrlSetMenu->AddItem(new BMenuItem(B_TRANSLATE("Path"), nullptr));
+	fUrlSetMenu->AddItem(new BMenuItem(B_TRANSLATE("Query"), nullptr));
+	fUrlSetMenu->AddItem(new BMenuItem(B_TRANSLATE("Form ('+' for spaces)"), nullptr));
+	fUrlSetMenu->SetLabelFromMarked(true);
+	fUrlSetMenu->SetRadioMode(true);
+	fUrlSetMenu->ItemAt(0L)->SetMarked(true);
+	BMenuField* urlSetField = new BMenuField("urlSetField",
+		B_TRANSLATE_COMMENT("Encode as:", "As short as possible"), fUrlSetMenu);
 	BView* urlView = new BView("urlView", B_WILL_DRAW);
 	// clang-format off
 	BLayoutBuilder::Group<>(urlView, B_VERTICAL)
 		.SetInsets(B_USE_HALF_ITEM_INSETS, B_USE_ITEM_INSETS,
 			B_USE_HALF_ITEM_INSETS, B_USE_HALF_ITEM_INSETS)
+		.Add(urlSetField)
 		.Add(urlEncodeButton)
 		.Add(urlDecodeButton)
 		.End();
@@ -446,11 +535,22 @@ Sidebar::_BuildEncodeTab()
 	BButton* base64Button
 		= new BButton("base64Btn", B_TRANSLATE("Encode / decode"), new BMessage(M_TRANSFORM_BASE64));
 	base64Button->SetExplicitMaxSize(BSize(B_SIZE_UNLIMITED, B_SIZE_UNSET));
+
+	fBase64Menu = new BMenu("base64Variants");
+	fBase64Menu->AddItem(new BMenuItem(B_TRANSLATE("Standard"), nullptr));
+	fBase64Menu->AddItem(new BMenuItem(B_TRANSLATE("URL-safe"), nullptr));
+	fBase64Menu->AddItem(new BMenuItem(B_TRANSLATE("MIME (76 characters per line)"), nullptr));
+	fBase64Menu->SetLabelFromMarked(true);
+	fBase64Menu->SetRadioMode(true);
+	fBase64Menu->ItemAt(0L)->SetMarked(true);
+	BMenuField* base64Field = new BMenuField("base64Field",
+		B_TRANSLATE_COMMENT("Variant:", "As short as possible"), fBase64Menu);
 	BView* base64View = new BView("base64View", B_WILL_DRAW);
 	// clang-format off
 	BLayoutBuilder::Group<>(base64View, B_VERTICAL)
 		.SetInsets(B_USE_HALF_ITEM_INSETS, B_USE_ITEM_INSETS,
 			B_USE_HALF_ITEM_INSETS, B_USE_HALF_ITEM_INSETS)
+		.Add(base64Field)
 		.Add(base64Button)
 		.End();
 	// clang-format on
@@ -556,6 +656,49 @@ Sidebar::setReplaceFullWords(bool enabled)
 }
 
 
+bool
+Sidebar::getReplaceRegex() const
+{
+	return fRegexCheck->Value() == B_CONTROL_ON;
+}
+
+
+void
+Sidebar::setReplaceRegex(bool enabled)
+{
+	fRegexCheck->SetValue(enabled ? B_CONTROL_ON : B_CONTROL_OFF);
+}
+
+
+// Batch replace
+BString
+Sidebar::getBatchPairs() const
+{
+	return fBatchPairsView->Text();
+}
+
+
+void
+Sidebar::setBatchPairs(const BString& text)
+{
+	fBatchPairsView->SetText(text);
+}
+
+
+bool
+Sidebar::getBatchCaseSensitive() const
+{
+	return fBatchCaseCheck->Value() == B_CONTROL_ON;
+}
+
+
+void
+Sidebar::setBatchCaseSensitive(bool enabled)
+{
+	fBatchCaseCheck->SetValue(enabled ? B_CONTROL_ON : B_CONTROL_OFF);
+}
+
+
 // Line break mode
 int8
 Sidebar::getBreakMode() const
@@ -728,3 +871,36 @@ Sidebar::setCaseSortCheck(bool enabled)
 {
 	fCaseSortCheck->SetValue(enabled ? B_CONTROL_ON : B_CONTROL_OFF);
 }
+
+
+// Encode/decode
+int32
+Sidebar::getUrlEncodeSet() const
+{
+	return fUrlSetMenu->IndexOf(fUrlSetMenu->FindMarked());
+}
+
+
+void
+Sidebar::setUrlEncodeSet(int32 set)
+{
+	BMenuItem* item = fUrlSetMenu->ItemAt(set);
+	if (item != nullptr)
+		item->SetMarked(true);
+}
+
+
+int32
+Sidebar::getBase64Variant() const
+{
+	return fBase64Menu->IndexOf(fBase64Menu->FindMarked());
+}
+
+
+void
+Sidebar::setBase64Variant(int32 variant)
+{
+	BMenuItem* item = fBase64Menu->ItemAt(variant);
+	if (item != nullptr)
+		item->SetMarked(true);
+}
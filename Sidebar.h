@@ -14,6 +14,7 @@
 #include <RadioButton.h>
 #include <TabView.h>
 #include <TextControl.h>
+#include <TextView.h>
 #include <private/interface/Spinner.h>
 
 enum { M_SORT_ALPHA = 'salp', M_SORT_LENGTH, M_SORT_ASCENDING, M_SORT_DESCENDING, M_SORT_CASE };
@@ -32,6 +33,14 @@ public:
 	void setReplaceCaseSensitive(bool enabled);
 	bool getReplaceFullWords() const;
 	void setReplaceFullWords(bool enabled);
+	bool getReplaceRegex() const;
+	void setReplaceRegex(bool enabled);
+
+	// Batch replace
+	BString getBatchPairs() const;
+	void setBatchPairs(const BString& text);
+	bool getBatchCaseSensitive() const;
+	void setBatchCaseSensitive(bool enabled);
 
 	// Line breaks
 	int8 getBreakMode() const;
@@ -65,10 +74,17 @@ public:
 	bool getCaseSortCheck() const;
 	void setCaseSortCheck(bool enabled);
 
+	// Encode/decode
+	int32 getUrlEncodeSet() const;
+	void setUrlEncodeSet(int32 set);
+	int32 getBase64Variant() const;
+	void setBase64Variant(int32 variant);
+
 private:
 	void _BuildLineTab();
 	void _BuildPrefixTab();
 	void _BuildSortTab();
+	void _BuildBatchTab();
 	void _BuildEncodeTab();
 	float fMaxLabelWidth;
 	BTextControl* fPrefixInput;
@@ -85,6 +101,9 @@ private:
 	BTextControl* fReplaceInput;
 	BCheckBox* fCaseCheck;
 	BCheckBox* fWholeWordCheck;
+	BCheckBox* fRegexCheck;
+	BTextView* fBatchPairsView;
+	BCheckBox* fBatchCaseCheck;
 	BRadioButton* fAlphaSortRadio;
 	BRadioButton* fLengthSortRadio;
 	BRadioButton* fSortAsc;
@@ -92,6 +111,8 @@ private:
 	BCheckBox* fCaseSortCheck;
 
 	BMenu* fBreakMenu;
+	BMenu* fUrlSetMenu;
+	BMenu* fBase64Menu;
 	enum BreakMode fBreakMode;
 };
 
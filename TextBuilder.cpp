@@ -0,0 +1,87 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "TextBuilder.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+static const size_t kMinCapacity = 256;
+static const size_t kMaxArenaCapacity = 16 * 1024 * 1024;
+
+// The block a finished builder leaves for the next one on the same thread.
+// Larger blocks are freed, so a single huge transform does not pin its memory.
+struct ArenaBlock {
+	~ArenaBlock() { free(data); }
+
+	char* data = nullptr;
+	size_t capacity = 0;
+};
+
+static thread_local ArenaBlock sArena;
+
+
+TextBuilder::TextBuilder(size_t capacity)
+	:
+	fData(sArena.data),
+	fLength(0),
+	fCapacity(sArena.capacity),
+	fStatus(B_OK)
+{
+	// A nested builder finds the arena empty and allocates its own block
+	sArena.data = nullptr;
+	sArena.capacity = 0;
+
+	Reserve(std::max(capacity, kMinCapacity));
+}
+
+
+TextBuilder::~TextBuilder()
+{
+	if (sArena.data == nullptr && fCapacity <= kMaxArenaCapacity) {
+		sArena.data = fData;
+		sArena.capacity = fCapacity;
+	} else if (fCapacity > sArena.capacity && fCapacity <= kMaxArenaCapacity) {
+		std::swap(sArena.data, fData);
+		std::swap(sArena.capacity, fCapacity);
+		free(fData);
+	} else
+		free(fData);
+}
+
+
+status_t
+TextBuilder::Reserve(size_t capacity)
+{
+	if (fStatus != B_OK || capacity <= fCapacity)
+		return fStatus;
+
+	char* data = (char*)realloc(fData, capacity);
+	if (data == nullptr) {
+		fStatus = B_NO_MEMORY;
+		return fStatus;
+	}
+
+	fData = data;
+	fCapacity = capacity;
+	return B_OK;
+}
+
+
+char*
+TextBuilder::AppendBuffer(size_t maxLength)
+{
+	if (maxLength > fCapacity - fLength && !_Grow(maxLength))
+		return nullptr;
+	return fData + fLength;
+}
+
+
+bool
+TextBuilder::_Grow(size_t needed)
+{
+	// Grow geometrically, so a low estimate costs a few reallocations at most
+	return Reserve(std::max(fLength + needed, fCapacity + fCapacity / 2)) == B_OK;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef TEXT_BUILDER_H
+#define TEXT_BUILDER_H
+
+#include <String.h>
+#include <SupportDefs.h>
+#include <cstring>
+#include <string_view>
+
+// Output buffer for transforms. The memory is borrowed from a per-thread
+// arena that is kept between transforms, so a builder sized with a good
+// estimate does not allocate at all. View() can be passed to ReplaceText()
+// as it is, without copying the result into a BString first.
+//
+// When memory runs out, the builder keeps B_NO_MEMORY in InitCheck() and
+// drops what does not fit, so the result is checked once before it is used.
+class TextBuilder {
+public:
+	TextBuilder(size_t capacity = 0);
+	~TextBuilder();
+
+	status_t InitCheck() const { return fStatus; }
+
+	status_t Reserve(size_t capacity);
+	void Clear() { fLength = 0; }
+
+	// Returns room for at least maxLength bytes behind the text, or nullptr
+	// without memory. Commit() then adds the bytes that were actually written.
+	char* AppendBuffer(size_t maxLength);
+	void Commit(size_t length) { fLength += length; }
+
+	TextBuilder& Append(const char* data, size_t length)
+	{
+		if (length > fCapacity - fLength && !_Grow(length))
+			return *this;
+		memcpy(fData + fLength, data, length);
+		fLength += length;
+		return *this;
+	}
+	TextBuilder& Append(char c, size_t count = 1)
+	{
+		if (count > fCapacity - fLength && !_Grow(count))
+			return *this;
+		memset(fData + fLength, c, count);
+		fLength += count;
+		return *this;
+	}
+
+	TextBuilder& operator<<(char c) { return Append(c); }
+	TextBuilder& operator<<(const char* string) { return Append(string, strlen(string)); }
+	TextBuilder& operator<<(std::string_view string)
+		{ return Append(string.data(), string.length()); }
+	TextBuilder& operator<<(const BString& string)
+		{ return Append(string.String(), string.Length()); }
+
+	int32 Length() const { return fLength; }
+	std::string_view View() const { return std::string_view(fData, fLength); }
+
+private:
+	TextBuilder(const TextBuilder&);
+	TextBuilder& operator=(const TextBuilder&);
+
+	bool _Grow(size_t needed);
+
+	char* fData;
+	size_t fLength;
+	size_t fCapacity;
+	status_t fStatus;
+};
+
+#endif // TEXT_BUILDER_H
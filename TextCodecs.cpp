@@ -0,0 +1,395 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "TextCodecs.h"
+
+#include <cstring>
+
+static const int32 kMimeLineLength = 76;
+static const uint32 kBase64Invalid = 0x01000000;
+
+static constexpr char kBase64Standard[]
+	= "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static constexpr char kBase64UrlSafe[]
+	= "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+
+// Two output characters for every 12 bits of input, so a three byte group is
+// encoded with two lookups
+struct Base64PairTable {
+	char pairs[4096][2];
+
+	constexpr Base64PairTable(const char* alphabet)
+		:
+		pairs()
+	{
+		for (int32 i = 0; i < 4096; i++) {
+			pairs[i][0] = alphabet[i >> 6];
+			pairs[i][1] = alphabet[i & 0x3f];
+		}
+	}
+};
+
+// The value of each character, already shifted to its position in a four
+// character group. Invalid characters set a bit no valid group can have.
+struct Base64DecodeTable {
+	uint32 shifted[4][256];
+
+	constexpr Base64DecodeTable()
+		:
+		shifted()
+	{
+		for (int32 c = 0; c < 256; c++) {
+			int32 value = -1;
+			if (c >= 'A' && c <= 'Z')
+				value = c - 'A';
+			else if (c >= 'a' && c <= 'z')
+				value = c - 'a' + 26;
+			else if (c >= '0' && c <= '9')
+				value = c - '0' + 52;
+			else if (c == '+' || c == '-')
+				value = 62;
+			else if (c == '/' || c == '_')
+				value = 63;
+
+			for (int32 k = 0; k < 4; k++)
+				shifted[k][c] = value < 0 ? kBase64Invalid : (uint32)value << (18 - 6 * k);
+		}
+	}
+};
+
+// One bit per UrlEncodeSet for the bytes that set leaves unencoded
+struct UrlClassTable {
+	uint8 keep[256];
+
+	constexpr UrlClassTable()
+		:
+		keep()
+	{
+		const uint8 all = 1 << URL_ENCODE_COMPONENT | 1 << URL_ENCODE_PATH
+			| 1 << URL_ENCODE_QUERY | 1 << URL_ENCODE_FORM;
+		for (int32 c = 0; c < 256; c++) {
+			if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+				|| c == '-' || c == '.' || c == '_' || c == '~')
+				keep[c] = all;
+		}
+
+		const char* path = "/:@!$&'()*+,;=";
+		for (const char* c = path; *c != '\0'; c++)
+			keep[(uint8)*c] |= 1 << URL_ENCODE_PATH | 1 << URL_ENCODE_QUERY;
+		keep[(uint8)'?'] |= 1 << URL_ENCODE_QUERY;
+		keep[(uint8)'*'] |= 1 << URL_ENCODE_FORM;
+		// Written as '+', see UrlEncode()
+		keep[(uint8)' '] |= 1 << URL_ENCODE_FORM;
+		// Like the WHATWG form serializer, which escapes '~'
+		keep[(uint8)'~'] &= ~(1 << URL_ENCODE_FORM);
+	}
+};
+
+struct HexValueTable {
+	int8 value[256];
+
+	constexpr HexValueTable()
+		:
+		value()
+	{
+		for (int32 c = 0; c < 256; c++) {
+			if (c >= '0' && c <= '9')
+				value[c] = c - '0';
+			else if (c >= 'A' && c <= 'F')
+				value[c] = c - 'A' + 10;
+			else if (c >= 'a' && c <= 'f')
+				value[c] = c - 'a' + 10;
+			else
+				value[c] = -1;
+		}
+	}
+};
+
+static constexpr Base64PairTable kStandardPairs(kBase64Standard);
+static constexpr Base64PairTable kUrlSafePairs(kBase64UrlSafe);
+static constexpr Base64DecodeTable kBase64Decode;
+static constexpr UrlClassTable kUrlClass;
+static constexpr HexValueTable kHexValue;
+static const char kHexDigits[] = "0123456789ABCDEF";
+
+
+Base64Encoder::Base64Encoder(Base64Variant variant)
+	:
+	fVariant(variant),
+	fPairs(variant == BASE64_URL_SAFE ? kUrlSafePairs.pairs : kStandardPairs.pairs),
+	fPendingLength(0),
+	fColumn(0)
+{
+}
+
+
+size_t
+Base64Encoder::EncodedLength(size_t length, Base64Variant variant)
+{
+	size_t characters;
+	if (variant == BASE64_URL_SAFE)
+		characters = length / 3 * 4 + (length % 3 != 0 ? length % 3 + 1 : 0);
+	else
+		characters = (length + 2) / 3 * 4;
+
+	if (variant == BASE64_MIME && characters > 0)
+		characters += (characters - 1) / kMimeLineLength;
+
+	return characters;
+}
+
+
+inline char*
+Base64Encoder::_WriteGroup(char* output, uint32 group)
+{
+	if (fVariant == BASE64_MIME) {
+		if (fColumn == kMimeLineLength) {
+			*output++ = '\n';
+			fColumn = 0;
+		}
+		fColumn += 4;
+	}
+
+	memcpy(output, fPairs[group >> 12], 2);
+	memcpy(output + 2, fPairs[group & 0xfff], 2);
+	return output + 4;
+}
+
+
+size_t
+Base64Encoder::Update(const char* data, size_t length, char* output)
+{
+	const uint8* input = (const uint8*)data;
+	const uint8* end = input + length;
+	char* out = output;
+
+	// Complete the group left over from the previous call
+	while (fPendingLength > 0 && input < end) {
+		if (fPendingLength == 2) {
+			out = _WriteGroup(out,
+				(uint32)fPending[0] << 16 | (uint32)fPending[1] << 8 | *input++);
+			fPendingLength = 0;
+		} else
+			fPending[fPendingLength++] = *input++;
+	}
+
+	// No SIMD: the lookups already outpace inserting the result into the view
+	while (end - input >= 3) {
+		out = _WriteGroup(out, (uint32)input[0] << 16 | (uint32)input[1] << 8 | input[2]);
+		input += 3;
+	}
+
+	while (input < end)
+		fPending[fPendingLength++] = *input++;
+
+	return out - output;
+}
+
+
+size_t
+Base64Encoder::Finish(char* output)
+{
+	if (fPendingLength == 0)
+		return 0;
+
+	uint32 group = (uint32)fPending[0] << 16;
+	if (fPendingLength == 2)
+		group |= (uint32)fPending[1] << 8;
+
+	char* out = _WriteGroup(output, group);
+	int32 unused = 3 - fPendingLength;
+	if (fVariant == BASE64_URL_SAFE)
+		out -= unused;
+	else
+		memset(out - unused, '=', unused);
+
+	fPendingLength = 0;
+	return out - output;
+}
+
+
+Base64Decoder::Base64Decoder(bool requirePadding)
+	:
+	fGroup(0),
+	fGroupLength(0),
+	fPadding(0),
+	fRequirePadding(requirePadding)
+{
+}
+
+
+ssize_t
+Base64Decoder::Update(const char* data, size_t length, char* output)
+{
+	const uint8* input = (const uint8*)data;
+	const uint8* end = input + length;
+	char* out = output;
+
+	while (input < end) {
+		// Four Base64 characters in a row decode with four lookups and one test
+		if (fGroupLength == 0 && fPadding == 0) {
+			while (end - input >= 4) {
+				uint32 group = kBase64Decode.shifted[0][input[0]]
+					| kBase64Decode.shifted[1][input[1]] | kBase64Decode.shifted[2][input[2]]
+					| kBase64Decode.shifted[3][input[3]];
+				if ((group & kBase64Invalid) != 0)
+					break;
+
+				out[0] = (char)(group >> 16);
+				out[1] = (char)(group >> 8);
+				out[2] = (char)group;
+				out += 3;
+				input += 4;
+			}
+			if (input == end)
+				break;
+		}
+
+		uint8 c = *input++;
+		if (c == '\n' || c == '\r')
+			continue;
+
+		if (c == '=') {
+			if (fGroupLength < 2 || fGroupLength + fPadding >= 4)
+				return B_BAD_DATA;
+
+			if (fGroupLength + ++fPadding == 4) {
+				// Keep fPadding set, nothing but line breaks may follow
+				*out++ = (char)(fGroup >> (fGroupLength == 2 ? 4 : 10));
+				if (fGroupLength == 3)
+					*out++ = (char)(fGroup >> 2);
+				fGroup = 0;
+				fGroupLength = 0;
+			}
+			continue;
+		}
+
+		uint32 value = kBase64Decode.shifted[3][c];
+		if ((value & kBase64Invalid) != 0 || fPadding > 0)
+			return B_BAD_DATA;
+
+		fGroup = fGroup << 6 | value;
+		if (++fGroupLength == 4) {
+			out[0] = (char)(fGroup >> 16);
+			out[1] = (char)(fGroup >> 8);
+			out[2] = (char)fGroup;
+			out += 3;
+			fGroup = 0;
+			fGroupLength = 0;
+		}
+	}
+
+	return out - output;
+}
+
+
+ssize_t
+Base64Decoder::Finish(char* output)
+{
+	if (fGroupLength == 0)
+		return 0;
+
+	if (fPadding > 0 || fRequirePadding || fGroupLength == 1)
+		return B_BAD_DATA;
+
+	char* out = output;
+	*out++ = (char)(fGroup >> (fGroupLength == 2 ? 4 : 10));
+	if (fGroupLength == 3)
+		*out++ = (char)(fGroup >> 2);
+
+	fGroup = 0;
+	fGroupLength = 0;
+	return out - output;
+}
+
+
+size_t
+UrlEncodedLength(const char* data, size_t length, UrlEncodeSet set)
+{
+	const uint8* input = (const uint8*)data;
+	const uint8 mask = 1 << set;
+
+	size_t encoded = length;
+	for (size_t i = 0; i < length; i++) {
+		if ((kUrlClass.keep[input[i]] & mask) == 0)
+			encoded += 2;
+	}
+	return encoded;
+}
+
+
+size_t
+UrlEncode(const char* data, size_t length, char* output, UrlEncodeSet set)
+{
+	const uint8* input = (const uint8*)data;
+	const uint8* end = input + length;
+	const uint8 mask = 1 << set;
+	char* out = output;
+
+	while (input < end) {
+		// Copy the run of bytes that stay as they are in one go
+		const uint8* run = input;
+		while (input < end && (kUrlClass.keep[*input] & mask) != 0)
+			input++;
+		if (input > run) {
+			memcpy(out, run, input - run);
+			if (set == URL_ENCODE_FORM) {
+				for (char* c = out; (c = (char*)memchr(c, ' ', input - run - (c - out)))
+						!= nullptr; c++)
+					*c = '+';
+			}
+			out += input - run;
+		}
+		if (input == end)
+			break;
+
+		out[0] = '%';
+		out[1] = kHexDigits[*input >> 4];
+		out[2] = kHexDigits[*input & 0xf];
+		out += 3;
+		input++;
+	}
+
+	return out - output;
+}
+
+
+size_t
+UrlDecode(const char* data, size_t length, char* output, bool plusAsSpace)
+{
+	const char* input = data;
+	const char* end = data + length;
+	char* out = output;
+
+	while (input < end) {
+		// Copy everything up to the next escape in one go
+		const char* escape = (const char*)memchr(input, '%', end - input);
+		const char* runEnd = escape != nullptr ? escape : end;
+		if (plusAsSpace) {
+			for (; input < runEnd; input++)
+				*out++ = *input == '+' ? ' ' : *input;
+		} else {
+			memmove(out, input, runEnd - input);
+			out += runEnd - input;
+			input = runEnd;
+		}
+		if (escape == nullptr)
+			break;
+
+		// A '%' that is not followed by two hex digits is kept as it is
+		int32 high = end - input > 2 ? kHexValue.value[(uint8)input[1]] : -1;
+		int32 low = high >= 0 ? kHexValue.value[(uint8)input[2]] : -1;
+		if (low < 0) {
+			*out++ = *input++;
+			continue;
+		}
+
+		*out++ = (char)(high << 4 | low);
+		input += 3;
+	}
+
+	return out - output;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef TEXT_CODECS_H
+#define TEXT_CODECS_H
+
+#include <SupportDefs.h>
+
+enum Base64Variant {
+	BASE64_STANDARD = 0,
+	BASE64_URL_SAFE, // '-' and '_' instead of '+' and '/', no padding
+	BASE64_MIME // Standard alphabet, lines wrapped after 76 characters
+};
+
+// Characters left as they are by UrlEncode(), on top of the unreserved
+// letters, digits and "-._~"
+enum UrlEncodeSet {
+	URL_ENCODE_COMPONENT = 0, // Everything else is encoded
+	URL_ENCODE_PATH, // Keeps "/:@!$&'()*+,;="
+	URL_ENCODE_QUERY, // Path characters and "?"
+	URL_ENCODE_FORM // Keeps "*", spaces become '+'
+};
+
+// Streaming Base64 encoder. Update() may be called any number of times, the
+// output buffer must hold EncodedLength() of all input passed so far.
+class Base64Encoder {
+public:
+	Base64Encoder(Base64Variant variant = BASE64_STANDARD);
+
+	static size_t EncodedLength(size_t length, Base64Variant variant);
+
+	size_t Update(const char* data, size_t length, char* output);
+	size_t Finish(char* output);
+
+private:
+	inline char* _WriteGroup(char* output, uint32 group);
+
+	Base64Variant fVariant;
+	const char (*fPairs)[2];
+	uint8 fPending[2];
+	int32 fPendingLength;
+	int32 fColumn;
+};
+
+// Streaming Base64 decoder accepting both the standard and the URL-safe
+// alphabet. Line breaks are skipped, anything else that is not Base64 makes
+// Update() or Finish() return B_BAD_DATA.
+class Base64Decoder {
+public:
+	Base64Decoder(bool requirePadding = false);
+
+	static size_t MaxDecodedLength(size_t length) { return length / 4 * 3 + 3; }
+
+	ssize_t Update(const char* data, size_t length, char* output);
+	ssize_t Finish(char* output);
+
+private:
+	uint32 fGroup;
+	int32 fGroupLength;
+	int32 fPadding;
+	bool fRequirePadding;
+};
+
+size_t UrlEncodedLength(const char* data, size_t length, UrlEncodeSet set);
+size_t UrlEncode(const char* data, size_t length, char* output, UrlEncodeSet set);
+size_t UrlDecode(const char* data, size_t length, char* output, bool plusAsSpace);
+
+#endif // TEXT_CODECS_H
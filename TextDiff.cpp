@@ -0,0 +1,218 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "TextDiff.h"
+
+#include <TextView.h>
+#include <algorithm>
+#include <cstring>
+
+static const int32 kResyncWindow = 32;
+static const int32 kMergeGap = 64;
+static const int32 kMaxRegions = 4096;
+// ReplaceText() writes more spans than this as one replacement
+static const int32 kMaxReplaceSpans = 16;
+
+
+static inline int32
+_LineEnd(const char* text, int32 offset, int32 end)
+{
+	const char* lineEnd = (const char*)memchr(text + offset, '\n', end - offset);
+	return lineEnd != nullptr ? lineEnd - text + 1 : end;
+}
+
+
+static inline bool
+_SameLine(const char* a, int32 aStart, int32 aEnd, const char* b, int32 bStart, int32 bEnd)
+{
+	return aEnd - aStart == bEnd - bStart && memcmp(a + aStart, b + bStart, aEnd - aStart) == 0;
+}
+
+
+static void
+_CollectLines(const char* text, int32 offset, int32 end, std::vector<int32>& bounds)
+{
+	bounds.clear();
+	bounds.push_back(offset);
+	while ((int32)bounds.size() <= kResyncWindow + 1 && bounds.back() < end)
+		bounds.push_back(_LineEnd(text, bounds.back(), end));
+}
+
+
+// Finds the length of the common prefix and suffix of both texts. Both are cut
+// at UTF-8 character boundaries and never overlap.
+void
+TrimCommonAffixes(const char* original, int32 originalLength, const char* result,
+	int32 resultLength, int32& prefix, int32& suffix)
+{
+	int32 common = std::min(originalLength, resultLength);
+	prefix = 0;
+	while (prefix < common && original[prefix] == result[prefix])
+		prefix++;
+	while (prefix > 0 && prefix < originalLength && (original[prefix] & 0xC0) == 0x80)
+		prefix--;
+
+	suffix = 0;
+	while (suffix < common - prefix
+		&& original[originalLength - 1 - suffix] == result[resultLength - 1 - suffix])
+		suffix++;
+	while (suffix > 0 && (original[originalLength - suffix] & 0xC0) == 0x80)
+		suffix--;
+}
+
+
+// Lists the regions of whole lines in which the original text and the result
+// differ. Lines are matched within a window of kResyncWindow lines; where none
+// match, the whole window is taken as changed and the search starts again
+// behind it. After kMaxRegions regions the rest becomes one region.
+void
+DiffTextLines(const char* original, int32 originalLength, const char* result, int32 resultLength,
+	std::vector<TextSpan>& regions)
+{
+	regions.clear();
+
+	int32 prefix;
+	int32 suffix;
+	TrimCommonAffixes(original, originalLength, result, resultLength, prefix, suffix);
+	if (prefix + suffix == originalLength && prefix + suffix == resultLength)
+		return;
+
+	// Only the lines touching the changed range are compared. The common
+	// suffix has to start a line on both sides.
+	while (prefix > 0 && original[prefix - 1] != '\n')
+		prefix--;
+	while (suffix > 0
+		&& ((suffix < originalLength && original[originalLength - suffix - 1] != '\n')
+			|| (suffix < resultLength && result[resultLength - suffix - 1] != '\n')))
+		suffix--;
+
+	int32 originalEnd = originalLength - suffix;
+	int32 resultEnd = resultLength - suffix;
+	int32 i = prefix;
+	int32 j = prefix;
+	std::vector<int32> originalLines;
+	std::vector<int32> resultLines;
+
+	while (i < originalEnd || j < resultEnd) {
+		int32 originalLineEnd = _LineEnd(original, i, originalEnd);
+		int32 resultLineEnd = _LineEnd(result, j, resultEnd);
+		if (i < originalEnd && j < resultEnd
+			&& _SameLine(original, i, originalLineEnd, result, j, resultLineEnd)) {
+			i = originalLineEnd;
+			j = resultLineEnd;
+			continue;
+		}
+
+		if ((int32)regions.size() == kMaxRegions - 1) {
+			regions.push_back({ i, originalEnd, j, resultEnd });
+			break;
+		}
+
+		// Resynchronize on the nearest pair of equal lines
+		_CollectLines(original, i, originalEnd, originalLines);
+		_CollectLines(result, j, resultEnd, resultLines);
+		int32 originalCount = originalLines.size() - 1;
+		int32 resultCount = resultLines.size() - 1;
+
+		int32 skipOriginal = originalCount;
+		int32 skipResult = resultCount;
+		bool found = false;
+		for (int32 distance = 1; distance <= kResyncWindow && !found; distance++) {
+			for (int32 a = 0; a <= distance; a++) {
+				int32 b = distance - a;
+				if (a >= originalCount || b >= resultCount)
+					continue;
+				if (_SameLine(original, originalLines[a], originalLines[a + 1], result,
+						resultLines[b], resultLines[b + 1])) {
+					skipOriginal = a;
+					skipResult = b;
+					found = true;
+					break;
+				}
+			}
+		}
+
+		// Windows without equal lines in between make one region
+		if (!regions.empty() && regions.back().originalEnd == i && regions.back().resultEnd == j) {
+			regions.back().originalEnd = originalLines[skipOriginal];
+			regions.back().resultEnd = resultLines[skipResult];
+		} else
+			regions.push_back({ i, originalLines[skipOriginal], j, resultLines[skipResult] });
+		i = originalLines[skipOriginal];
+		j = resultLines[skipResult];
+	}
+}
+
+
+// Lists the spans that turn the original text into the result. These are the
+// changed regions of DiffTextLines(), trimmed to the bytes that differ, and
+// joined when closer than kMergeGap, so a change touching every line gives a
+// few large spans instead of many small ones.
+void
+DiffTextSpans(const char* original, int32 originalLength, const char* result, int32 resultLength,
+	std::vector<TextSpan>& spans)
+{
+	std::vector<TextSpan> regions;
+	DiffTextLines(original, originalLength, result, resultLength, regions);
+
+	spans.clear();
+	for (TextSpan region : regions) {
+		int32 spanPrefix;
+		int32 spanSuffix;
+		TrimCommonAffixes(original + region.originalStart,
+			region.originalEnd - region.originalStart, result + region.resultStart,
+			region.resultEnd - region.resultStart, spanPrefix, spanSuffix);
+		region.originalStart += spanPrefix;
+		region.resultStart += spanPrefix;
+		region.originalEnd -= spanSuffix;
+		region.resultEnd -= spanSuffix;
+		if (region.originalStart == region.originalEnd && region.resultStart == region.resultEnd)
+			continue;
+
+		// The gap is unchanged, so it is the same on both sides
+		if (!spans.empty() && region.originalStart - spans.back().originalEnd < kMergeGap) {
+			spans.back().originalEnd = region.originalEnd;
+			spans.back().resultEnd = region.resultEnd;
+		} else
+			spans.push_back(region);
+	}
+}
+
+
+// Replaces the range [start, end) of the text view with the given text, but
+// writes only the spans that actually differ. Many spans, or spans that cover
+// most of their extent, are written as one span from the first to the last,
+// since every Delete() and Insert() relayouts the text behind it. Returns the
+// number of spans written.
+int32
+ReplaceText(BTextView* textView, int32 start, int32 end, const char* text, int32 length)
+{
+	std::vector<TextSpan> spans;
+	DiffTextSpans(textView->Text() + start, end - start, text, length, spans);
+
+	if (spans.size() > 1) {
+		int32 changed = 0;
+		for (const TextSpan& span : spans)
+			changed += span.originalEnd - span.originalStart;
+		int32 extent = spans.back().originalEnd - spans.front().originalStart;
+		if ((int32)spans.size() > kMaxReplaceSpans || changed > extent / 4 * 3) {
+			TextSpan whole = { spans.front().originalStart, spans.back().originalEnd,
+				spans.front().resultStart, spans.back().resultEnd };
+			spans.assign(1, whole);
+		}
+	}
+
+	// Back to front, so the offsets of the spans before stay valid
+	for (auto it = spans.rbegin(); it != spans.rend(); ++it) {
+		if (it->originalEnd > it->originalStart)
+			textView->Delete(start + it->originalStart, start + it->originalEnd);
+		if (it->resultEnd > it->resultStart) {
+			textView->Insert(start + it->originalStart, text + it->resultStart,
+				it->resultEnd - it->resultStart);
+		}
+	}
+
+	return spans.size();
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef TEXT_DIFF_H
+#define TEXT_DIFF_H
+
+#include <String.h>
+#include <SupportDefs.h>
+#include <string_view>
+#include <vector>
+
+class BTextView;
+
+// A changed span: bytes [originalStart, originalEnd) of the original text are
+// replaced by bytes [resultStart, resultEnd) of the result.
+struct TextSpan {
+	int32 originalStart;
+	int32 originalEnd;
+	int32 resultStart;
+	int32 resultEnd;
+};
+
+void TrimCommonAffixes(const char* original, int32 originalLength, const char* result,
+	int32 resultLength, int32& prefix, int32& suffix);
+void DiffTextLines(const char* original, int32 originalLength, const char* result,
+	int32 resultLength, std::vector<TextSpan>& regions);
+void DiffTextSpans(const char* original, int32 originalLength, const char* result,
+	int32 resultLength, std::vector<TextSpan>& spans);
+
+int32 ReplaceText(BTextView* textView, int32 start, int32 end, const char* text, int32 length);
+
+
+inline int32
+ReplaceText(BTextView* textView, int32 start, int32 end, const BString& text)
+{
+	return ReplaceText(textView, start, end, text.String(), text.Length());
+}
+
+
+inline int32
+ReplaceText(BTextView* textView, int32 start, int32 end, std::string_view text)
+{
+	return ReplaceText(textView, start, end, text.data(), text.length());
+}
+
+#endif // TEXT_DIFF_H
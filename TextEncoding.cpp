@@ -0,0 +1,443 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "TextEncoding.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unicode/ucnv.h>
+#include <unicode/ucsdet.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The charset detector only needs a sample, and larger ones slow it down
+static const size_t kDetectSampleSize = 64 * 1024;
+
+// Most bytes of ISO-8859-1 mean the same in windows-1252, which also has
+// letters and punctuation where ISO-8859-1 has control codes. A sample
+// without those cannot tell them apart, but the file may still have them.
+static const char* kDefaultLegacyEncoding = "windows-1252";
+
+
+#if defined(__SSE2__)
+static inline void
+_AddLanes(__m128i& lanes, uint64& count)
+{
+	uint64 sums[2];
+	_mm_storeu_si128((__m128i*)sums, _mm_sad_epu8(lanes, _mm_setzero_si128()));
+	count += sums[0] + sums[1];
+	lanes = _mm_setzero_si128();
+}
+#endif
+
+
+TextEncoding::TextEncoding()
+	:
+	name("UTF-8"),
+	byteOrderMark(false)
+{
+}
+
+
+TextEncoding::TextEncoding(const char* name, bool byteOrderMark)
+	:
+	name(name),
+	byteOrderMark(byteOrderMark)
+{
+}
+
+
+bool
+TextEncoding::IsUTF8() const
+{
+	return name.ICompare("UTF-8") == 0;
+}
+
+
+bool
+TextEncoding::IsUnicode() const
+{
+	return name.IStartsWith("UTF-");
+}
+
+
+//	#pragma mark - TextScanner
+
+
+TextScan::TextScan()
+	:
+	length(0),
+	invalidSequences(0),
+	firstInvalid(-1),
+	nulBytes(0),
+	controlBytes(0),
+	lineFeeds(0),
+	carriageReturns(0),
+	crlfPairs(0)
+{
+}
+
+
+bool
+TextScan::IsBinary() const
+{
+	// Text may have a few stray control codes, or a damaged block of zeros
+	// as logs get after a crash
+	return nulBytes * 100 > length || controlBytes * 100 > length;
+}
+
+
+LineEndings
+TextScan::GetLineEndings() const
+{
+	uint64 lineFeedsOnly = lineFeeds - crlfPairs;
+	uint64 carriageReturnsOnly = carriageReturns - crlfPairs;
+	int32 styles = (lineFeedsOnly > 0) + (crlfPairs > 0) + (carriageReturnsOnly > 0);
+	if (styles > 1)
+		return LINE_ENDINGS_MIXED;
+	if (crlfPairs > 0)
+		return LINE_ENDINGS_CRLF;
+	if (carriageReturnsOnly > 0)
+		return LINE_ENDINGS_CR;
+	if (lineFeedsOnly > 0)
+		return LINE_ENDINGS_LF;
+	return LINE_ENDINGS_NONE;
+}
+
+
+TextScanner::TextScanner()
+	:
+	fPendingCR(false)
+{
+}
+
+
+void
+TextScanner::Add(const char* data, size_t length)
+{
+	if (length == 0)
+		return;
+
+	const uint8* bytes = (const uint8*)data;
+	if (fPendingCR && bytes[0] == '\n')
+		fScan.crlfPairs++;
+
+	size_t i = 0;
+#if defined(__SSE2__)
+	// The bytes are counted 16 at a time in byte lanes, which are added up
+	// before they can overflow. Only the characters beyond ASCII are looked at
+	// one by one. The byte after a chunk is read to find its CR LF pairs.
+	const __m128i zero = _mm_setzero_si128();
+	__m128i nuls = zero;
+	__m128i controls = zero;
+	__m128i lineFeeds = zero;
+	__m128i carriageReturns = zero;
+	__m128i pairs = zero;
+	int32 rounds = 0;
+	size_t checked = 0;
+	for (; i + 17 <= length; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i*)(bytes + i));
+		__m128i next = _mm_loadu_si128((const __m128i*)(bytes + i + 1));
+		__m128i nul = _mm_cmpeq_epi8(chunk, zero);
+		__m128i lineFeed = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'));
+		__m128i carriageReturn = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'));
+		__m128i allowed = _mm_or_si128(nul,
+			_mm_or_si128(_mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('\t' - 1)),
+				_mm_cmplt_epi8(chunk, _mm_set1_epi8('\r' + 1))),
+			_mm_cmpeq_epi8(chunk, _mm_set1_epi8(0x1b))));
+		// Bytes beyond ASCII are negative, and not control codes
+		__m128i low = _mm_and_si128(_mm_cmplt_epi8(chunk, _mm_set1_epi8(0x20)),
+			_mm_cmpgt_epi8(chunk, _mm_set1_epi8(-1)));
+		__m128i control = _mm_or_si128(_mm_andnot_si128(allowed, low),
+			_mm_cmpeq_epi8(chunk, _mm_set1_epi8(0x7f)));
+
+		// Matches are -1, so subtracting them counts up
+		nuls = _mm_sub_epi8(nuls, nul);
+		controls = _mm_sub_epi8(controls, control);
+		lineFeeds = _mm_sub_epi8(lineFeeds, lineFeed);
+		carriageReturns = _mm_sub_epi8(carriageReturns, carriageReturn);
+		pairs = _mm_sub_epi8(pairs,
+			_mm_and_si128(carriageReturn, _mm_cmpeq_epi8(next, _mm_set1_epi8('\n'))));
+
+		// Check the characters that start in this chunk, skipping the rest of
+		// one that started in the one before
+		uint32 pending = _mm_movemask_epi8(chunk);
+		if (checked > i)
+			pending &= ~0u << (checked - i);
+		while (pending != 0) {
+			checked = _ScanCharacter(bytes, i + __builtin_ctz(pending), length);
+			pending = checked - i < 16 ? pending & (~0u << (checked - i)) : 0;
+		}
+
+		if (++rounds == 255) {
+			_AddLanes(nuls, fScan.nulBytes);
+			_AddLanes(controls, fScan.controlBytes);
+			_AddLanes(lineFeeds, fScan.lineFeeds);
+			_AddLanes(carriageReturns, fScan.carriageReturns);
+			_AddLanes(pairs, fScan.crlfPairs);
+			rounds = 0;
+		}
+	}
+	_AddLanes(nuls, fScan.nulBytes);
+	_AddLanes(controls, fScan.controlBytes);
+	_AddLanes(lineFeeds, fScan.lineFeeds);
+	_AddLanes(carriageReturns, fScan.carriageReturns);
+	_AddLanes(pairs, fScan.crlfPairs);
+
+	// A character may reach into the rest, which holds no ASCII before it ends
+	i = std::max(i, checked);
+#endif
+	_ScanBytes(bytes, i, length);
+
+	fPendingCR = bytes[length - 1] == '\r';
+	fScan.length += length;
+}
+
+
+void
+TextScanner::_ScanBytes(const uint8* bytes, size_t i, size_t length)
+{
+	while (i < length) {
+		uint8 c = bytes[i];
+		if (c >= 0x80) {
+			i = _ScanCharacter(bytes, i, length);
+			continue;
+		}
+
+		if (c == '\n')
+			fScan.lineFeeds++;
+		else if (c == '\r') {
+			fScan.carriageReturns++;
+			if (i + 1 < length && bytes[i + 1] == '\n')
+				fScan.crlfPairs++;
+		} else if (c == 0)
+			fScan.nulBytes++;
+		else if ((c < 0x20 && (c < '\t' || c > '\r') && c != 0x1b) || c == 0x7f)
+			fScan.controlBytes++;
+		i++;
+	}
+}
+
+
+// Validates the character beyond ASCII that starts at i, and returns where it
+// ends. Well-formed UTF-8 is as defined by RFC 3629, which rules out overlong
+// forms, surrogates and code points beyond U+10FFFF. An invalid sequence is
+// its longest start that could still have become a character, or one byte,
+// so it never takes an ASCII byte with it.
+size_t
+TextScanner::_ScanCharacter(const uint8* bytes, size_t i, size_t length)
+{
+	uint8 c = bytes[i];
+	size_t trailing = 0;
+	uint8 min = 0x80;
+	uint8 max = 0xbf;
+	if (c >= 0xc2 && c <= 0xdf)
+		trailing = 1;
+	else if (c >= 0xe0 && c <= 0xef) {
+		trailing = 2;
+		if (c == 0xe0)
+			min = 0xa0;
+		else if (c == 0xed)
+			max = 0x9f;
+	} else if (c >= 0xf0 && c <= 0xf4) {
+		trailing = 3;
+		if (c == 0xf0)
+			min = 0x90;
+		else if (c == 0xf4)
+			max = 0x8f;
+	}
+
+	size_t valid = 0;
+	while (valid < trailing && i + valid + 1 < length) {
+		uint8 next = bytes[i + valid + 1];
+		if (valid == 0 ? (next < min || next > max) : (next & 0xc0) != 0x80)
+			break;
+		valid++;
+	}
+	if (trailing == 0 || valid < trailing) {
+		if (fScan.firstInvalid < 0)
+			fScan.firstInvalid = fScan.length + i;
+		fScan.invalidSequences++;
+	}
+	return i + valid + 1;
+}
+
+
+//	#pragma mark - EncodingConverter
+
+
+EncodingConverter::EncodingConverter(const char* from, const char* to)
+	:
+	fSource(nullptr),
+	fTarget(nullptr),
+	fPivotSource(fPivot),
+	fPivotTarget(fPivot),
+	fReset(true)
+{
+	UErrorCode error = U_ZERO_ERROR;
+	fSource = ucnv_open(from, &error);
+	fTarget = ucnv_open(to, &error);
+	ucnv_setToUCallBack(fSource, UCNV_TO_U_CALLBACK_STOP, NULL, NULL, NULL, &error);
+	ucnv_setFromUCallBack(fTarget, UCNV_FROM_U_CALLBACK_STOP, NULL, NULL, NULL, &error);
+	if (U_FAILURE(error)) {
+		ucnv_close(fSource);
+		ucnv_close(fTarget);
+		fSource = nullptr;
+		fTarget = nullptr;
+	}
+}
+
+
+EncodingConverter::~EncodingConverter()
+{
+	ucnv_close(fSource);
+	ucnv_close(fTarget);
+}
+
+
+status_t
+EncodingConverter::InitCheck() const
+{
+	return fSource != nullptr && fTarget != nullptr ? B_OK : B_BAD_VALUE;
+}
+
+
+status_t
+EncodingConverter::Convert(const char* data, size_t length, std::string& output, bool flush)
+{
+	if (InitCheck() != B_OK)
+		return B_NO_INIT;
+
+	const char* source = length > 0 ? data : "";
+	const char* sourceLimit = source + length;
+	for (;;) {
+		// Room for most text in one pass, the rest takes another
+		size_t used = output.size();
+		output.resize(used + (sourceLimit - source) * 2 + 64);
+		char* target = output.data() + used;
+
+		UErrorCode error = U_ZERO_ERROR;
+		ucnv_convertEx(fTarget, fSource, &target, output.data() + output.size(), &source,
+			sourceLimit, fPivot, &fPivotSource, &fPivotTarget, fPivot + kPivotSize, fReset, flush,
+			&error);
+		fReset = false;
+		output.resize(target - output.data());
+
+		if (error == U_BUFFER_OVERFLOW_ERROR)
+			continue;
+		return U_SUCCESS(error) ? B_OK : B_BAD_DATA;
+	}
+}
+
+
+//	#pragma mark - Detection
+
+
+// Returns the end of a block of the data that ends no later than offset,
+// before the start of a character rather than inside one.
+size_t
+CharacterBoundary(const char* data, size_t length, size_t offset)
+{
+	if (offset >= length)
+		return length;
+
+	for (size_t end = offset; offset - end < 4; end--) {
+		if (((uint8)data[end] & 0xc0) != 0x80)
+			return end;
+		if (end == 0)
+			break;
+	}
+	// Too many continuation bytes for one character, the block may end anywhere
+	return offset;
+}
+
+
+// Returns the length of the byte order mark the data starts with, or 0.
+size_t
+DetectByteOrderMark(const char* data, size_t length, TextEncoding* encoding)
+{
+	static const struct {
+		const char* mark;
+		size_t length;
+		const char* name;
+	} kMarks[] = {
+		// UTF-32LE first, its mark starts with that of UTF-16LE
+		{"\xff\xfe\x00\x00", 4, "UTF-32LE"},
+		{"\x00\x00\xfe\xff", 4, "UTF-32BE"},
+		{"\xef\xbb\xbf", 3, "UTF-8"},
+		{"\xff\xfe", 2, "UTF-16LE"},
+		{"\xfe\xff", 2, "UTF-16BE"}
+	};
+
+	for (const auto& mark : kMarks) {
+		if (length >= mark.length && memcmp(data, mark.mark, mark.length) == 0) {
+			if (encoding != nullptr)
+				*encoding = TextEncoding(mark.name, true);
+			return mark.length;
+		}
+	}
+	return 0;
+}
+
+
+// Recognizes UTF-16 without a byte order mark by its zero bytes: most text
+// is in the first 256 code points, which have a zero high byte, while the
+// low byte is rarely zero.
+bool
+DetectUTF16(const char* data, size_t length, TextEncoding* encoding)
+{
+	size_t pairs = std::min(length, kDetectSampleSize) / 2;
+	if (pairs == 0)
+		return false;
+
+	size_t evenZeros = 0;
+	size_t oddZeros = 0;
+	for (size_t i = 0; i < pairs; i++) {
+		evenZeros += data[2 * i] == 0;
+		oddZeros += data[2 * i + 1] == 0;
+	}
+
+	const char* name = nullptr;
+	if (oddZeros * 10 >= pairs * 3 && evenZeros * 20 < pairs)
+		name = "UTF-16LE";
+	else if (evenZeros * 10 >= pairs * 3 && oddZeros * 20 < pairs)
+		name = "UTF-16BE";
+	else
+		return false;
+
+	if (encoding != nullptr)
+		*encoding = TextEncoding(name);
+	return true;
+}
+
+
+// Guesses the encoding of text that is not Unicode from a sample of it, using
+// the statistics ICU keeps of the common legacy encodings.
+TextEncoding
+DetectLegacyEncoding(const char* data, size_t length)
+{
+	TextEncoding encoding(kDefaultLegacyEncoding);
+
+	UErrorCode error = U_ZERO_ERROR;
+	UCharsetDetector* detector = ucsdet_open(&error);
+	ucsdet_setText(detector, data, std::min(length, kDetectSampleSize), &error);
+	const UCharsetMatch* match = ucsdet_detect(detector, &error);
+	const char* name = U_SUCCESS(error) && match != NULL ? ucsdet_getName(match, &error) : NULL;
+
+	// Unicode was ruled out before, the detector may still name it for
+	// text that is mostly ASCII
+	if (U_SUCCESS(error) && name != NULL && strncmp(name, "UTF-", 4) != 0
+		&& strcmp(name, "ISO-8859-1") != 0) {
+		UConverter* converter = ucnv_open(name, &error);
+		if (U_SUCCESS(error))
+			encoding.name = name;
+		ucnv_close(converter);
+	}
+
+	ucsdet_close(detector);
+	return encoding;
+}
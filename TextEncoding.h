@@ -0,0 +1,106 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef TEXT_ENCODING_H
+#define TEXT_ENCODING_H
+
+#include <String.h>
+#include <SupportDefs.h>
+#include <string>
+#include <unicode/umachine.h>
+
+struct UConverter;
+
+enum LineEndings {
+	LINE_ENDINGS_NONE = 0,
+	LINE_ENDINGS_LF,
+	LINE_ENDINGS_CRLF,
+	LINE_ENDINGS_CR,
+	LINE_ENDINGS_MIXED
+};
+
+// What a scan of the bytes of a file found. Files with more than a few zero
+// bytes or control codes are taken for binary data.
+struct TextScan {
+	TextScan();
+
+	bool IsValidUTF8() const { return invalidSequences == 0; }
+	bool IsBinary() const;
+	LineEndings GetLineEndings() const;
+
+	uint64 length;
+	uint64 invalidSequences;
+	int64 firstInvalid;
+	uint64 nulBytes;
+	uint64 controlBytes; // Other than tabs, line and page breaks and escapes
+	uint64 lineFeeds;
+	uint64 carriageReturns;
+	uint64 crlfPairs;
+};
+
+// Validates UTF-8 and counts the bytes that tell text from binary data, 16
+// bytes at a time where SSE2 is available. Text can be added in blocks, which
+// have to end where a character starts.
+class TextScanner {
+public:
+	TextScanner();
+
+	void Add(const char* data, size_t length);
+	const TextScan& Result() const { return fScan; }
+
+private:
+	void _ScanBytes(const uint8* bytes, size_t i, size_t length);
+	size_t _ScanCharacter(const uint8* bytes, size_t i, size_t length);
+
+	TextScan fScan;
+	bool fPendingCR;
+};
+
+// The character set of a file, as named by ICU, and whether it starts with a
+// byte order mark. Files are read as and written back in their encoding.
+struct TextEncoding {
+	TextEncoding();
+	TextEncoding(const char* name, bool byteOrderMark = false);
+
+	bool IsUTF8() const;
+	bool IsUnicode() const;
+
+	BString name;
+	bool byteOrderMark;
+};
+
+// Converts text between two encodings in pieces of any size, keeping the
+// state of characters split between pieces. Input that is not valid in the
+// source encoding, or has no form in the target one, is an error rather than
+// silently replaced.
+class EncodingConverter {
+public:
+	EncodingConverter(const char* from, const char* to);
+	~EncodingConverter();
+
+	status_t InitCheck() const;
+
+	// Appends the converted text to output. The last piece is flushed.
+	status_t Convert(const char* data, size_t length, std::string& output, bool flush);
+
+private:
+	EncodingConverter(const EncodingConverter&);
+	EncodingConverter& operator=(const EncodingConverter&);
+
+	static const size_t kPivotSize = 1024;
+
+	UConverter* fSource;
+	UConverter* fTarget;
+	UChar fPivot[kPivotSize];
+	UChar* fPivotSource;
+	UChar* fPivotTarget;
+	bool fReset;
+};
+
+size_t CharacterBoundary(const char* data, size_t length, size_t offset);
+size_t DetectByteOrderMark(const char* data, size_t length, TextEncoding* encoding = nullptr);
+bool DetectUTF16(const char* data, size_t length, TextEncoding* encoding = nullptr);
+TextEncoding DetectLegacyEncoding(const char* data, size_t length);
+
+#endif // TEXT_ENCODING_H
@@ -0,0 +1,638 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "TextFile.h"
+#include "Constants.h"
+
+#include <Node.h>
+#include <NodeInfo.h>
+#include <Path.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const size_t kReadBlockSize = 4 * 1024 * 1024;
+static const size_t kScanBlockSize = 4 * 1024 * 1024;
+static const size_t kConvertBlockSize = 4 * 1024 * 1024;
+static const size_t kWriteBlockSize = 4 * 1024 * 1024;
+
+
+// Copies the attributes of one file to another. The style runs and encoding
+// of the old contents may not apply to the new text, so they are left out.
+// Volumes without attributes are not an error.
+static void
+_CopyAttributes(const char* from, const char* to)
+{
+	BNode source(from);
+	BNode target(to);
+	if (source.InitCheck() != B_OK || target.InitCheck() != B_OK)
+		return;
+
+	char name[B_ATTR_NAME_LENGTH];
+	while (source.GetNextAttrName(name) == B_OK) {
+		if (strcmp(name, "styles") == 0 || strcmp(name, "be:encoding") == 0)
+			continue;
+
+		attr_info info;
+		if (source.GetAttrInfo(name, &info) != B_OK)
+			continue;
+		std::unique_ptr<char[]> buffer(new(std::nothrow) char[info.size]);
+		if (!buffer)
+			continue;
+		ssize_t size = source.ReadAttr(name, info.type, 0, buffer.get(), info.size);
+		if (size >= 0)
+			target.WriteAttr(name, info.type, 0, buffer.get(), size);
+	}
+}
+
+
+DescriptorIO::DescriptorIO(int fd)
+	:
+	fFD(fd)
+{
+}
+
+
+ssize_t
+DescriptorIO::Read(void* buffer, size_t size)
+{
+	for (;;) {
+		ssize_t bytesRead = read(fFD, buffer, size);
+		if (bytesRead >= 0)
+			return bytesRead;
+		if (errno != EINTR)
+			return errno;
+	}
+}
+
+
+ssize_t
+DescriptorIO::Write(const void* buffer, size_t size)
+{
+	for (;;) {
+		ssize_t written = write(fFD, buffer, size);
+		if (written >= 0)
+			return written;
+		if (errno != EINTR)
+			return errno;
+	}
+}
+
+
+//	#pragma mark - MappedFile
+
+
+MappedFile::MappedFile()
+	:
+	fData(nullptr),
+	fSize(0),
+	fMapped(false)
+{
+}
+
+
+MappedFile::~MappedFile()
+{
+	Unset();
+}
+
+
+status_t
+MappedFile::SetTo(const char* path)
+{
+	Unset();
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return errno;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		status_t status = errno;
+		close(fd);
+		return status;
+	}
+	if (!S_ISREG(st.st_mode)) {
+		close(fd);
+		return B_BAD_VALUE;
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		return B_OK;
+	}
+	if ((uint64)st.st_size > SIZE_MAX) {
+		close(fd);
+		return B_FILE_TOO_LARGE;
+	}
+
+	// The mapping stays valid after the file is closed
+	size_t size = st.st_size;
+	void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data != MAP_FAILED) {
+		close(fd);
+		fData = (char*)data;
+		fSize = size;
+		fMapped = true;
+		return B_OK;
+	}
+
+	fData = (char*)malloc(size);
+	if (fData == nullptr) {
+		close(fd);
+		return B_NO_MEMORY;
+	}
+
+	// The file may shrink while it is read, then only what is there counts
+	while (fSize < size) {
+		ssize_t bytesRead = read(fd, fData + fSize, std::min(size - fSize, kReadBlockSize));
+		if (bytesRead < 0 && errno == EINTR)
+			continue;
+		if (bytesRead < 0) {
+			status_t status = errno;
+			close(fd);
+			Unset();
+			return status;
+		}
+		if (bytesRead == 0)
+			break;
+		fSize += bytesRead;
+	}
+
+	close(fd);
+	return B_OK;
+}
+
+
+void
+MappedFile::Unset()
+{
+	if (fMapped)
+		munmap(fData, fSize);
+	else
+		free(fData);
+
+	fData = nullptr;
+	fSize = 0;
+	fMapped = false;
+}
+
+
+//	#pragma mark - TextFileLoader
+
+
+TextFileLoader::TextFileLoader(const char* path, BMessenger target, int32 id)
+	:
+	fPath(path),
+	fTarget(target),
+	fID(id),
+	fThread(-1),
+	fCancelled(0),
+	fStatus(B_NO_INIT),
+	fPercent(-1),
+	fText(nullptr),
+	fTextLength(0)
+{
+}
+
+
+TextFileLoader::~TextFileLoader()
+{
+	Cancel();
+	if (fThread >= 0) {
+		status_t result;
+		wait_for_thread(fThread, &result);
+	}
+}
+
+
+status_t
+TextFileLoader::Start()
+{
+	fThread = spawn_thread(_LoadThread, "load file", B_NORMAL_PRIORITY, this);
+	if (fThread < B_OK)
+		return fThread;
+
+	status_t status = resume_thread(fThread);
+	if (status != B_OK) {
+		kill_thread(fThread);
+		fThread = -1;
+	}
+	return status;
+}
+
+
+void
+TextFileLoader::Cancel()
+{
+	atomic_set(&fCancelled, 1);
+}
+
+
+status_t
+TextFileLoader::_LoadThread(void* data)
+{
+	TextFileLoader* loader = (TextFileLoader*)data;
+	loader->fStatus = loader->_Load();
+
+	BMessage message(M_FILE_LOADED);
+	message.AddInt32("id", loader->fID);
+	loader->fTarget.SendMessage(&message);
+	return loader->fStatus;
+}
+
+
+// Reads the mapped file in blocks, which also pages it in, so the reading
+// happens on this thread rather than in the text view. Compressed files are
+// decompressed into memory first. UTF-8 is recognized by its byte order mark
+// or by being valid, UTF-16 by its byte order mark or zero bytes, and any
+// other encoding is guessed from where the file stops being valid UTF-8.
+status_t
+TextFileLoader::_Load()
+{
+	status_t status = fFile.SetTo(fPath.String());
+	if (status != B_OK)
+		return status;
+	if (fFile.Size() > (size_t)INT32_MAX)
+		return B_FILE_TOO_LARGE;
+
+	const char* data = fFile.Data();
+	size_t size = fFile.Size();
+	fCompression = DetectCompression(data, size);
+	if (fCompression.format != COMPRESSION_NONE) {
+		status = _Decompress(data, size);
+		if (status != B_OK)
+			return status;
+		data = fDecompressed.data();
+		size = fDecompressed.size();
+	}
+
+	size_t markLength = DetectByteOrderMark(data, size, &fEncoding);
+	if (markLength == 0)
+		DetectUTF16(data, size, &fEncoding);
+
+	if (fEncoding.IsUTF8()) {
+		status = _Scan(data + markLength, size - markLength);
+		if (status != B_OK)
+			return status;
+		if (fScan.IsValidUTF8()) {
+			fText = data + markLength;
+			fTextLength = size - markLength;
+			return B_OK;
+		}
+
+		// The bytes that are not UTF-8 tell the most about the encoding
+		size_t invalidOffset = fScan.firstInvalid;
+		size_t sampleStart = markLength + invalidOffset - std::min(invalidOffset, (size_t)1024);
+		fEncoding = DetectLegacyEncoding(data + sampleStart, size - sampleStart);
+		markLength = 0;
+	}
+
+	status = _Convert(data + markLength, size - markLength);
+	if (status == B_BAD_DATA && !fEncoding.IsUnicode()) {
+		// Every byte is a character in ISO-8859-1, so the text at least
+		// reads back unchanged
+		fEncoding = TextEncoding("ISO-8859-1");
+		status = _Convert(data, size);
+	}
+	if (status == B_OK && fEncoding.IsUnicode()) {
+		// The line breaks of UTF-16 and UTF-32 are only found once converted
+		TextScanner scanner;
+		scanner.Add(fText, fTextLength);
+		fScan = scanner.Result();
+	}
+	return status;
+}
+
+
+status_t
+TextFileLoader::_Decompress(const char* data, size_t size)
+{
+	BMemoryIO source(data, size);
+	DecompressingIO input(&source);
+	fDecompressed.clear();
+	for (;;) {
+		if (atomic_get(&fCancelled) != 0)
+			return B_CANCELED;
+
+		size_t used = fDecompressed.size();
+		fDecompressed.resize(used + kReadBlockSize);
+		ssize_t bytesRead = input.Read(fDecompressed.data() + used, kReadBlockSize);
+		fDecompressed.resize(used + std::max(bytesRead, (ssize_t)0));
+		if (bytesRead < 0)
+			return bytesRead;
+		if (bytesRead == 0)
+			break;
+		if (fDecompressed.size() > (size_t)INT32_MAX)
+			return B_FILE_TOO_LARGE;
+
+		_ReportProgress(source.Position(), size);
+	}
+
+	fFile.Unset();
+	return B_OK;
+}
+
+
+// Validates the whole file, and counts its line breaks and the bytes that
+// make it look binary.
+status_t
+TextFileLoader::_Scan(const char* data, size_t size)
+{
+	TextScanner scanner;
+	for (size_t offset = 0; offset < size;) {
+		if (atomic_get(&fCancelled) != 0)
+			return B_CANCELED;
+
+		// A block ending before a lead byte holds whole characters, so the
+		// blocks are valid exactly when the file is
+		size_t end = CharacterBoundary(data, size, offset + kScanBlockSize);
+		scanner.Add(data + offset, end - offset);
+		offset = end;
+		_ReportProgress(offset, size);
+	}
+
+	fScan = scanner.Result();
+	return B_OK;
+}
+
+
+status_t
+TextFileLoader::_Convert(const char* data, size_t size)
+{
+	EncodingConverter converter(fEncoding.name.String(), "UTF-8");
+	status_t status = converter.InitCheck();
+	if (status != B_OK)
+		return status;
+
+	fConverted.clear();
+	fConverted.reserve(size);
+	size_t offset = 0;
+	do {
+		if (atomic_get(&fCancelled) != 0)
+			return B_CANCELED;
+
+		// The converter keeps what is left of a character cut at the end of
+		// a block for the next one
+		size_t end = std::min(offset + kConvertBlockSize, size);
+		status = converter.Convert(data + offset, end - offset, fConverted, end == size);
+		if (status != B_OK)
+			return status;
+		if (fConverted.size() > (size_t)INT32_MAX)
+			return B_FILE_TOO_LARGE;
+		offset = end;
+		_ReportProgress(offset, size);
+	} while (offset < size);
+
+	fText = fConverted.data();
+	fTextLength = fConverted.size();
+	fFile.Unset();
+	return B_OK;
+}
+
+
+void
+TextFileLoader::_ReportProgress(size_t done, size_t total)
+{
+	int32 percent = total > 0 ? (int32)((uint64)done * 100 / total) : 100;
+	if (percent == fPercent)
+		return;
+
+	// Progress is dropped rather than waited for when the window is busy
+	BMessage progress(M_FILE_LOAD_PROGRESS);
+	progress.AddInt32("id", fID);
+	progress.AddInt32("percent", percent);
+	fTarget.SendMessage(&progress, (BHandler*)NULL, 0);
+	fPercent = percent;
+}
+
+
+//	#pragma mark - TextFileSaver
+
+
+TextFileSaver::TextFileSaver(const char* path, const BString& text,
+	const TextEncoding& encoding, const Compression& compression, BMessenger target)
+	:
+	fPath(path),
+	fText(text),
+	fEncoding(encoding),
+	fCompression(compression),
+	fTarget(target),
+	fThread(-1),
+	fStatus(B_NO_INIT)
+{
+}
+
+
+TextFileSaver::~TextFileSaver()
+{
+	// A save is never abandoned halfway
+	if (fThread >= 0) {
+		status_t result;
+		wait_for_thread(fThread, &result);
+	}
+}
+
+
+status_t
+TextFileSaver::Start()
+{
+	fThread = spawn_thread(_SaveThread, "save file", B_NORMAL_PRIORITY, this);
+	if (fThread < B_OK)
+		return fThread;
+
+	status_t status = resume_thread(fThread);
+	if (status != B_OK) {
+		kill_thread(fThread);
+		fThread = -1;
+	}
+	return status;
+}
+
+
+status_t
+TextFileSaver::_SaveThread(void* data)
+{
+	TextFileSaver* saver = (TextFileSaver*)data;
+	saver->fStatus = saver->_Save();
+
+	saver->fTarget.SendMessage(M_FILE_SAVED);
+	return saver->fStatus;
+}
+
+
+status_t
+TextFileSaver::_Save()
+{
+	BPath path(fPath.String());
+	BPath directory;
+	status_t status = path.GetParent(&directory);
+	if (status != B_OK)
+		return status;
+
+	// A rename would leave the other links to the file with the old text
+	struct stat st;
+	bool exists = stat(fPath.String(), &st) == 0;
+	if (exists && st.st_nlink > 1)
+		return _SaveInPlace();
+
+	BString tempPath;
+	tempPath.SetToFormat("%s/.%s.XXXXXX", directory.Path(), path.Leaf());
+	int fd = mkstemp(tempPath.LockBuffer(0));
+	tempPath.UnlockBuffer();
+	if (fd < 0) {
+		// Without the right to create files in the directory, the file can
+		// still be overwritten
+		if (errno == EACCES || errno == EPERM || errno == EROFS)
+			return _SaveInPlace();
+		return errno;
+	}
+
+	// Keep the owner and group of someone else's file, as far as we may. This
+	// comes before fchmod(), which a change of owner could undo.
+	if (exists && fchown(fd, st.st_uid, st.st_gid) != 0 && errno == EPERM)
+		fchown(fd, (uid_t)-1, st.st_gid);
+	fchmod(fd, exists ? (st.st_mode & 07777) : 0644);
+
+	status = _WriteText(fd);
+	if (status == B_OK) {
+		if (exists)
+			_CopyAttributes(fPath.String(), tempPath.String());
+
+		BNode node(tempPath.String());
+		BNodeInfo nodeInfo(&node);
+		char type[B_MIME_TYPE_LENGTH];
+		if (nodeInfo.GetType(type) != B_OK)
+			nodeInfo.SetType("text/plain");
+	}
+	if (status == B_OK && fsync(fd) != 0)
+		status = errno;
+	close(fd);
+
+	if (status == B_OK && rename(tempPath.String(), fPath.String()) != 0)
+		status = errno;
+	if (status != B_OK) {
+		unlink(tempPath.String());
+		return status;
+	}
+
+	// Make the rename itself durable
+	int directoryFD = open(directory.Path(), O_RDONLY);
+	if (directoryFD >= 0) {
+		fsync(directoryFD);
+		close(directoryFD);
+	}
+	return B_OK;
+}
+
+
+status_t
+TextFileSaver::_SaveInPlace()
+{
+	int fd = open(fPath.String(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return errno;
+
+	status_t status = _WriteText(fd);
+	if (status == B_OK && fsync(fd) != 0)
+		status = errno;
+	close(fd);
+
+	if (status == B_OK) {
+		BNode node(fPath.String());
+		node.RemoveAttr("styles");
+		node.RemoveAttr("be:encoding");
+
+		BNodeInfo nodeInfo(&node);
+		char type[B_MIME_TYPE_LENGTH];
+		if (nodeInfo.GetType(type) != B_OK)
+			nodeInfo.SetType("text/plain");
+	}
+	return status;
+}
+
+
+// Writes the text in the encoding of the file. Text with characters that
+// encoding has no form for is written as UTF-8 instead, so nothing is lost.
+status_t
+TextFileSaver::_WriteText(int fd)
+{
+	if (!fEncoding.IsUTF8()) {
+		status_t status = _WriteCompressed(fd);
+		if (status != B_BAD_DATA)
+			return status;
+
+		fEncoding = TextEncoding();
+		if (lseek(fd, 0, SEEK_SET) != 0 || ftruncate(fd, 0) != 0)
+			return errno;
+	}
+	return _WriteCompressed(fd);
+}
+
+
+// Compresses the text the way the file was, if it was
+status_t
+TextFileSaver::_WriteCompressed(int fd)
+{
+	DescriptorIO file(fd);
+	if (fCompression.format == COMPRESSION_NONE)
+		return _WriteEncoded(&file);
+
+	CompressingIO compressed(&file, fCompression);
+	status_t status = compressed.InitCheck();
+	if (status == B_OK)
+		status = _WriteEncoded(&compressed);
+	if (status == B_OK)
+		status = compressed.Finish();
+	return status;
+}
+
+
+status_t
+TextFileSaver::_WriteEncoded(BDataIO* output)
+{
+	if (fEncoding.IsUTF8()) {
+		status_t status = B_OK;
+		if (fEncoding.byteOrderMark)
+			status = output->WriteExactly("\xef\xbb\xbf", 3);
+		if (status == B_OK)
+			status = output->WriteExactly(fText.String(), fText.Length());
+		return status;
+	}
+
+	EncodingConverter converter("UTF-8", fEncoding.name.String());
+	if (converter.InitCheck() != B_OK)
+		return B_BAD_DATA;
+
+	// The byte order mark of the encoding is that of UTF-8 converted to it
+	std::string buffer;
+	status_t status = B_OK;
+	if (fEncoding.byteOrderMark)
+		status = converter.Convert("\xef\xbb\xbf", 3, buffer, false);
+
+	const char* text = fText.String();
+	size_t length = fText.Length();
+	size_t offset = 0;
+	while (status == B_OK) {
+		size_t end = std::min(offset + kWriteBlockSize, length);
+		status = converter.Convert(text + offset, end - offset, buffer, end == length);
+		if (status == B_OK)
+			status = output->WriteExactly(buffer.data(), buffer.size());
+		buffer.clear();
+
+		offset = end;
+		if (offset == length)
+			break;
+	}
+	return status;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef TEXT_FILE_H
+#define TEXT_FILE_H
+
+#include "Compression.h"
+#include "TextEncoding.h"
+
+#include <DataIO.h>
+#include <Messenger.h>
+#include <OS.h>
+#include <String.h>
+#include <SupportDefs.h>
+
+// Reads from and writes to a file descriptor, which stays open
+class DescriptorIO : public BDataIO {
+public:
+	DescriptorIO(int fd);
+
+	virtual ssize_t Read(void* buffer, size_t size);
+	virtual ssize_t Write(const void* buffer, size_t size);
+
+private:
+	int fFD;
+};
+
+// The contents of a file, read only. The file is mapped into memory where
+// possible, so opening it costs no copy; otherwise it is read in large blocks.
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	status_t SetTo(const char* path);
+	void Unset();
+
+	const char* Data() const { return fData; }
+	size_t Size() const { return fSize; }
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	char* fData;
+	size_t fSize;
+	bool fMapped;
+};
+
+// Loads a file on its own thread, decompresses it if needed, and finds out its
+// encoding. UTF-8 is used as it is, other text is converted to UTF-8. The
+// target receives M_FILE_LOAD_PROGRESS messages with the "percent" done, and
+// one M_FILE_LOADED message at the end, both with the "id" of the loader.
+// Deleting the loader cancels it.
+class TextFileLoader {
+public:
+	TextFileLoader(const char* path, BMessenger target, int32 id);
+	~TextFileLoader();
+
+	status_t Start();
+	void Cancel();
+
+	int32 ID() const { return fID; }
+	const BString& Path() const { return fPath; }
+
+	// B_BAD_DATA if the file is not text in any known encoding, B_CANCELED if
+	// it was cancelled. Only valid after M_FILE_LOADED.
+	status_t Status() const { return fStatus; }
+	const Compression& GetCompression() const { return fCompression; }
+	const TextEncoding& Encoding() const { return fEncoding; }
+	LineEndings GetLineEndings() const { return fScan.GetLineEndings(); }
+	const char* Text() const { return fText; }
+	size_t TextLength() const { return fTextLength; }
+
+private:
+	static status_t _LoadThread(void* data);
+	status_t _Load();
+	status_t _Decompress(const char* data, size_t size);
+	status_t _Scan(const char* data, size_t size);
+	status_t _Convert(const char* data, size_t size);
+	void _ReportProgress(size_t done, size_t total);
+
+	BString fPath;
+	BMessenger fTarget;
+	int32 fID;
+	thread_id fThread;
+	int32 fCancelled;
+	status_t fStatus;
+	int32 fPercent;
+	MappedFile fFile;
+	Compression fCompression;
+	std::string fDecompressed;
+	TextEncoding fEncoding;
+	TextScan fScan;
+	std::string fConverted;
+	const char* fText;
+	size_t fTextLength;
+};
+
+// Saves text on its own thread, without touching the file until the new
+// contents are safely on disk: they are written to a temporary file next to
+// it, which then replaces the file in one rename. The attributes, owner and
+// group of the old file are carried over; a file with more than one link is
+// overwritten in place instead. The text is written in the given encoding, or
+// in UTF-8 if it has characters the encoding cannot hold, and compressed if a
+// compression is given. The target receives M_FILE_SAVED when it is done.
+class TextFileSaver {
+public:
+	TextFileSaver(const char* path, const BString& text, const TextEncoding& encoding,
+		const Compression& compression, BMessenger target);
+	~TextFileSaver();
+
+	status_t Start();
+
+	const BString& Path() const { return fPath; }
+	const BString& Text() const { return fText; }
+
+	// Only valid after M_FILE_SAVED
+	status_t Status() const { return fStatus; }
+	const TextEncoding& Encoding() const { return fEncoding; }
+	const Compression& GetCompression() const { return fCompression; }
+
+private:
+	static status_t _SaveThread(void* data);
+	status_t _Save();
+	status_t _SaveInPlace();
+	status_t _WriteText(int fd);
+	status_t _WriteCompressed(int fd);
+	status_t _WriteEncoded(BDataIO* output);
+
+	BString fPath;
+	BString fText;
+	TextEncoding fEncoding;
+	Compression fCompression;
+	BMessenger fTarget;
+	thread_id fThread;
+	status_t fStatus;
+};
+
+#endif // TEXT_FILE_H
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "TextPreview.h"
+#include "TextDiff.h"
+#include "TextUtils.h"
+#include "UndoableTextView.h"
+
+#include <TextView.h>
+#include <algorithm>
+#include <cstring>
+
+static const int32 kMaxPreviewHunks = 100;
+static const int32 kMaxHunkLines = 10;
+static const int32 kMaxLineLength = 160;
+
+
+// Counts the lines in [start, end), a last line without a line break included
+static int32
+_CountLines(const char* text, int32 start, int32 end)
+{
+	int32 count = 0;
+	for (const char* c = text + start;
+			(c = (const char*)memchr(c, '\n', text + end - c)) != nullptr; c++)
+		count++;
+	if (end > start && text[end - 1] != '\n')
+		count++;
+	return count;
+}
+
+
+static void
+_AppendLines(BString& target, const char* text, int32 length, int32 count)
+{
+	int32 shown = std::min(count, kMaxHunkLines);
+	for (int32 i = 0; i < shown; i++) {
+		const char* lineEnd = (const char*)memchr(text, '\n', length);
+		int32 lineLength = lineEnd != nullptr ? lineEnd - text : length;
+		int32 next = lineEnd != nullptr ? lineLength + 1 : length;
+
+		if (lineLength > kMaxLineLength) {
+			lineLength = kMaxLineLength;
+			while (lineLength > 0 && (text[lineLength] & 0xC0) == 0x80)
+				lineLength--;
+			target.Append(text, lineLength).Append(B_UTF8_ELLIPSIS);
+		} else
+			target.Append(text, lineLength);
+		target << '\n';
+
+		text += next;
+		length -= next;
+	}
+
+	if (count > shown)
+		target << B_UTF8_ELLIPSIS << '\n';
+}
+
+
+TransformPreview::TransformPreview()
+{
+	Clear();
+}
+
+
+void
+TransformPreview::Clear()
+{
+	fValid = false;
+	fChangeCount = 0;
+	fReplaceStart = 0;
+	fReplaceEnd = 0;
+	fReplacement = "";
+	fSelectionStart = 0;
+	fSelectionEnd = 0;
+	fChangedRegions = 0;
+	fRemovedLines = 0;
+	fAddedLines = 0;
+	fHunks.clear();
+	fStatusMessage = "";
+}
+
+
+status_t
+TransformPreview::Run(UndoableTextView* target, const Transform& transform)
+{
+	Clear();
+	if (target == nullptr)
+		return B_BAD_VALUE;
+
+	const char* original = target->Text();
+	int32 originalLength = target->TextLength();
+	int32 selectionStart;
+	int32 selectionEnd;
+	target->GetSelection(&selectionStart, &selectionEnd);
+
+	// The shadow view is never attached to a window, so the transform neither
+	// draws nor records undo history. Without word wrap the line layout stays cheap.
+	BTextView shadow("PreviewShadow");
+	shadow.SetWordWrap(false);
+	shadow.SetText(original, originalLength);
+	shadow.Select(selectionStart, selectionEnd);
+
+	SetStatusMessageCapture(&fStatusMessage);
+	transform(&shadow);
+	SetStatusMessageCapture(nullptr);
+
+	const char* result = shadow.Text();
+	int32 resultLength = shadow.TextLength();
+
+	// Reduce the change to a single replaced range, cut at character boundaries
+	int32 prefix;
+	int32 suffix;
+	TrimCommonAffixes(original, originalLength, result, resultLength, prefix, suffix);
+
+	fReplaceStart = prefix;
+	fReplaceEnd = originalLength - suffix;
+	fReplacement.SetTo(result + prefix, resultLength - suffix - prefix);
+	shadow.GetSelection(&fSelectionStart, &fSelectionEnd);
+	fChangeCount = target->ChangeCount();
+
+	if (HasChanges())
+		_ComputeHunks(original, originalLength, result, resultLength);
+
+	fValid = true;
+	return B_OK;
+}
+
+
+status_t
+TransformPreview::Apply(UndoableTextView* target) const
+{
+	if (!fValid || target == nullptr)
+		return B_NO_INIT;
+
+	// The text was edited after the preview was made
+	if (target->ChangeCount() != fChangeCount)
+		return B_MISMATCHED_VALUES;
+
+	target->BeginUndoGroup();
+	ReplaceText(target, fReplaceStart, fReplaceEnd, fReplacement);
+	target->EndUndoGroup();
+
+	target->Select(fSelectionStart, fSelectionEnd);
+	target->ScrollToSelection();
+	return B_OK;
+}
+
+
+// Lists the changed lines from the same regions ReplaceText() compares, so
+// the preview shows what Apply() writes.
+void
+TransformPreview::_ComputeHunks(const char* original, int32 originalLength, const char* result,
+	int32 resultLength)
+{
+	std::vector<TextSpan> regions;
+	DiffTextLines(original, originalLength, result, resultLength, regions);
+
+	// Line numbers are counted on from the end of the region before
+	int32 originalLine = 0;
+	int32 resultLine = 0;
+	int32 originalOffset = 0;
+	int32 resultOffset = 0;
+	for (const TextSpan& region : regions) {
+		originalLine += _CountLines(original, originalOffset, region.originalStart);
+		resultLine += _CountLines(result, resultOffset, region.resultStart);
+		int32 removedCount = _CountLines(original, region.originalStart, region.originalEnd);
+		int32 addedCount = _CountLines(result, region.resultStart, region.resultEnd);
+
+		fChangedRegions++;
+		fRemovedLines += removedCount;
+		fAddedLines += addedCount;
+		if ((int32)fHunks.size() < kMaxPreviewHunks) {
+			PreviewHunk hunk;
+			hunk.originalLine = originalLine;
+			hunk.resultLine = resultLine;
+			hunk.removedLines = removedCount;
+			hunk.addedLines = addedCount;
+			_AppendLines(hunk.removed, original + region.originalStart,
+				region.originalEnd - region.originalStart, removedCount);
+			_AppendLines(hunk.added, result + region.resultStart,
+				region.resultEnd - region.resultStart, addedCount);
+			fHunks.push_back(hunk);
+		}
+
+		originalLine += removedCount;
+		resultLine += addedCount;
+		originalOffset = region.originalEnd;
+		resultOffset = region.resultEnd;
+	}
+}
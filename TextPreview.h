@@ -0,0 +1,69 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef TEXT_PREVIEW_H
+#define TEXT_PREVIEW_H
+
+#include <String.h>
+#include <SupportDefs.h>
+#include <functional>
+#include <vector>
+
+class BTextView;
+class UndoableTextView;
+
+struct PreviewHunk {
+	int32 originalLine;
+	int32 resultLine;
+	int32 removedLines;
+	int32 addedLines;
+	BString removed;
+	BString added;
+};
+
+// Runs a transform on a shadow copy of a text view and keeps the result, so
+// the changes can be inspected before they are applied to the real view.
+class TransformPreview {
+public:
+	TransformPreview();
+
+	typedef std::function<void(BTextView*)> Transform;
+
+	status_t Run(UndoableTextView* target, const Transform& transform);
+	status_t Apply(UndoableTextView* target) const;
+	void Clear();
+
+	bool IsValid() const { return fValid; }
+	bool HasChanges() const { return fReplaceStart != fReplaceEnd || !fReplacement.IsEmpty(); }
+
+	int32 CountChangedRegions() const { return fChangedRegions; }
+	int32 CountRemovedLines() const { return fRemovedLines; }
+	int32 CountAddedLines() const { return fAddedLines; }
+	int32 SizeDifference() const
+		{ return fReplacement.Length() - (fReplaceEnd - fReplaceStart); }
+	const std::vector<PreviewHunk>& Hunks() const { return fHunks; }
+	const BString& StatusMessage() const { return fStatusMessage; }
+
+private:
+	void _ComputeHunks(const char* original, int32 originalLength, const char* result,
+		int32 resultLength);
+
+	bool fValid;
+	int32 fChangeCount;
+
+	// The edit that turns the original text into the result
+	int32 fReplaceStart;
+	int32 fReplaceEnd;
+	BString fReplacement;
+	int32 fSelectionStart;
+	int32 fSelectionEnd;
+
+	int32 fChangedRegions;
+	int32 fRemovedLines;
+	int32 fAddedLines;
+	std::vector<PreviewHunk> fHunks;
+	BString fStatusMessage;
+};
+
+#endif // TEXT_PREVIEW_H
@@ -0,0 +1,420 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "TextSearch.h"
+#include "TextBuilder.h"
+
+#include <Autolock.h>
+#include <Catalog.h>
+#include <Locker.h>
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unicode/regex.h>
+#include <unicode/uchar.h>
+#include <unicode/ustring.h>
+#include <unicode/utf16.h>
+#include <unicode/utf8.h>
+#include <unicode/utext.h>
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "Text utilities"
+
+static const size_t kMaxCachedPatterns = 16;
+static const int32 kRegexTimeLimit = 5000; // match steps, roughly milliseconds
+
+struct CachedPattern {
+	BString key;
+	std::shared_ptr<icu::RegexPattern> pattern;
+};
+
+static BLocker sPatternCacheLock("regex pattern cache");
+static std::list<CachedPattern> sPatternCache; // most recently used first
+
+struct ReplacementPart {
+	BString literal;
+	int32 group; // -1 for literal text
+};
+
+
+// Full Unicode case folding of a single character, written as UTF-8.
+// Returns the number of bytes written (at most 12, as a character folds
+// to at most three characters).
+static int32
+_FoldCharacter(UChar32 c, char* buffer)
+{
+	UChar source[2];
+	int32 sourceLength = 0;
+	U16_APPEND_UNSAFE(source, sourceLength, c);
+
+	UChar folded[8];
+	UErrorCode status = U_ZERO_ERROR;
+	int32 foldedLength = u_strFoldCase(folded, 8, source, sourceLength, U_FOLD_CASE_DEFAULT,
+		&status);
+
+	int32 length = 0;
+	if (U_FAILURE(status)) {
+		U8_APPEND_UNSAFE(buffer, length, c);
+		return length;
+	}
+
+	for (int32 i = 0; i < foldedLength;) {
+		UChar32 f;
+		U16_NEXT(folded, i, foldedLength, f);
+		U8_APPEND_UNSAFE(buffer, length, f);
+	}
+	return length;
+}
+
+
+static bool
+_IsWordCharacter(UChar32 c)
+{
+	return u_isalnum(c) || c == '_' || (U_GET_GC_MASK(c) & U_GC_M_MASK) != 0;
+}
+
+
+void
+FoldedText::SetTo(const char* text, int32 length)
+{
+	fFolded.clear();
+	fOffsets.clear();
+	fFolded.reserve(length);
+	fOffsets.reserve(length + 1);
+
+	char buffer[16];
+	for (int32 i = 0; i < length;) {
+		int32 start = i;
+		unsigned char byte = (unsigned char)text[i];
+
+		// ASCII fast path
+		if (byte < 0x80) {
+			fFolded += (byte >= 'A' && byte <= 'Z') ? (char)(byte + 32) : (char)byte;
+			fOffsets.push_back(start);
+			i++;
+			continue;
+		}
+
+		UChar32 c;
+		U8_NEXT(text, i, length, c);
+
+		int32 foldedLength;
+		if (c < 0) {
+			// Malformed UTF-8, keep the bytes as they are
+			foldedLength = i - start;
+			fFolded.append(text + start, foldedLength);
+		} else {
+			foldedLength = _FoldCharacter(c, buffer);
+			fFolded.append(buffer, foldedLength);
+		}
+		fOffsets.insert(fOffsets.end(), foldedLength, start);
+	}
+
+	fOffsets.push_back(length);
+}
+
+
+bool
+FoldedText::IsCharBoundary(int32 foldedOffset) const
+{
+	if (foldedOffset <= 0 || foldedOffset >= Length())
+		return true;
+
+	return fOffsets[foldedOffset] != fOffsets[foldedOffset - 1];
+}
+
+
+bool
+IsFullWord(const char* text, int32 length, int32 start, int32 end)
+{
+	if (start > 0) {
+		int32 i = start;
+		UChar32 c;
+		U8_PREV(text, 0, i, c);
+		if (c >= 0 && _IsWordCharacter(c))
+			return false;
+	}
+
+	if (end < length) {
+		int32 i = end;
+		UChar32 c;
+		U8_NEXT(text, i, length, c);
+		if (c >= 0 && _IsWordCharacter(c))
+			return false;
+	}
+
+	return true;
+}
+
+
+// Collects all non-overlapping occurrences of find in text, as byte ranges of
+// the original text. Case-insensitive searches run on a case-folded copy of
+// both strings, so the cost stays linear in the text length regardless of the
+// number of matches.
+int32
+FindAllMatches(const char* text, int32 length, const BString& find, bool caseSensitive,
+	bool fullWordsOnly, std::vector<TextMatch>& matches)
+{
+	matches.clear();
+
+	if (text == nullptr || length <= 0 || find.IsEmpty())
+		return 0;
+
+	FoldedText foldedText;
+	FoldedText foldedFind;
+
+	const char* haystack = text;
+	int32 haystackLength = length;
+	const char* needle = find.String();
+	int32 needleLength = find.Length();
+
+	if (!caseSensitive) {
+		foldedText.SetTo(text, length);
+		foldedFind.SetTo(find.String(), find.Length());
+
+		haystack = foldedText.String();
+		haystackLength = foldedText.Length();
+		needle = foldedFind.String();
+		needleLength = foldedFind.Length();
+	}
+
+	if (needleLength == 0 || needleLength > haystackLength)
+		return 0;
+
+	std::boyer_moore_horspool_searcher<const char*> searcher(needle, needle + needleLength);
+	const char* haystackEnd = haystack + haystackLength;
+	const char* position = haystack;
+
+	while (position < haystackEnd) {
+		position = std::search(position, haystackEnd, searcher);
+		if (position == haystackEnd)
+			break;
+
+		int32 matchStart = position - haystack;
+		int32 matchEnd = matchStart + needleLength;
+
+		if (!caseSensitive) {
+			// A match must not start or end in the middle of a folded character
+			// (e.g. "s" matching half of the "ss" that "ß" folds to).
+			if (!foldedText.IsCharBoundary(matchStart) || !foldedText.IsCharBoundary(matchEnd)) {
+				position++;
+				continue;
+			}
+			matchStart = foldedText.SourceOffset(matchStart);
+			matchEnd = foldedText.SourceOffset(matchEnd);
+		}
+
+		if (fullWordsOnly && !IsFullWord(text, length, matchStart, matchEnd)) {
+			position++;
+			continue;
+		}
+
+		matches.push_back({ matchStart, matchEnd });
+		position += needleLength;
+	}
+
+	return (int32)matches.size();
+}
+
+
+// Returns the compiled pattern for the given expression and options, compiling
+// it only on first use. Recently used patterns are kept in a small cache.
+static std::shared_ptr<icu::RegexPattern>
+_CompiledPattern(const BString& expression, bool caseSensitive, bool fullWordsOnly,
+	BString& error)
+{
+	BString key;
+	key << (caseSensitive ? 'c' : 'i') << (fullWordsOnly ? 'w' : 'a') << expression;
+
+	BAutolock locker(sPatternCacheLock);
+
+	for (auto it = sPatternCache.begin(); it != sPatternCache.end(); ++it) {
+		if (it->key != key)
+			continue;
+		if (it != sPatternCache.begin())
+			sPatternCache.splice(sPatternCache.begin(), sPatternCache, it);
+		return sPatternCache.front().pattern;
+	}
+
+	BString source(expression);
+	if (fullWordsOnly)
+		source.Prepend("\\b(?:").Append(")\\b");
+
+	uint32 flags = UREGEX_MULTILINE;
+	if (!caseSensitive)
+		flags |= UREGEX_CASE_INSENSITIVE;
+
+	UErrorCode status = U_ZERO_ERROR;
+	UParseError parseError;
+	UText* patternText = utext_openUTF8(nullptr, source.String(), source.Length(), &status);
+	std::shared_ptr<icu::RegexPattern> pattern(
+		icu::RegexPattern::compile(patternText, flags, parseError, status));
+	utext_close(patternText);
+
+	if (U_FAILURE(status) || !pattern) {
+		error.SetToFormat(B_TRANSLATE("Invalid regular expression (%s at offset %d)"),
+			u_errorName(status), (int)parseError.offset);
+		return nullptr;
+	}
+
+	sPatternCache.push_front({ key, pattern });
+	if (sPatternCache.size() > kMaxCachedPatterns)
+		sPatternCache.pop_back();
+
+	return pattern;
+}
+
+
+// Splits a replacement string into literal text and capture group references.
+// Both "$1"/"${1}" and "\1" refer to a group; "\n" and "\t" are a line break
+// and a tab, and any other escaped character, such as "\\" or "\$", is literal.
+static std::vector<ReplacementPart>
+_ParseReplacement(const BString& replacement, int32 groupCount)
+{
+	std::vector<ReplacementPart> parts;
+	BString literal;
+	const char* string = replacement.String();
+	int32 length = replacement.Length();
+
+	for (int32 i = 0; i < length; i++) {
+		char c = string[i];
+		int32 group = -1;
+		int32 next = i + 1;
+
+		if (c == '\\' && next < length && !isdigit(string[next])) {
+			switch (string[next]) {
+				case 'n':
+					literal << '\n';
+					break;
+				case 't':
+					literal << '\t';
+					break;
+				case '\\':
+					literal << '\\';
+					break;
+				default:
+					literal << string[next];
+					break;
+			}
+			i = next;
+			continue;
+		}
+
+		if ((c == '$' || c == '\\') && next < length) {
+			bool braced = c == '$' && string[next] == '{';
+			int32 j = braced ? next + 1 : next;
+			int32 number = -1;
+			while (j < length && isdigit(string[j])) {
+				int32 candidate = (number < 0 ? 0 : number * 10) + (string[j] - '0');
+				if (candidate > groupCount && number >= 0)
+					break;
+				number = candidate;
+				j++;
+			}
+			if (braced) {
+				if (j < length && string[j] == '}')
+					j++;
+				else
+					number = -1;
+			}
+			if (number >= 0 && number <= groupCount) {
+				group = number;
+				next = j;
+			}
+		}
+
+		if (group < 0) {
+			literal << c;
+			continue;
+		}
+
+		if (!literal.IsEmpty()) {
+			parts.push_back({ literal, -1 });
+			literal = "";
+		}
+		parts.push_back({ "", group });
+		i = next - 1;
+	}
+
+	if (!literal.IsEmpty())
+		parts.push_back({ literal, -1 });
+
+	return parts;
+}
+
+
+// Replaces all matches of a regular expression, counting them in the same
+// pass. The text is matched in place as UTF-8, so offsets are byte offsets and
+// the document is never converted to UTF-16 as a whole.
+status_t
+RegexReplaceAll(const char* text, int32 length, const BString& pattern,
+	const BString& replacement, bool caseSensitive, bool fullWordsOnly, TextBuilder& result,
+	int32& count, BString& error)
+{
+	count = 0;
+	result.Clear();
+
+	std::shared_ptr<icu::RegexPattern> compiled
+		= _CompiledPattern(pattern, caseSensitive, fullWordsOnly, error);
+	if (!compiled)
+		return B_BAD_VALUE;
+
+	UErrorCode status = U_ZERO_ERROR;
+	std::unique_ptr<icu::RegexMatcher> matcher(compiled->matcher(status));
+	UText* input = utext_openUTF8(nullptr, text, length, &status);
+	if (U_FAILURE(status) || !matcher) {
+		utext_close(input);
+		error.SetToFormat(B_TRANSLATE("Regular expression failed (%s)"), u_errorName(status));
+		return B_ERROR;
+	}
+
+	matcher->reset(input);
+	matcher->setTimeLimit(kRegexTimeLimit, status);
+
+	std::vector<ReplacementPart> parts = _ParseReplacement(replacement, matcher->groupCount());
+
+	int64 last = 0;
+	while (matcher->find(status)) {
+		int64 start = matcher->start64(status);
+		int64 end = matcher->end64(status);
+
+		result.Append(text + last, start - last);
+		for (const ReplacementPart& part : parts) {
+			if (part.group < 0) {
+				result << part.literal;
+				continue;
+			}
+			int64 groupStart = matcher->start64(part.group, status);
+			if (groupStart >= 0)
+				result.Append(text + groupStart, matcher->end64(part.group, status) - groupStart);
+		}
+
+		last = end;
+		count++;
+	}
+
+	matcher.reset();
+	utext_close(input);
+
+	if (U_FAILURE(status)) {
+		if (status == U_REGEX_TIME_OUT)
+			error = B_TRANSLATE("Regular expression took too long and was stopped");
+		else
+			error.SetToFormat(B_TRANSLATE("Regular expression failed (%s)"), u_errorName(status));
+		result.Clear();
+		count = 0;
+		return B_ERROR;
+	}
+
+	result.Append(text + last, length - last);
+	if (result.InitCheck() != B_OK) {
+		error = B_TRANSLATE("Not enough memory to replace the matches");
+		count = 0;
+		return B_NO_MEMORY;
+	}
+	return B_OK;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef TEXT_SEARCH_H
+#define TEXT_SEARCH_H
+
+#include <String.h>
+#include <SupportDefs.h>
+#include <string>
+#include <vector>
+
+class TextBuilder;
+
+struct TextMatch {
+	int32 start;
+	int32 end;
+};
+
+// Case-folded copy of a UTF-8 text. Every folded byte remembers the offset of
+// the source character it was produced from, so matches found in the folded
+// buffer can be mapped back to the original text.
+class FoldedText {
+public:
+	void SetTo(const char* text, int32 length);
+
+	const char* String() const { return fFolded.data(); }
+	int32 Length() const { return (int32)fFolded.size(); }
+
+	int32 SourceOffset(int32 foldedOffset) const { return fOffsets[foldedOffset]; }
+	bool IsCharBoundary(int32 foldedOffset) const;
+
+private:
+	std::string fFolded;
+	std::vector<int32> fOffsets;
+};
+
+bool IsFullWord(const char* text, int32 length, int32 start, int32 end);
+int32 FindAllMatches(const char* text, int32 length, const BString& find, bool caseSensitive,
+	bool fullWordsOnly, std::vector<TextMatch>& matches);
+
+status_t RegexReplaceAll(const char* text, int32 length, const BString& pattern,
+	const BString& replacement, bool caseSensitive, bool fullWordsOnly, TextBuilder& result,
+	int32& count, BString& error);
+
+#endif // TEXT_SEARCH_H
@@ -0,0 +1,1171 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "TextStats.h"
+#include "TextBuilder.h"
+
+#include <Autolock.h>
+#include <DataIO.h>
+#include <Locker.h>
+#include <OS.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unicode/brkiter.h>
+#include <unicode/locid.h>
+#include <unicode/uchar.h>
+#include <unicode/uscript.h>
+#include <unicode/unistr.h>
+#include <unicode/utext.h>
+#include <unicode/utf8.h>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const size_t kMinChunkSize = 1024 * 1024;
+static const int32 kMaxChunks = 16;
+static const size_t kInitialSlots = 1024;
+static const size_t kWordBlockSize = 64 * 1024;
+static const size_t kWriteBufferSize = 64 * 1024;
+
+
+static inline bool
+_IsTrimmed(UChar32 c)
+{
+	// The characters UnicodeString::trim() removes
+	return c == 0x20 || u_isWhitespace(c);
+}
+
+
+static inline bool
+_IsParagraphSeparator(int32 type)
+{
+	return type == U_SB_SEP || type == U_SB_CR || type == U_SB_LF;
+}
+
+
+// Counts sentences the way the ICU sentence break iterator splits them
+// (Unicode UAX #29), one character at a time. Only segments containing
+// something besides white space are counted.
+class SentenceCounter {
+public:
+	SentenceCounter();
+
+	void Add(UChar32 c);
+	int64 Finish();
+
+private:
+	enum {
+		STATE_NONE,
+		STATE_TERM, // After a terminator and closing punctuation
+		STATE_SPACE, // After a terminator, closing punctuation and spaces
+		STATE_SCAN // After ". ", looking for a lowercase letter
+	};
+
+	inline void _Break();
+	bool _BreakBefore(int32 type);
+
+	int32 fState;
+	bool fATerm;
+	bool fLetterBeforeATerm;
+	bool fCloseSeen;
+	bool fBreakNext;
+	int32 fPreviousType;
+	bool fContent;
+	bool fPendingContent;
+	int64 fCount;
+};
+
+
+SentenceCounter::SentenceCounter()
+	:
+	fState(STATE_NONE),
+	fATerm(false),
+	fLetterBeforeATerm(false),
+	fCloseSeen(false),
+	fBreakNext(false),
+	fPreviousType(U_SB_OTHER),
+	fContent(false),
+	fPendingContent(false),
+	fCount(0)
+{
+}
+
+
+inline void
+SentenceCounter::_Break()
+{
+	if (fContent)
+		fCount++;
+	fContent = false;
+}
+
+
+bool
+SentenceCounter::_BreakBefore(int32 type)
+{
+	if (fBreakNext) {
+		// CR × LF, otherwise break after a paragraph separator
+		if (fPreviousType == U_SB_CR && type == U_SB_LF)
+			return false;
+		fBreakNext = false;
+		return true;
+	}
+
+	switch (fState) {
+		case STATE_NONE:
+			return false;
+
+		case STATE_SCAN:
+			if (type == U_SB_LOWER) {
+				fContent |= fPendingContent;
+				fState = STATE_NONE;
+			} else if (type == U_SB_OLETTER || type == U_SB_UPPER || _IsParagraphSeparator(type)
+				|| type == U_SB_STERM || type == U_SB_ATERM) {
+				// The break belonged in front of the characters scanned so far
+				_Break();
+				fContent = fPendingContent;
+				fState = STATE_NONE;
+			} else
+				return false;
+			return false;
+
+		case STATE_TERM:
+			if (fATerm && !fCloseSeen && type == U_SB_NUMERIC) {
+				fState = STATE_NONE;
+				return false;
+			}
+			if (fATerm && !fCloseSeen && fLetterBeforeATerm && type == U_SB_UPPER) {
+				fState = STATE_NONE;
+				return false;
+			}
+			if (type == U_SB_CLOSE) {
+				fCloseSeen = true;
+				return false;
+			}
+			// fall through
+		case STATE_SPACE:
+			if (type == U_SB_SP) {
+				fState = STATE_SPACE;
+				return false;
+			}
+			if (_IsParagraphSeparator(type)) {
+				fState = STATE_NONE;
+				return false;
+			}
+			if (type == U_SB_SCONTINUE || type == U_SB_STERM || type == U_SB_ATERM) {
+				fState = STATE_NONE;
+				return false;
+			}
+			if (fATerm) {
+				if (type == U_SB_LOWER) {
+					fState = STATE_NONE;
+					return false;
+				}
+				if (type != U_SB_OLETTER && type != U_SB_UPPER) {
+					fState = STATE_SCAN;
+					fPendingContent = false;
+					return false;
+				}
+			}
+			fState = STATE_NONE;
+			return true;
+	}
+
+	return false;
+}
+
+
+void
+SentenceCounter::Add(UChar32 c)
+{
+	int32 type = u_getIntPropertyValue(c, UCHAR_SENTENCE_BREAK);
+	bool content = !_IsTrimmed(c);
+
+	// Extend and format characters belong to the character before them
+	if ((type == U_SB_EXTEND || type == U_SB_FORMAT) && !_IsParagraphSeparator(fPreviousType)) {
+		if (fState == STATE_SCAN)
+			fPendingContent |= content;
+		else
+			fContent |= content;
+		return;
+	}
+
+	if (_BreakBefore(type))
+		_Break();
+
+	if (fState == STATE_SCAN)
+		fPendingContent |= content;
+	else
+		fContent |= content;
+
+	if (type == U_SB_STERM || type == U_SB_ATERM) {
+		fState = STATE_TERM;
+		fATerm = type == U_SB_ATERM;
+		fLetterBeforeATerm = fPreviousType == U_SB_UPPER || fPreviousType == U_SB_LOWER;
+		fCloseSeen = false;
+	} else if (_IsParagraphSeparator(type))
+		fBreakNext = true;
+
+	fPreviousType = type;
+}
+
+
+int64
+SentenceCounter::Finish()
+{
+	if (fState == STATE_SCAN) {
+		_Break();
+		fContent = fPendingContent;
+	}
+	_Break();
+	return fCount;
+}
+
+
+static inline uint32
+_HashWord(const char* word, size_t length)
+{
+	// FNV-1a
+	uint32 hash = 2166136261u;
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ (uint8)word[i]) * 16777619u;
+	return hash;
+}
+
+
+static bool
+_MoreFrequent(const WordCount& a, const WordCount& b)
+{
+	if (a.count != b.count)
+		return a.count > b.count;
+	return a.word < b.word;
+}
+
+
+WordFrequency::WordFrequency()
+	:
+	fCount(0),
+	fBlockPosition(nullptr),
+	fBlockRemaining(0)
+{
+}
+
+
+void
+WordFrequency::Add(const char* word, size_t length, int32 count)
+{
+	if (fSlots.empty())
+		_Resize(kInitialSlots);
+
+	uint32 hash = _HashWord(word, length);
+	size_t mask = fSlots.size() - 1;
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		Slot& slot = fSlots[i];
+		if (slot.word == nullptr) {
+			slot.word = _Intern(word, length);
+			slot.length = length;
+			slot.hash = hash;
+			slot.count = count;
+			// Keep the table at most 3/4 full
+			if (++fCount > (int32)(fSlots.size() / 4 * 3))
+				_Resize(fSlots.size() * 2);
+			return;
+		}
+		if (slot.hash == hash && slot.length == length && memcmp(slot.word, word, length) == 0) {
+			slot.count += count;
+			return;
+		}
+	}
+}
+
+
+void
+WordFrequency::Merge(const WordFrequency& other)
+{
+	for (const Slot& slot : other.fSlots) {
+		if (slot.word != nullptr)
+			Add(slot.word, slot.length, slot.count);
+	}
+}
+
+
+void
+WordFrequency::GetTopWords(size_t count, std::vector<WordCount>& words) const
+{
+	GetAllWords(words);
+	count = std::min(count, words.size());
+	std::partial_sort(words.begin(), words.begin() + count, words.end(), _MoreFrequent);
+	words.resize(count);
+}
+
+
+void
+WordFrequency::GetAllWords(std::vector<WordCount>& words) const
+{
+	words.clear();
+	words.reserve(fCount);
+	for (const Slot& slot : fSlots) {
+		if (slot.word != nullptr)
+			words.push_back({std::string_view(slot.word, slot.length), slot.count});
+	}
+}
+
+
+const char*
+WordFrequency::_Intern(const char* word, size_t length)
+{
+	if (length > fBlockRemaining) {
+		size_t size = std::max(length, kWordBlockSize);
+		fBlocks.emplace_back(new char[size]);
+		fBlockPosition = fBlocks.back().get();
+		fBlockRemaining = size;
+	}
+
+	char* interned = fBlockPosition;
+	memcpy(interned, word, length);
+	fBlockPosition += length;
+	fBlockRemaining -= length;
+	return interned;
+}
+
+
+void
+WordFrequency::_Resize(size_t size)
+{
+	std::vector<Slot> slots(size, Slot{nullptr, 0, 0, 0});
+	size_t mask = size - 1;
+	for (const Slot& slot : fSlots) {
+		if (slot.word == nullptr)
+			continue;
+		size_t i = slot.hash & mask;
+		while (slots[i].word != nullptr)
+			i = (i + 1) & mask;
+		slots[i] = slot;
+	}
+	fSlots.swap(slots);
+}
+
+
+TextStatistics::TextStatistics()
+	:
+	characters(0),
+	words(0),
+	lines(0),
+	lineBreaks(0),
+	sentences(0),
+	longestLine(0),
+	wordCharacters(0)
+{
+}
+
+
+void
+TextStatistics::Merge(const TextStatistics& other)
+{
+	characters += other.characters;
+	words += other.words;
+	lines += other.lines;
+	lineBreaks += other.lineBreaks;
+	sentences += other.sentences;
+	longestLine = std::max(longestLine, other.longestLine);
+	wordCharacters += other.wordCharacters;
+
+	wordFrequency.Merge(other.wordFrequency);
+}
+
+
+struct StatisticsChunk {
+	const char* text;
+	int32 length;
+	icu::BreakIterator* wordIterator;
+	TextStatistics stats;
+	std::string word; // Reused for lowercasing each word
+	status_t status;
+};
+
+
+void
+FoldWordCase(const char* word, size_t length, std::string& folded)
+{
+	// Most words are ASCII, which is lowercased without ICU
+	folded.assign(word, length);
+	for (char& c : folded) {
+		if ((uint8)c >= 0x80) {
+			icu::UnicodeString unicodeWord
+				= icu::UnicodeString::fromUTF8(icu::StringPiece(word, length));
+			folded.clear();
+			unicodeWord.toLower().toUTF8String(folded);
+			return;
+		}
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+	}
+}
+
+
+static void
+_AddWord(StatisticsChunk& chunk, const char* word, int32 length)
+{
+	std::string& key = chunk.word;
+	FoldWordCase(word, length, key);
+	if (key.length() > 2)
+		chunk.stats.wordFrequency.Add(key.data(), key.length());
+}
+
+
+// Collects all statistics of one chunk in a single walk over its word
+// segments. Every character is decoded once, and feeds the character, line
+// and sentence counts on the way.
+static status_t
+_CountChunk(void* data)
+{
+	StatisticsChunk& chunk = *(StatisticsChunk*)data;
+	TextStatistics& stats = chunk.stats;
+	const char* text = chunk.text;
+
+	UErrorCode status = U_ZERO_ERROR;
+	UText* utext = utext_openUTF8(nullptr, text, chunk.length, &status);
+	chunk.wordIterator->setText(utext, status);
+	if (U_FAILURE(status)) {
+		utext_close(utext);
+		chunk.status = B_ERROR;
+		return chunk.status;
+	}
+
+	SentenceCounter sentences;
+	int64 lineLength = 0;
+
+	int32 start = chunk.wordIterator->first();
+	for (int32 end = chunk.wordIterator->next(); end != icu::BreakIterator::DONE;
+		start = end, end = chunk.wordIterator->next()) {
+		int32 wordStart = -1;
+		int32 wordEnd = start;
+		int32 segmentCharacters = 0;
+		int32 wordCharacters = 0;
+		UChar32 first = 0;
+
+		for (int32 i = start; i < end;) {
+			int32 characterStart = i;
+			UChar32 c;
+			U8_NEXT(text, i, end, c);
+			if (c < 0)
+				c = 0xfffd;
+
+			stats.characters++;
+			sentences.Add(c);
+
+			if (c == '\n') {
+				stats.lineBreaks++;
+				stats.longestLine = std::max(stats.longestLine, lineLength);
+				lineLength = 0;
+			} else
+				lineLength += i - characterStart;
+
+			// The segment without leading and trailing white space
+			if (!_IsTrimmed(c)) {
+				if (wordStart < 0) {
+					wordStart = characterStart;
+					first = c;
+				}
+				wordEnd = i;
+				wordCharacters = segmentCharacters + 1;
+			}
+			if (wordStart >= 0)
+				segmentCharacters++;
+		}
+
+		if (wordStart < 0 || u_charType(first) == U_SPACE_SEPARATOR)
+			continue;
+
+		stats.words++;
+		if (first >= 0x30 && u_isalnum(first)) {
+			stats.wordCharacters += wordCharacters;
+			_AddWord(chunk, text + wordStart, wordEnd - wordStart);
+		}
+	}
+
+	stats.longestLine = std::max(stats.longestLine, lineLength);
+	stats.sentences = sentences.Finish();
+
+	utext_close(utext);
+	chunk.status = B_OK;
+	return chunk.status;
+}
+
+
+// Splits the text into chunks ending at line breaks, which are boundaries for
+// words and sentences alike, and counts them on separate threads.
+status_t
+CountTextStatistics(const char* text, size_t length, TextStatistics& stats)
+{
+	stats = TextStatistics();
+	if (length == 0)
+		return B_OK;
+
+	UErrorCode status = U_ZERO_ERROR;
+	std::unique_ptr<icu::BreakIterator> wordIterator(
+		icu::BreakIterator::createWordInstance(icu::Locale::getDefault(), status));
+	if (U_FAILURE(status) || !wordIterator)
+		return B_ERROR;
+
+	system_info info;
+	int32 cpuCount = get_system_info(&info) == B_OK ? info.cpu_count : 1;
+	int32 chunkCount = std::min((size_t)std::min(std::max(cpuCount, (int32)1), kMaxChunks),
+		std::max(length / kMinChunkSize, (size_t)1));
+
+	std::vector<StatisticsChunk> chunks;
+	chunks.reserve(chunkCount);
+	std::vector<std::unique_ptr<icu::BreakIterator>> iterators;
+	size_t offset = 0;
+	for (int32 i = 0; i < chunkCount && offset < length; i++) {
+		size_t end = length;
+		if (i < chunkCount - 1) {
+			end = offset + (length - offset) / (chunkCount - i);
+			const char* lineEnd = (const char*)memchr(text + end, '\n', length - end);
+			end = lineEnd != nullptr ? lineEnd - text + 1 : length;
+		}
+
+		icu::BreakIterator* iterator = wordIterator.get();
+		if (i > 0) {
+			iterators.emplace_back(wordIterator->clone());
+			iterator = iterators.back().get();
+		}
+
+		StatisticsChunk& chunk = chunks.emplace_back();
+		chunk.text = text + offset;
+		chunk.length = end - offset;
+		chunk.wordIterator = iterator;
+		chunk.status = B_NO_INIT;
+		offset = end;
+	}
+
+	// The first chunk is counted on this thread while the others run
+	std::vector<thread_id> threads;
+	for (size_t i = 1; i < chunks.size(); i++) {
+		thread_id thread = spawn_thread(_CountChunk, "text statistics", B_NORMAL_PRIORITY,
+			&chunks[i]);
+		if (thread >= B_OK && resume_thread(thread) == B_OK)
+			threads.push_back(thread);
+		else
+			_CountChunk(&chunks[i]);
+	}
+	_CountChunk(&chunks[0]);
+
+	for (thread_id thread : threads) {
+		status_t result;
+		wait_for_thread(thread, &result);
+	}
+
+	for (const StatisticsChunk& chunk : chunks) {
+		if (chunk.status != B_OK)
+			return chunk.status;
+	}
+
+	// Merge into the largest table, which saves copying most of the words
+	size_t largest = 0;
+	for (size_t i = 1; i < chunks.size(); i++) {
+		if (chunks[i].stats.wordFrequency.CountWords()
+			> chunks[largest].stats.wordFrequency.CountWords()) {
+			largest = i;
+		}
+	}
+	stats = std::move(chunks[largest].stats);
+	for (size_t i = 0; i < chunks.size(); i++) {
+		if (i != largest)
+			stats.Merge(chunks[i].stats);
+	}
+
+	stats.lines = stats.lineBreaks + (text[length - 1] != '\n' ? 1 : 0);
+	return B_OK;
+}
+
+
+// Word break classes of UAX #29, as far as they matter for counting words.
+// Characters that need the full rules or dictionary segmentation are
+// WORD_COMPLEX.
+enum {
+	WORD_SPACE, // Not counted
+	WORD_OTHER, // A word of its own
+	WORD_LETTER,
+	WORD_NUMERIC,
+	WORD_EXTEND_NUM_LET,
+	WORD_MID_LETTER,
+	WORD_MID_NUM,
+	WORD_MID_NUM_LET,
+	WORD_COMPLEX
+};
+
+// The ways ICU tailors the word break rules for ASCII, depending on its
+// version and the locale
+struct WordRules {
+	bool atIsLetter; // Keeps e-mail addresses together, since ICU 72
+	bool periodIsMidNum; // Only joins numbers, in the POSIX locale
+};
+
+static const WordRules kWordRules[] = {
+	{true, false},
+	{false, false},
+	{true, true},
+	{false, true}
+};
+
+
+static inline int32
+_ASCIIWordClass(uint8 c, const WordRules& rules)
+{
+	if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+		return WORD_LETTER;
+	if (c >= '0' && c <= '9')
+		return WORD_NUMERIC;
+	if ((c >= 0x09 && c <= 0x0d) || (c >= 0x1c && c <= 0x20))
+		return WORD_SPACE;
+
+	switch (c) {
+		case '_':
+			return WORD_EXTEND_NUM_LET;
+		case ',':
+		case ';':
+			return WORD_MID_NUM;
+		case '\'':
+			return WORD_MID_NUM_LET;
+		case '.':
+			return rules.periodIsMidNum ? WORD_MID_NUM : WORD_MID_NUM_LET;
+		case '@':
+			return rules.atIsLetter ? WORD_LETTER : WORD_OTHER;
+		default:
+			// ICU does not treat ':' as MidLetter
+			return WORD_OTHER;
+	}
+}
+
+
+static int32
+_WordClass(UChar32 c, const WordRules& rules)
+{
+	if (c < 0x80)
+		return _ASCIIWordClass(c, rules);
+	if (_IsTrimmed(c))
+		return WORD_SPACE;
+	if (u_charType(c) == U_SPACE_SEPARATOR) {
+		// No-break spaces are not trimmed, but a word starting with one is
+		// not counted either
+		return u_getIntPropertyValue(c, UCHAR_WORD_BREAK) == U_WB_OTHER
+			? WORD_SPACE : WORD_COMPLEX;
+	}
+
+	// Scripts that ICU segments with dictionaries
+	if (c >= 0xac00 && c <= 0xd7a3)
+		return WORD_COMPLEX;
+	if (u_getIntPropertyValue(c, UCHAR_LINE_BREAK) == U_LB_COMPLEX_CONTEXT)
+		return WORD_COMPLEX;
+	UScriptCode script = (UScriptCode)u_getIntPropertyValue(c, UCHAR_SCRIPT);
+	if (script == USCRIPT_HAN || script == USCRIPT_HIRAGANA)
+		return WORD_COMPLEX;
+
+	switch (u_getIntPropertyValue(c, UCHAR_WORD_BREAK)) {
+		case U_WB_ALETTER:
+			return WORD_LETTER;
+		case U_WB_NUMERIC:
+			return WORD_NUMERIC;
+		case U_WB_EXTENDNUMLET:
+			return WORD_EXTEND_NUM_LET;
+		case U_WB_MIDLETTER:
+			return c == 0xfe55 || c == 0xff1a ? WORD_OTHER : WORD_MID_LETTER;
+		case U_WB_MIDNUM:
+			return WORD_MID_NUM;
+		case U_WB_MIDNUMLET:
+		case U_WB_SINGLE_QUOTE:
+			return WORD_MID_NUM_LET;
+		case U_WB_OTHER:
+		case U_WB_DOUBLE_QUOTE: // Only special next to Hebrew letters
+		case U_WB_CR:
+		case U_WB_LF:
+		case U_WB_NEWLINE:
+			return WORD_OTHER;
+		default:
+			return WORD_COMPLEX;
+	}
+}
+
+
+static inline bool
+_IsWordClass(int32 type)
+{
+	return type == WORD_LETTER || type == WORD_NUMERIC || type == WORD_EXTEND_NUM_LET;
+}
+
+
+// Counts words from their classes, one character at a time. Letters, digits
+// and connectors always form one word, punctuation between two letters or
+// two digits can join them, and every other character but white space is a
+// word of its own.
+class WordRunCounter {
+public:
+	WordRunCounter()
+		:
+		fWords(0),
+		fLast(WORD_SPACE),
+		fPendingMiddle(-1)
+	{
+	}
+
+	void Add(int32 type);
+	int64 Finish();
+
+private:
+	int64 fWords;
+	int32 fLast;
+	int32 fPendingMiddle;
+};
+
+
+void
+WordRunCounter::Add(int32 type)
+{
+	if (fPendingMiddle >= 0) {
+		bool joins = (fLast == WORD_LETTER && type == WORD_LETTER
+				&& (fPendingMiddle == WORD_MID_LETTER || fPendingMiddle == WORD_MID_NUM_LET))
+			|| (fLast == WORD_NUMERIC && type == WORD_NUMERIC
+				&& (fPendingMiddle == WORD_MID_NUM || fPendingMiddle == WORD_MID_NUM_LET));
+		int32 middle = fPendingMiddle;
+		fPendingMiddle = -1;
+		if (joins) {
+			fLast = type;
+			return;
+		}
+
+		fWords++;
+		fLast = middle;
+	}
+
+	switch (type) {
+		case WORD_LETTER:
+		case WORD_NUMERIC:
+		case WORD_EXTEND_NUM_LET:
+			if (!_IsWordClass(fLast))
+				fWords++;
+			break;
+		case WORD_MID_LETTER:
+		case WORD_MID_NUM:
+		case WORD_MID_NUM_LET:
+			if (fLast == WORD_LETTER || fLast == WORD_NUMERIC) {
+				// Decided by the next character
+				fPendingMiddle = type;
+				return;
+			}
+			fWords++;
+			break;
+		case WORD_OTHER:
+			fWords++;
+			break;
+	}
+	fLast = type;
+}
+
+
+int64
+WordRunCounter::Finish()
+{
+	if (fPendingMiddle >= 0)
+		fWords++;
+	fPendingMiddle = -1;
+	fLast = WORD_SPACE;
+	return fWords;
+}
+
+
+struct WordMasks {
+	uint32 letter;
+	uint32 numeric;
+	uint32 word; // Letters, digits and connectors
+	uint32 space;
+	uint32 midNum;
+	uint32 midNumLet;
+};
+
+
+static inline void
+_ClassifyASCII(const char* text, const WordRules& rules, WordMasks& masks)
+{
+#if defined(__SSE2__)
+	__m128i chunk = _mm_loadu_si128((const __m128i*)text);
+	__m128i folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+	__m128i letter = _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)),
+		_mm_cmplt_epi8(folded, _mm_set1_epi8('z' + 1)));
+	__m128i numeric = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)),
+		_mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)));
+	__m128i space = _mm_or_si128(
+		_mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(0x08)),
+			_mm_cmplt_epi8(chunk, _mm_set1_epi8(0x0e))),
+		_mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(0x1b)),
+			_mm_cmplt_epi8(chunk, _mm_set1_epi8(0x21))));
+	uint32 at = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('@')));
+	uint32 period = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('.')));
+
+	masks.letter = _mm_movemask_epi8(letter) | (rules.atIsLetter ? at : 0);
+	masks.numeric = _mm_movemask_epi8(numeric);
+	masks.word = masks.letter | masks.numeric
+		| _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')));
+	masks.space = _mm_movemask_epi8(space);
+	masks.midNum = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(',')),
+		_mm_cmpeq_epi8(chunk, _mm_set1_epi8(';'))));
+	masks.midNumLet = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\'')));
+	if (rules.periodIsMidNum)
+		masks.midNum |= period;
+	else
+		masks.midNumLet |= period;
+#else
+	masks = WordMasks();
+	for (int32 i = 0; i < 16; i++) {
+		uint32 bit = 1u << i;
+		switch (_ASCIIWordClass(text[i], rules)) {
+			case WORD_LETTER:
+				masks.letter |= bit;
+				masks.word |= bit;
+				break;
+			case WORD_NUMERIC:
+				masks.numeric |= bit;
+				masks.word |= bit;
+				break;
+			case WORD_EXTEND_NUM_LET:
+				masks.word |= bit;
+				break;
+			case WORD_SPACE:
+				masks.space |= bit;
+				break;
+			case WORD_MID_NUM:
+				masks.midNum |= bit;
+				break;
+			case WORD_MID_NUM_LET:
+				masks.midNumLet |= bit;
+				break;
+		}
+	}
+#endif
+}
+
+
+// Counts the words of ASCII text, 16 characters at a time. The classes of
+// the characters are turned into bit masks, which show where each word
+// starts, and which punctuation joins the characters around it.
+static int64
+_CountASCIIWords(const char* text, size_t length, const WordRules& rules)
+{
+	int64 words = 0;
+	uint32 previousWord = 0;
+	uint32 previousLetter = 0;
+	uint32 previousNumeric = 0;
+
+	char padded[16];
+	for (size_t i = 0; i < length; i += 16) {
+		const char* block = text + i;
+		uint8 next = ' ';
+		if (i + 16 < length)
+			next = text[i + 16];
+		else {
+			// The text ends in white space, as if followed by a line break
+			memset(padded, ' ', sizeof(padded));
+			memcpy(padded, block, length - i);
+			block = padded;
+		}
+
+		WordMasks masks;
+		_ClassifyASCII(block, rules, masks);
+		int32 nextType = _ASCIIWordClass(next, rules);
+
+		uint32 letterBefore = (masks.letter << 1) | previousLetter;
+		uint32 letterAfter = (masks.letter >> 1) | (nextType == WORD_LETTER ? 0x8000 : 0);
+		uint32 numericBefore = (masks.numeric << 1) | previousNumeric;
+		uint32 numericAfter = (masks.numeric >> 1) | (nextType == WORD_NUMERIC ? 0x8000 : 0);
+		uint32 joined = (masks.midNumLet
+				& ((letterBefore & letterAfter) | (numericBefore & numericAfter)))
+			| (masks.midNum & numericBefore & numericAfter);
+
+		uint32 word = masks.word | joined;
+		uint32 starts = word & ~((word << 1) | previousWord);
+		uint32 others = ~word & ~masks.space & 0xffff;
+		words += __builtin_popcount(starts) + __builtin_popcount(others);
+
+		previousWord = (word >> 15) & 1;
+		previousLetter = (masks.letter >> 15) & 1;
+		previousNumeric = (masks.numeric >> 15) & 1;
+	}
+
+	return words;
+}
+
+
+static icu::BreakIterator*
+_CreateWordIterator()
+{
+	UErrorCode status = U_ZERO_ERROR;
+	icu::BreakIterator* iterator
+		= icu::BreakIterator::createWordInstance(icu::Locale::getDefault(), status);
+	if (U_FAILURE(status)) {
+		delete iterator;
+		return nullptr;
+	}
+	return iterator;
+}
+
+
+// Counts the words with the ICU word break iterator, the same way
+// CountTextStatistics() does.
+static int64
+_CountWordsWithIterator(icu::BreakIterator* iterator, const char* text, int32 length)
+{
+	UErrorCode status = U_ZERO_ERROR;
+	UText* utext = utext_openUTF8(nullptr, text, length, &status);
+	iterator->setText(utext, status);
+	if (U_FAILURE(status)) {
+		utext_close(utext);
+		return 0;
+	}
+
+	int64 words = 0;
+	int32 start = iterator->first();
+	for (int32 end = iterator->next(); end != icu::BreakIterator::DONE;
+		start = end, end = iterator->next()) {
+		for (int32 i = start; i < end;) {
+			UChar32 c;
+			U8_NEXT(text, i, end, c);
+			if (c < 0)
+				c = 0xfffd;
+			if (!_IsTrimmed(c)) {
+				if (u_charType(c) != U_SPACE_SEPARATOR)
+					words++;
+				break;
+			}
+		}
+	}
+
+	utext_close(utext);
+	return words;
+}
+
+
+static const char*
+_FindNonASCII(const char* text, size_t length)
+{
+	size_t i = 0;
+#if defined(__SSE2__)
+	for (; i + 16 <= length; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i*)(text + i));
+		uint32 mask = _mm_movemask_epi8(chunk);
+		if (mask != 0)
+			return text + i + __builtin_ctz(mask);
+	}
+#endif
+	for (; i < length; i++) {
+		if ((uint8)text[i] >= 0x80)
+			return text + i;
+	}
+	return nullptr;
+}
+
+
+// Lines that are plain ASCII are counted with bit masks, other lines one
+// character at a time from their word break classes. Only lines with
+// characters that need dictionaries or the more involved rules, like CJK,
+// Thai or combining marks, are left to ICU.
+static int64
+_CountWords(const char* text, size_t length, const WordRules& rules,
+	std::unique_ptr<icu::BreakIterator>& iterator)
+{
+	int64 words = 0;
+	size_t position = 0;
+	while (position < length) {
+		const char* nonASCII = _FindNonASCII(text + position, length - position);
+		if (nonASCII == nullptr) {
+			words += _CountASCIIWords(text + position, length - position, rules);
+			break;
+		}
+
+		// Line breaks always end a word, so lines are counted on their own
+		size_t lineStart = nonASCII - text;
+		while (lineStart > position && text[lineStart - 1] != '\n')
+			lineStart--;
+		const char* lineEnd = (const char*)memchr(nonASCII, '\n', text + length - nonASCII);
+		size_t end = lineEnd != nullptr ? lineEnd - text + 1 : length;
+
+		words += _CountASCIIWords(text + position, lineStart - position, rules);
+
+		WordRunCounter counter;
+		bool complex = false;
+		for (int32 i = lineStart; i < (int32)end;) {
+			UChar32 c;
+			U8_NEXT(text, i, (int32)end, c);
+			if (c < 0)
+				c = 0xfffd;
+
+			int32 type = _WordClass(c, rules);
+			if (type == WORD_COMPLEX) {
+				if (!iterator)
+					iterator.reset(_CreateWordIterator());
+				if (iterator) {
+					complex = true;
+					break;
+				}
+				type = WORD_OTHER;
+			}
+			counter.Add(type);
+		}
+
+		if (complex)
+			words += _CountWordsWithIterator(iterator.get(), text + lineStart, end - lineStart);
+		else
+			words += counter.Finish();
+
+		position = end;
+	}
+
+	return words;
+}
+
+
+// Finds the rules that count like the ICU word break iterator, by counting
+// each character between letters, digits and itself both ways.
+static const WordRules*
+_FindWordRules()
+{
+	std::unique_ptr<icu::BreakIterator> iterator(_CreateWordIterator());
+	if (!iterator)
+		return nullptr;
+
+	static const char* kContexts[] = {"a%a", "1%1", "a%1", "1%a", "%a", "a%", "%1", "1%", "%%",
+		"a%%a", "_%_", " % "};
+	static const char* kCharacters[] = {"\xc2\xb7", "\xc3\xa9", "\xc2\xa0", "\xc2\x85",
+		"\xd9\xa3", "\xe2\x80\x83", "\xe2\x80\x98", "\xe2\x80\x99", "\xe2\x80\xa4",
+		"\xe2\x80\xa8", "\xe2\x80\xaf", "\xef\xb8\x93", "\xef\xb9\x95", "\xef\xbc\x87",
+		"\xef\xbc\x8c", "\xef\xbc\x8e", "\xef\xbc\x9a", "\xef\xbc\xa1"};
+
+	std::vector<std::string> probes;
+	for (int32 c = 1; c < 0x80 + (int32)B_COUNT_OF(kCharacters); c++) {
+		std::string character = c < 0x80 ? std::string(1, (char)c) : kCharacters[c - 0x80];
+		for (const char* context : kContexts) {
+			std::string probe;
+			for (const char* p = context; *p != '\0'; p++) {
+				if (*p == '%')
+					probe += character;
+				else
+					probe += *p;
+			}
+			probes.push_back(probe);
+		}
+	}
+
+	std::vector<int64> expected;
+	for (const std::string& probe : probes)
+		expected.push_back(_CountWordsWithIterator(iterator.get(), probe.data(), probe.length()));
+
+	for (const WordRules& rules : kWordRules) {
+		bool matches = true;
+		for (size_t i = 0; i < probes.size() && matches; i++) {
+			matches = _CountWords(probes[i].data(), probes[i].length(), rules, iterator)
+				== expected[i];
+		}
+		if (matches)
+			return &rules;
+	}
+
+	return nullptr;
+}
+
+
+// Probing the iterator takes a while, so the rules found are kept until the
+// default locale changes.
+static const WordRules*
+_WordRules()
+{
+	static BLocker sLock("word rules");
+	static std::string sLocale;
+	static const WordRules* sRules = nullptr;
+	static bool sProbed = false;
+
+	BAutolock _(sLock);
+	const char* locale = icu::Locale::getDefault().getName();
+	if (!sProbed || sLocale != locale) {
+		sRules = _FindWordRules();
+		sLocale = locale;
+		sProbed = true;
+	}
+	return sRules;
+}
+
+
+// Counts words as the ICU word break iterator splits them, like
+// CountTextStatistics() does, but without running the iterator over most
+// text. When ICU breaks words in a way the classes here cannot follow, it
+// counts everything.
+int64
+CountTextWords(const char* text, size_t length)
+{
+	const WordRules* rules = _WordRules();
+
+	std::unique_ptr<icu::BreakIterator> iterator;
+	if (rules != nullptr)
+		return _CountWords(text, length, *rules, iterator);
+
+	iterator.reset(_CreateWordIterator());
+	if (!iterator)
+		return 0;
+	return _CountWordsWithIterator(iterator.get(), text, length);
+}
+
+
+static void
+_AppendCSVField(TextBuilder& output, std::string_view field)
+{
+	if (field.find_first_of(",\"\r\n") == std::string_view::npos) {
+		output << field;
+		return;
+	}
+
+	output << '"';
+	for (char c : field) {
+		if (c == '"')
+			output << '"';
+		output << c;
+	}
+	output << '"';
+}
+
+
+// Writes all words, most frequent first, as "word,count" lines with a header
+status_t
+WriteWordFrequencyCSV(const WordFrequency& frequency, BDataIO* output)
+{
+	std::vector<WordCount> words;
+	frequency.GetAllWords(words);
+	std::sort(words.begin(), words.end(), _MoreFrequent);
+
+	TextBuilder buffer(kWriteBufferSize);
+	buffer << "word,count\n";
+	for (const WordCount& word : words) {
+		_AppendCSVField(buffer, word.word);
+		buffer << ',';
+		char number[16];
+		buffer.Append(number, snprintf(number, sizeof(number), "%" B_PRId32, word.count));
+		buffer << '\n';
+
+		if ((size_t)buffer.Length() >= kWriteBufferSize) {
+			status_t status = buffer.InitCheck();
+			if (status == B_OK)
+				status = output->WriteExactly(buffer.View().data(), buffer.Length());
+			if (status != B_OK)
+				return status;
+			buffer.Clear();
+		}
+	}
+
+	if (buffer.InitCheck() != B_OK)
+		return buffer.InitCheck();
+	return output->WriteExactly(buffer.View().data(), buffer.Length());
+}
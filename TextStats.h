@@ -0,0 +1,78 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef TEXT_STATS_H
+#define TEXT_STATS_H
+
+#include <SupportDefs.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class BDataIO;
+
+struct WordCount {
+	std::string_view word;
+	int32 count;
+};
+
+// Counts words in an open addressing hash table. The words are copied into
+// blocks owned by the table, so adding a word does not allocate a string for
+// it, and the views handed out stay valid as long as the table does.
+class WordFrequency {
+public:
+	WordFrequency();
+
+	void Add(const char* word, size_t length, int32 count = 1);
+	void Merge(const WordFrequency& other);
+
+	int32 CountWords() const { return fCount; }
+
+	// Most frequent words first, ties in alphabetical order
+	void GetTopWords(size_t count, std::vector<WordCount>& words) const;
+	void GetAllWords(std::vector<WordCount>& words) const;
+
+private:
+	struct Slot {
+		const char* word;
+		uint32 length;
+		uint32 hash;
+		int32 count;
+	};
+
+	const char* _Intern(const char* word, size_t length);
+	void _Resize(size_t size);
+
+	std::vector<Slot> fSlots;
+	int32 fCount;
+	std::vector<std::unique_ptr<char[]>> fBlocks;
+	char* fBlockPosition;
+	size_t fBlockRemaining;
+};
+
+// Statistics of a text, collected in a single pass. Partial results of
+// separate chunks are combined with Merge(), as long as every chunk but the
+// last ends with a line break.
+struct TextStatistics {
+	TextStatistics();
+
+	void Merge(const TextStatistics& other);
+
+	int64 characters;
+	int64 words;
+	int64 lines;
+	int64 lineBreaks;
+	int64 sentences;
+	int64 longestLine; // In bytes
+	int64 wordCharacters; // Characters of all words starting with a letter or digit
+	WordFrequency wordFrequency; // Lowercase, longer than two bytes
+};
+
+status_t CountTextStatistics(const char* text, size_t length, TextStatistics& stats);
+int64 CountTextWords(const char* text, size_t length);
+void FoldWordCase(const char* word, size_t length, std::string& folded);
+status_t WriteWordFrequencyCSV(const WordFrequency& frequency, BDataIO* output);
+
+#endif // TEXT_STATS_H
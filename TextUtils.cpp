@@ -5,20 +5,34 @@
 
 
 #include "TextUtils.h"
+#include "AhoCorasick.h"
+#include "Compression.h"
 #include "Constants.h"
+#include "HtmlEntities.h"
+#include "LineIndex.h"
+#include "TextCodecs.h"
+#include "TextBuilder.h"
+#include "TextDiff.h"
+#include "TextEncoding.h"
+#include "TextSearch.h"
+#include "TextStats.h"
+#include "UndoableTextView.h"
 #include <Alert.h>
 #include <Application.h>
 #include <Catalog.h>
 #include <File.h>
 #include <LayoutBuilder.h>
+#include <NodeInfo.h>
 #include <String.h>
 #include <TextControl.h>
 #include <algorithm>
 #include <cctype>
-#include <map>
+#include <cstring>
+#include <memory>
+#include <new>
 #include <set>
-#include <sstream>
 #include <unicode/brkiter.h>
+#include <unicode/bytestream.h>
 #include <unicode/coll.h>
 #include <unicode/locid.h>
 #include <unicode/unistr.h>
@@ -30,31 +44,36 @@
 int32 startSelection, endSelection; // For cursor position
 int32 selStart, selEnd; // For selected text
 bool appliedToSelection = true;
+static BString* sStatusCapture = nullptr; // Set while a transform is previewed
 
 
-BString
-GetText(BTextView* textView, bool isLineBased)
+// Returns the text a transform works on without copying it: the selection,
+// or the entire text when nothing is selected. The view points into the text
+// view's buffer and is only valid until the text is changed.
+std::string_view
+GetTextRange(BTextView* textView, bool isLineBased)
 {
 	selStart = 0;
 	selEnd = 0;
+	appliedToSelection = false;
 
 	if (textView == nullptr)
-		return BString("");
+		return std::string_view();
 
 	int32 textLength = textView->TextLength();
 	if (textLength == 0)
-		return BString("");
+		return std::string_view();
+
+	const char* fullText = textView->Text();
 
 
 	textView->GetSelection(&selStart, &selEnd);
+	appliedToSelection = selStart != selEnd;
 
 	if (selStart == selEnd) { // No selection
 		selStart = 0;
 		selEnd = textLength;
-		appliedToSelection = false;
 	} else if (isLineBased) {
-		const char* fullText = textView->Text();
-
 		// Extend selStartOut to beginning of line
 		while (selStart > 0 && fullText[selStart - 1] != '\n')
 			selStart--;
@@ -67,15 +86,75 @@ GetText(BTextView* textView, bool isLineBased)
 			selEnd++;
 	}
 
-	char* buffer = new char[selEnd - selStart + 1];
-	textView->GetText(selStart, selEnd - selStart, buffer);
-	buffer[selEnd - selStart] = '\0';
+	SaveCursorPosition(textView);
+	return std::string_view(fullText + selStart, selEnd - selStart);
+}
 
-	BString result(buffer);
-	delete[] buffer;
 
-	SaveCursorPosition(textView);
-	return result;
+// Like GetTextRange(), but returns a copy for transforms that edit the text in place.
+BString
+GetText(BTextView* textView, bool isLineBased)
+{
+	std::string_view text = GetTextRange(textView, isLineBased);
+	return BString(text.data(), text.length());
+}
+
+
+// Splits the range returned by GetTextRange() into lines. The editor keeps
+// its line index until the text changes, other views are indexed on demand.
+static LineRange
+_GetLines(BTextView* textView)
+{
+	static LineIndex sIndex;
+
+	const LineIndex* index = &sIndex;
+	if (UndoableTextView* view = dynamic_cast<UndoableTextView*>(textView))
+		index = &view->Lines();
+	else
+		sIndex.SetTo(textView->Text(), textView->TextLength());
+
+	return LineRange(*index, textView->Text(), selStart, selEnd);
+}
+
+
+static inline bool
+_StartsWith(std::string_view text, const BString& prefix)
+{
+	return text.length() >= (size_t)prefix.Length()
+		&& memcmp(text.data(), prefix.String(), prefix.Length()) == 0;
+}
+
+
+static inline bool
+_EndsWith(std::string_view text, const BString& suffix)
+{
+	return text.length() >= (size_t)suffix.Length()
+		&& memcmp(text.data() + text.length() - suffix.Length(), suffix.String(), suffix.Length())
+		== 0;
+}
+
+
+// Whether decoded bytes read as text: valid UTF-8 without zero bytes or
+// control codes. Short words are often valid Base64 too, but decode to junk.
+static bool
+_IsDecodedText(const char* data, size_t length)
+{
+	TextScanner scanner;
+	scanner.Add(data, length);
+	const TextScan& scan = scanner.Result();
+	return scan.IsValidUTF8() && scan.nulBytes == 0 && scan.controlBytes == 0;
+}
+
+
+// Leaves the text as it was when its transform ran out of memory
+static bool
+_IsBuilt(const TextBuilder& result)
+{
+	if (result.InitCheck() == B_OK)
+		return true;
+
+	SendStatusMessage(B_TRANSLATE("Not enough memory to transform the text"));
+	return false;
 }
 
 
@@ -100,25 +179,43 @@ RestoreCursorPosition(BTextView* textView, int32 textLength)
 }
 
 
+// Converts ICU text back to UTF-8 straight into the builder
+static void
+_AppendUTF8(TextBuilder& builder, const icu::UnicodeString& text)
+{
+	// A UTF-16 code unit never takes more than three bytes in UTF-8
+	int32 maxLength = text.length() * 3;
+	char* buffer = builder.AppendBuffer(maxLength);
+	if (buffer == nullptr)
+		return;
+
+	icu::CheckedArrayByteSink sink(buffer, maxLength);
+	text.toUTF8(sink);
+	builder.Commit(sink.NumberOfBytesWritten());
+}
+
+
 void
 ConvertToUppercase(BTextView* textView)
 {
-	BString text = GetText(textView, false);
-	BString original = text;
+	std::string_view text = GetTextRange(textView, false);
 
-	icu::UnicodeString unicodeText = icu::UnicodeString::fromUTF8(text.String());
+	icu::UnicodeString unicodeText
+		= icu::UnicodeString::fromUTF8(icu::StringPiece(text.data(), text.length()));
 	unicodeText.toUpper();
 
 	// Convert back to UTF-8
-	std::string utf8Text;
-	unicodeText.toUTF8String(utf8Text);
-	text = utf8Text.c_str();
+	TextBuilder utf8Text(text.length());
+	_AppendUTF8(utf8Text, unicodeText);
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, text, text.Length());
+	if (!_IsBuilt(utf8Text))
+		return;
+
+	// Count before writing back, the view is invalid afterwards
+	int32 changedCount = _CountCharChanges(text, utf8Text.View());
+	ReplaceText(textView, selStart, selEnd, utf8Text.View());
 
 	BString status;
-	int32 changedCount = _CountCharChanges(original, text);
 	if (appliedToSelection) {
 		status.SetToFormat(B_TRANSLATE("%i characters changed to uppercase in selection"),
 			changedCount);
@@ -134,21 +231,23 @@ ConvertToUppercase(BTextView* textView)
 void
 ConvertToLowercase(BTextView* textView)
 {
-	BString text = GetText(textView, false);
-	BString original = text;
+	std::string_view text = GetTextRange(textView, false);
 
-	icu::UnicodeString unicodeText = icu::UnicodeString::fromUTF8(text.String());
+	icu::UnicodeString unicodeText
+		= icu::UnicodeString::fromUTF8(icu::StringPiece(text.data(), text.length()));
 	unicodeText.toLower();
 
 	// Convert back to UTF-8
-	std::string utf8Text;
-	unicodeText.toUTF8String(utf8Text);
-	text = utf8Text.c_str();
+	TextBuilder utf8Text(text.length());
+	_AppendUTF8(utf8Text, unicodeText);
+
+	if (!_IsBuilt(utf8Text))
+		return;
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, text, text.Length());
+	// Count before writing back, the view is invalid afterwards
+	int32 changedCount = _CountCharChanges(text, utf8Text.View());
+	ReplaceText(textView, selStart, selEnd, utf8Text.View());
 	BString status;
-	int32 changedCount = _CountCharChanges(original, text);
 	if (appliedToSelection) {
 		status.SetToFormat(B_TRANSLATE("%i characters changed to lowercase in selection"),
 			changedCount);
@@ -164,10 +263,10 @@ ConvertToLowercase(BTextView* textView)
 void
 ConvertToTitlecase(BTextView* textView)
 {
-	BString text = GetText(textView, false);
-	BString original = text;
+	std::string_view text = GetTextRange(textView, false);
 
-	icu::UnicodeString unicodeText = icu::UnicodeString::fromUTF8(text.String());
+	icu::UnicodeString unicodeText
+		= icu::UnicodeString::fromUTF8(icu::StringPiece(text.data(), text.length()));
 	unicodeText.toLower(); // normalize first
 
 	bool capitalizeNext = true;
@@ -187,14 +286,16 @@ ConvertToTitlecase(BTextView* textView)
 		}
 	}
 
-	std::string utf8Text;
-	unicodeText.toUTF8String(utf8Text);
-	text = utf8Text.c_str();
+	TextBuilder utf8Text(text.length());
+	_AppendUTF8(utf8Text, unicodeText);
+
+	if (!_IsBuilt(utf8Text))
+		return;
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, text, text.Length());
+	// Count before writing back, the view is invalid afterwards
+	int32 changedCount = _CountCharChanges(text, utf8Text.View());
+	ReplaceText(textView, selStart, selEnd, utf8Text.View());
 	BString status;
-	int32 changedCount = _CountCharChanges(original, text);
 	if (appliedToSelection)
 		status.SetToFormat(B_TRANSLATE("%i characters changed in selection"), changedCount);
 	else
@@ -207,10 +308,10 @@ ConvertToTitlecase(BTextView* textView)
 void
 Capitalize(BTextView* textView)
 {
-	BString rawText = GetText(textView, false);
-	BString original = rawText;
+	std::string_view text = GetTextRange(textView, false);
 
-	icu::UnicodeString utext = icu::UnicodeString::fromUTF8(rawText.String());
+	icu::UnicodeString utext
+		= icu::UnicodeString::fromUTF8(icu::StringPiece(text.data(), text.length()));
 	utext.toLower(); // lowercase everything first
 
 	bool capitalizeNext = true;
@@ -229,16 +330,16 @@ Capitalize(BTextView* textView)
 	}
 
 	// Convert result back to UTF-8
-	std::string utf8Result;
-	utext.toUTF8String(utf8Result);
-	BString text(utf8Result.c_str());
+	TextBuilder utf8Result(text.length());
+	_AppendUTF8(utf8Result, utext);
 
-	textView->Select(selStart, selEnd);
-	textView->Delete();
-	textView->Insert(text.String());
+	if (!_IsBuilt(utf8Result))
+		return;
+
+	int32 changedCount = _CountCharChanges(text, utf8Result.View());
+	ReplaceText(textView, selStart, selEnd, utf8Result.View());
 
 	BString status;
-	int32 changedCount = _CountCharChanges(original, text);
 	if (appliedToSelection)
 		status.SetToFormat(B_TRANSLATE("%i characters changed in selection"), changedCount);
 	else
@@ -251,27 +352,29 @@ Capitalize(BTextView* textView)
 void
 ConvertToRandomCase(BTextView* textView)
 {
-	BString text = GetText(textView, false);
-	BString original = text;
+	std::string_view original = GetTextRange(textView, false);
+	TextBuilder text(original.length());
+	char* buffer = text.AppendBuffer(original.length());
+	if (!_IsBuilt(text))
+		return;
 
 	srand(time(nullptr)); // Seed random number generator
 
-	for (int32 i = 0; i < text.Length(); ++i) {
-		char currentChar = text.ByteAt(i);
+	for (size_t i = 0; i < original.length(); ++i) {
+		char currentChar = original[i];
 		if (std::isalpha(currentChar)) {
 			if (rand() % 2 == 0)
 				currentChar = std::toupper(currentChar);
 			else
 				currentChar = std::tolower(currentChar);
-
-			text.SetByteAt(i, currentChar);
 		}
+		buffer[i] = currentChar;
 	}
+	text.Commit(original.length());
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, text.String(), text.Length());
+	int32 changedCount = _CountCharChanges(original, text.View());
+	ReplaceText(textView, selStart, selEnd, text.View());
 	BString status;
-	int32 changedCount = _CountCharChanges(original, text);
 	if (appliedToSelection)
 		status.SetToFormat(B_TRANSLATE("%i characters changed in selection"), changedCount);
 	else
@@ -284,12 +387,15 @@ ConvertToRandomCase(BTextView* textView)
 void
 ConvertToAlternatingCase(BTextView* textView)
 {
-	BString text = GetText(textView, false);
-	BString original = text;
+	std::string_view original = GetTextRange(textView, false);
+	TextBuilder text(original.length());
+	char* buffer = text.AppendBuffer(original.length());
+	if (!_IsBuilt(text))
+		return;
 
-	bool uppercase = !(std::isupper(text.ByteAt(0)));
-	for (int32 i = 0; i < text.Length(); ++i) {
-		char currentChar = text.ByteAt(i);
+	bool uppercase = original.empty() || !std::isupper(original[0]);
+	for (size_t i = 0; i < original.length(); ++i) {
+		char currentChar = original[i];
 		if (std::isalpha(currentChar)) {
 			if (uppercase)
 				currentChar = std::toupper(currentChar);
@@ -297,14 +403,14 @@ ConvertToAlternatingCase(BTextView* textView)
 				currentChar = std::tolower(currentChar);
 
 			uppercase = !uppercase;
-			text.SetByteAt(i, currentChar);
 		}
+		buffer[i] = currentChar;
 	}
+	text.Commit(original.length());
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, text.String(), text.Length());
+	int32 changedCount = _CountCharChanges(original, text.View());
+	ReplaceText(textView, selStart, selEnd, text.View());
 	BString status;
-	int32 changedCount = _CountCharChanges(original, text);
 	if (appliedToSelection)
 		status.SetToFormat(B_TRANSLATE("%i characters changed in selection"), changedCount);
 	else
@@ -317,22 +423,25 @@ ConvertToAlternatingCase(BTextView* textView)
 void
 ToggleCase(BTextView* textView)
 {
-	BString text = GetText(textView, false);
-	BString original = text;
+	std::string_view original = GetTextRange(textView, false);
+	TextBuilder text(original.length());
+	char* buffer = text.AppendBuffer(original.length());
+	if (!_IsBuilt(text))
+		return;
 
-	for (int32 i = 0; i < text.Length(); ++i) {
-		char currentChar = text.ByteAt(i);
+	for (size_t i = 0; i < original.length(); ++i) {
+		char currentChar = original[i];
 		if (std::isupper(currentChar))
 			currentChar = std::tolower(currentChar);
 		else if (std::islower(currentChar))
 			currentChar = std::toupper(currentChar);
-		text.SetByteAt(i, currentChar);
+		buffer[i] = currentChar;
 	}
+	text.Commit(original.length());
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, text.String(), text.Length());
+	int32 changedCount = _CountCharChanges(original, text.View());
+	ReplaceText(textView, selStart, selEnd, text.View());
 	BString status;
-	int32 changedCount = _CountCharChanges(original, text);
 	if (appliedToSelection)
 		status.SetToFormat(B_TRANSLATE("%i characters changed in selection"), changedCount);
 	else
@@ -345,17 +454,22 @@ ToggleCase(BTextView* textView)
 void
 RemoveLineBreaks(BTextView* textView, BString replacement)
 {
-	BString text = GetText(textView, true);
+	std::string_view original = GetTextRange(textView, true);
 
-	int32 count = 0;
-	for (int32 i = 0; i < text.Length(); i++) {
-		if (text[i] == '\n')
-			count++;
+	int32 count = std::count(original.begin(), original.end(), '\n');
+	TextBuilder text(original.length() - count + count * replacement.Length());
+
+	size_t start = 0;
+	size_t end;
+	while ((end = original.find('\n', start)) != std::string_view::npos) {
+		text << original.substr(start, end - start) << replacement;
+		start = end + 1;
 	}
-	text.ReplaceAll("\n", replacement);
+	text << original.substr(start);
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, text.String(), text.Length());
+	if (!_IsBuilt(text))
+		return;
+	ReplaceText(textView, selStart, selEnd, text.View());
 
 	BString status;
 	if (replacement.IsEmpty()) {
@@ -378,11 +492,15 @@ RemoveLineBreaks(BTextView* textView, BString replacement)
 void
 ConvertToROT13(BTextView* textView)
 {
-	BString text = GetText(textView, false);
+	std::string_view original = GetTextRange(textView, false);
+	TextBuilder text(original.length());
+	char* buffer = text.AppendBuffer(original.length());
+	if (!_IsBuilt(text))
+		return;
 	int32 count = 0;
 
-	for (int32 i = 0; i < text.Length(); ++i) {
-		char currentChar = text.ByteAt(i);
+	for (size_t i = 0; i < original.length(); ++i) {
+		char currentChar = original[i];
 
 		if (std::isalpha(currentChar)) {
 			if (std::islower(currentChar))
@@ -391,11 +509,11 @@ ConvertToROT13(BTextView* textView)
 				currentChar = 'A' + (currentChar - 'A' + 13) % 26;
 			count++;
 		}
-		text.SetByteAt(i, currentChar);
+		buffer[i] = currentChar;
 	}
+	text.Commit(original.length());
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, text.String(), text.Length());
+	ReplaceText(textView, selStart, selEnd, text.View());
 	BString status;
 	if (appliedToSelection)
 		status.SetToFormat(B_TRANSLATE("ROT13 applied to %i characters in selection"), count);
@@ -407,35 +525,18 @@ ConvertToROT13(BTextView* textView)
 
 
 void
-URLEncode(BTextView* textView)
+URLEncode(BTextView* textView, UrlEncodeSet set)
 {
-	BString text = GetText(textView, false);
+	std::string_view text = GetTextRange(textView, false);
 
-	BString encoded;
-	for (int32 i = 0; i < text.Length(); ++i) {
-		char currentChar = text.ByteAt(i);
-
-		// Check if the character is URL-safe (alphanumeric or special characters)
-		if (std::isalnum(currentChar) || currentChar == '-' || currentChar == '_'
-			|| currentChar == '.' || currentChar == '~') {
-			encoded += currentChar;
-		} else {
-			// Encode the non-safe characters
-			encoded += '%';
-			std::stringstream ss;
-			ss << std::uppercase << std::hex
-			   << (int)(unsigned char)currentChar; // Convert char to hex
-			std::string hexStr = ss.str();
-
-			// Ensure the hex string is two characters long
-			if (hexStr.length() == 1)
-				encoded += '0'; // Add leading zero if needed
-			encoded += BString(hexStr.c_str()); // Convert std::string to BString and append
-		}
-	}
+	size_t length = UrlEncodedLength(text.data(), text.length(), set);
+	TextBuilder encoded(length);
+	char* buffer = encoded.AppendBuffer(length);
+	if (!_IsBuilt(encoded))
+		return;
+	encoded.Commit(UrlEncode(text.data(), text.length(), buffer, set));
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, encoded.String(), encoded.Length());
+	ReplaceText(textView, selStart, selEnd, encoded.View());
 	BString status;
 	if (appliedToSelection)
 		status.Append(B_TRANSLATE("Selected text URL-encoded"));
@@ -447,35 +548,18 @@ URLEncode(BTextView* textView)
 
 
 void
-URLDecode(BTextView* textView)
+URLDecode(BTextView* textView, UrlEncodeSet set)
 {
-	BString text = GetText(textView, false);
-
-	BString decoded;
-	for (int32 i = 0; i < text.Length(); ++i) {
-		char currentChar = text.ByteAt(i);
-
-		if (currentChar == '%') {
-			// Check if there are enough characters for a valid hex code
-			if (i + 2 < text.Length()) {
-				char hex[3] = {text.ByteAt(i + 1), text.ByteAt(i + 2), '\0'};
-				int decodedChar = 0;
-				std::stringstream ss;
-				ss << std::hex << hex;
-				ss >> decodedChar;
-
-				// Append the decoded character
-				decoded += static_cast<char>(decodedChar);
-				i += 2; // Skip the next two characters (hex code)
-			}
-		} else {
-			// Regular character, append to decoded string
-			decoded += currentChar;
-		}
-	}
+	std::string_view text = GetTextRange(textView, false);
+
+	// Decoding never makes the text longer
+	TextBuilder decoded(text.length());
+	char* buffer = decoded.AppendBuffer(text.length());
+	if (!_IsBuilt(decoded))
+		return;
+	decoded.Commit(UrlDecode(text.data(), text.length(), buffer, set == URL_ENCODE_FORM));
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, decoded.String(), decoded.Length());
+	ReplaceText(textView, selStart, selEnd, decoded.View());
 	BString status;
 	if (appliedToSelection)
 		status.Append(B_TRANSLATE("Selected text URL-decoded"));
@@ -487,72 +571,42 @@ URLDecode(BTextView* textView)
 
 
 void
-Base64(BTextView* textView)
+Base64(BTextView* textView, Base64Variant variant)
 {
-	BString text = GetText(textView, false);
-
-	// Auto-detect: if text looks like Base64, decode — otherwise encode
-	bool isBase64 = true;
-	int32 len = text.Length();
-
-	// Basic checks: non-empty, length multiple of 4, valid charset
-	if (len == 0 || len % 4 != 0) {
-		isBase64 = false;
-	} else {
-		for (int32 i = 0; i < len && isBase64; ++i) {
-			char c = text.ByteAt(i);
-			bool validChar = std::isalnum(c) || c == '+' || c == '/' || c == '=';
-			if (!validChar)
-				isBase64 = false;
-			// Padding '=' is only valid at the end
-			if (c == '=' && i < len - 2)
-				isBase64 = false;
+	std::string_view text = GetTextRange(textView, false);
+	int32 len = text.length();
+
+	// Auto-detect by decoding right away: text that is not Base64 is rejected
+	// at the first invalid character, and is then encoded instead. So is text
+	// that decodes to something other than text, like "Test" or "word".
+	TextBuilder result(Base64Encoder::EncodedLength(len, variant));
+	bool isBase64 = false;
+	if (len > 0) {
+		Base64Decoder decoder(variant != BASE64_URL_SAFE);
+		char* buffer = result.AppendBuffer(Base64Decoder::MaxDecodedLength(len));
+		if (!_IsBuilt(result))
+			return;
+		ssize_t decoded = decoder.Update(text.data(), len, buffer);
+		if (decoded >= 0) {
+			ssize_t tail = decoder.Finish(buffer + decoded);
+			decoded = tail >= 0 ? decoded + tail : tail;
 		}
+		isBase64 = decoded > 0 && _IsDecodedText(buffer, decoded);
+		if (isBase64)
+			result.Commit(decoded);
 	}
 
-	BString result;
-
-	if (isBase64) {
-		// === Decode ===
-		const char* kChars
-			= "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-		auto indexOf = [&](char c) -> int {
-			const char* p = strchr(kChars, c);
-			return p ? (int)(p - kChars) : -1;
-		};
-
-		for (int32 i = 0; i < len; i += 4) {
-			int b0 = indexOf(text.ByteAt(i));
-			int b1 = indexOf(text.ByteAt(i + 1));
-			int b2 = text.ByteAt(i + 2) != '=' ? indexOf(text.ByteAt(i + 2)) : -1;
-			int b3 = text.ByteAt(i + 3) != '=' ? indexOf(text.ByteAt(i + 3)) : -1;
-
-			result += (char)((b0 << 2) | (b1 >> 4));
-			if (b2 != -1)
-				result += (char)(((b1 & 0xF) << 4) | (b2 >> 2));
-			if (b3 != -1)
-				result += (char)(((b2 & 0x3) << 6) | b3);
-		}
-	} else {
-		// === Encode ===
-		const char* kChars
-			= "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
-		int32 i = 0;
-		while (i < len) {
-			unsigned char b0 = (unsigned char)text.ByteAt(i++);
-			unsigned char b1 = i < len ? (unsigned char)text.ByteAt(i++) : 0;
-			unsigned char b2 = i < len ? (unsigned char)text.ByteAt(i++) : 0;
-
-			result += kChars[b0 >> 2];
-			result += kChars[((b0 & 0x3) << 4) | (b1 >> 4)];
-			result += (i - 1 > len) ? '=' : kChars[((b1 & 0xF) << 2) | (b2 >> 6)];
-			result += (i > len)     ? '=' : kChars[b2 & 0x3F];
-		}
+	if (!isBase64) {
+		Base64Encoder encoder(variant);
+		char* buffer = result.AppendBuffer(Base64Encoder::EncodedLength(len, variant));
+		if (!_IsBuilt(result))
+			return;
+		size_t encoded = encoder.Update(text.data(), len, buffer);
+		encoded += encoder.Finish(buffer + encoded);
+		result.Commit(encoded);
 	}
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, result.String(), result.Length());
+	ReplaceText(textView, selStart, selEnd, result.View());
 
 	BString status;
 	if (isBase64) {
@@ -574,209 +628,83 @@ Base64(BTextView* textView)
 void
 EncodeHTMLEntities(BTextView* textView, bool encodeByName)
 {
-	BString text = GetText(textView, false);
-	BString result;
-
-	int32 len = text.Length();
-
-	for (int32 i = 0; i < len; ) {
-
-		unsigned char b0 = (unsigned char)text.ByteAt(i);
-
-		uint32 codepoint = 0;
-		int32 seqLen = 1;
-
-		if (b0 < 0x80) {
-			codepoint = b0;
-		} else if ((b0 & 0xE0) == 0xC0 && i + 1 < len) {
-
-			codepoint =
-				(b0 & 0x1F) << 6
-				| ((unsigned char)text.ByteAt(i + 1) & 0x3F);
-
-			seqLen = 2;
-
-		} else if ((b0 & 0xF0) == 0xE0 && i + 2 < len) {
-
-			codepoint =
-				(b0 & 0x0F) << 12
-				| ((unsigned char)text.ByteAt(i + 1) & 0x3F) << 6
-				| ((unsigned char)text.ByteAt(i + 2) & 0x3F);
-
-			seqLen = 3;
+	std::string_view text = GetTextRange(textView, false);
 
-		} else if ((b0 & 0xF8) == 0xF0 && i + 3 < len) {
-
-			codepoint =
-				(b0 & 0x07) << 18
-				| ((unsigned char)text.ByteAt(i + 1) & 0x3F) << 12
-				| ((unsigned char)text.ByteAt(i + 2) & 0x3F) << 6
-				| ((unsigned char)text.ByteAt(i + 3) & 0x3F);
-
-			seqLen = 4;
-		}
-
-		i += seqLen;
-
-		bool found = false;
-
-		for (int32 e = 0; e < kEntityCount; ++e) {
-
-			if (kEntities[e].codepoint != codepoint)
-				continue;
-
-			result += '&';
-
-			if (encodeByName) {
-				result += kEntities[e].name;
-			} else {
-				result += '#';
-				result << codepoint;
-			}
-
-			result += ';';
-
-			found = true;
-			break;
-		}
-
-		if (!found) {
-
-			if (codepoint >= 128) {
-
-				result += '&';
-				result += '#';
-				result << codepoint;
-				result += ';';
+	size_t length = HtmlEncode(text.data(), text.length(), nullptr, encodeByName);
+	TextBuilder result(length);
+	char* buffer = result.AppendBuffer(length);
+	if (!_IsBuilt(result))
+		return;
+	result.Commit(HtmlEncode(text.data(), text.length(), buffer, encodeByName));
 
-			} else {
-				result += (char)codepoint;
-			}
-		}
+	if (result.View() != text) {
+		ReplaceText(textView, selStart, selEnd, result.View());
 	}
 
-	textView->SetText(result.String());
-
-	SendStatusMessage(
-		encodeByName
-			? B_TRANSLATE("Text HTML-encoded (named entities)")
-			: B_TRANSLATE("Text HTML-encoded (numeric entities)"));
+	BString status;
+	if (encodeByName) {
+		if (appliedToSelection)
+			status.Append(B_TRANSLATE("Selected text HTML-encoded (named entities)"));
+		else
+			status.Append(B_TRANSLATE("Entire text HTML-encoded (named entities)"));
+	} else {
+		if (appliedToSelection)
+			status.Append(B_TRANSLATE("Selected text HTML-encoded (numeric entities)"));
+		else
+			status.Append(B_TRANSLATE("Entire text HTML-encoded (numeric entities)"));
+	}
+	SendStatusMessage(status);
+	RestoreCursorPosition(textView, result.Length());
 }
 
 
 void
 DecodeHTMLEntities(BTextView* textView)
 {
-	BString text = GetText(textView, false);
-	BString result;
+	std::string_view text = GetTextRange(textView, false);
 
-	int32 len = text.Length();
-	for (int32 i = 0; i < len;) {
-		char c = text.ByteAt(i);
-		if (c != '&') {
-			result += c;
-			++i;
-			continue;
-		}
-		int32 semi = text.FindFirst(';', i + 1);
-		if (semi < 0 || semi - i > 16) {
-			result += c;
-			++i;
-			continue;
-		}
-
-		BString entity;
-		text.CopyInto(entity, i + 1, semi - i - 1);
-
-		uint32 codepoint = 0;
-		bool found = false;
-
-		// Numeric
-		if (entity.ByteAt(0) == '#') {
-			found = true;
-			if (entity.ByteAt(1) == 'x' || entity.ByteAt(1) == 'X') {
-				BString hex;
-				entity.CopyInto(hex, 2, entity.Length() - 2);
-				codepoint = (uint32)strtoul(hex.String(), nullptr, 16);
-			} else {
-				BString dec;
-				entity.CopyInto(dec, 1,
-					entity.Length() - 1);
-
-				codepoint = (uint32)strtoul(
-					dec.String(), nullptr, 10);
-			}
-		} else {
-			// Named
-			for (int32 e = 0;
-				e < kEntityCount;
-				++e) {
-
-				if (entity != kEntities[e].name)
-					continue;
-
-				codepoint = kEntities[e].codepoint;
-				found = true;
-				break;
-			}
-		}
+	TextBuilder result(HtmlDecodedMaxLength(text.length()));
+	char* buffer = result.AppendBuffer(HtmlDecodedMaxLength(text.length()));
+	if (!_IsBuilt(result))
+		return;
+	result.Commit(HtmlDecode(text.data(), text.length(), buffer));
 
-		if (found && codepoint > 0) {
-			if (codepoint < 0x80) {
-				result += (char)codepoint;
-			} else if (codepoint < 0x800) {
-				result += (char)(0xC0 | (codepoint >> 6));
-				result += (char)(0x80 | (codepoint & 0x3F));
-			} else if (codepoint < 0x10000) {
-				result += (char)(0xE0 | (codepoint >> 12));
-				result += (char)(0x80 | ((codepoint >> 6) & 0x3F));
-				result += (char)(0x80 | (codepoint & 0x3F));
-			} else {
-				result += (char)(0xF0 | (codepoint >> 18));
-				result += (char)(0x80 | ((codepoint >> 12) & 0x3F));
-				result += (char)(0x80 | ((codepoint >> 6) & 0x3F));
-				result += (char)(0x80 | (codepoint & 0x3F));
-			}
-			i = semi + 1;
-		} else {
-			result += c;
-			++i;
-		}
+	if (result.View() != text) {
+		ReplaceText(textView, selStart, selEnd, result.View());
 	}
 
-	textView->SetText(result.String());
-	SendStatusMessage(
-		B_TRANSLATE("Text HTML-decoded"));
+	BString status;
+	if (appliedToSelection)
+		status.Append(B_TRANSLATE("Selected text HTML-decoded"));
+	else
+		status.Append(B_TRANSLATE("Entire text HTML-decoded"));
+	SendStatusMessage(status);
+	RestoreCursorPosition(textView, result.Length());
 }
 
 
 void
 AddStringsToEachLine(BTextView* textView, const BString& startString, const BString& endString)
 {
-	BString text = GetText(textView, true);
-	int32 lineCount = 0;
-	BString updatedText;
-
-	int32 start = 0;
-	int32 end;
-
-	// Process each line
-	while ((end = text.FindFirst('\n', start)) >= 0) {
-		BString line(text.String() + start, end - start);
-		updatedText << startString << line << endString << '\n';
-		start = end + 1; // Move past the line break
-		lineCount++;
-	}
-
-	// Last line (if it doesn't end with '\n')
-	if (start < text.Length()) {
-		BString line(text.String() + start, text.Length() - start);
-		updatedText << startString << line << endString;
-		lineCount++;
+	std::string_view text = GetTextRange(textView, true);
+	LineRange lines = _GetLines(textView);
+
+	// A line break at the end does not start another line
+	int32 lineCount = lines.CountLines();
+	if (lines.LineAt(lineCount - 1).empty())
+		lineCount--;
+
+	TextBuilder updatedText(
+		text.length() + lineCount * (startString.Length() + endString.Length()));
+	for (int32 i = 0; i < lineCount; i++) {
+		updatedText << startString << lines.LineAt(i) << endString;
+		if (i < lines.CountLines() - 1)
+			updatedText << '\n';
 	}
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, updatedText.String(), updatedText.Length());
+	if (!_IsBuilt(updatedText))
+		return;
+	ReplaceText(textView, selStart, selEnd, updatedText.View());
 	BString status;
 	if (appliedToSelection) {
 		status.SetToFormat(B_TRANSLATE("Prefix/suffix added to %i lines in selection"), lineCount);
@@ -792,45 +720,33 @@ AddStringsToEachLine(BTextView* textView, const BString& startString, const BStr
 void
 RemoveStringsFromEachLine(BTextView* textView, const BString& prefix, const BString& suffix)
 {
-	BString text = GetText(textView, true);
+	std::string_view text = GetTextRange(textView, true);
+	LineRange lines = _GetLines(textView);
 
-	BString updatedText;
-	int32 start = 0;
-	int32 end;
-	int32 lineCount = 0;
+	int32 lineCount = lines.CountLines();
+	if (lines.LineAt(lineCount - 1).empty())
+		lineCount--;
 
-	while ((end = text.FindFirst('\n', start)) >= 0) {
-		BString line(text.String() + start, end - start);
+	TextBuilder updatedText(text.length());
+	for (int32 i = 0; i < lineCount; i++) {
+		std::string_view line = lines.LineAt(i);
 
 		// Remove prefix if present
-		if (!prefix.IsEmpty() && line.StartsWith(prefix))
-			line.Remove(0, prefix.Length());
+		if (!prefix.IsEmpty() && _StartsWith(line, prefix))
+			line.remove_prefix(prefix.Length());
 
 		// Remove suffix if present
-		if (!suffix.IsEmpty() && line.EndsWith(suffix))
-			line.Truncate(line.Length() - suffix.Length());
-
-		updatedText << line << '\n';
-		start = end + 1;
-		lineCount++;
-	}
-
-	// Handle last line if it doesn't end with \n
-	if (start < text.Length()) {
-		BString line(text.String() + start, text.Length() - start);
-
-		if (!prefix.IsEmpty() && line.StartsWith(prefix))
-			line.Remove(0, prefix.Length());
-
-		if (!suffix.IsEmpty() && line.EndsWith(suffix))
-			line.Truncate(line.Length() - suffix.Length());
+		if (!suffix.IsEmpty() && _EndsWith(line, suffix))
+			line.remove_suffix(suffix.Length());
 
 		updatedText << line;
-		lineCount++;
+		if (i < lines.CountLines() - 1)
+			updatedText << '\n';
 	}
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, updatedText.String(), updatedText.Length());
+	if (!_IsBuilt(updatedText))
+		return;
+	ReplaceText(textView, selStart, selEnd, updatedText.View());
 	BString status;
 	if (appliedToSelection) {
 		status.SetToFormat(B_TRANSLATE("Prefix/suffix removed from %i lines in selection"),
@@ -850,7 +766,7 @@ InsertLineBreaks(BTextView* textView, int32 maxLength, bool breakOnWords)
 	bool appliedToSelection = false;
 	BString text = GetText(textView, true);
 
-	BString updatedText;
+	TextBuilder updatedText(text.Length() + text.Length() / std::max(maxLength, (int32)1) + 1);
 
 	int32 lineStart = 0;
 	while (lineStart < text.Length()) {
@@ -883,7 +799,7 @@ InsertLineBreaks(BTextView* textView, int32 maxLength, bool breakOnWords)
 					segmentEnd = pos + maxLength;
 			}
 			updatedText.Append(line.String() + pos, segmentEnd - pos);
-			updatedText.Append("\n");
+			updatedText << '\n';
 
 			if (segmentEnd < line.Length() && line[segmentEnd] == ' ')
 				pos = segmentEnd + 1; // skip space
@@ -893,13 +809,14 @@ InsertLineBreaks(BTextView* textView, int32 maxLength, bool breakOnWords)
 
 		// If line was already short and unbroken, add newline
 		if (line.Length() <= maxLength)
-			updatedText.Append("\n");
+			updatedText << '\n';
 
 		lineStart = lineEnd + 1;
 	}
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, updatedText.String(), updatedText.Length());
+	if (!_IsBuilt(updatedText))
+		return;
+	ReplaceText(textView, selStart, selEnd, updatedText.View());
 
 	BString status;
 	BString breakType
@@ -922,7 +839,8 @@ BreakLinesOnDelimiter(BTextView* textView, const BString& delimiter, bool keepDe
 {
 	BString text = GetText(textView, true);
 
-	BString updatedText;
+	TextBuilder updatedText(
+		text.Length() + text.Length() / std::max(delimiter.Length(), (int32)1));
 
 	int32 start = 0;
 	int32 delimiterPosition;
@@ -936,15 +854,16 @@ BreakLinesOnDelimiter(BTextView* textView, const BString& delimiter, bool keepDe
 			// Exclude the delimiter from the line
 			updatedText.Append(text.String() + start, delimiterPosition - start);
 		}
-		updatedText.Append("\n");
+		updatedText << '\n';
 		start = delimiterPosition + delimiter.Length();
 	}
 
 	if (start < text.Length())
 		updatedText.Append(text.String() + start, text.Length() - start);
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, updatedText.String(), updatedText.Length());
+	if (!_IsBuilt(updatedText))
+		return;
+	ReplaceText(textView, selStart, selEnd, updatedText.View());
 	BString status;
 	BString keepStr = keepDelimiter ? B_TRANSLATE("kept") : B_TRANSLATE("removed");
 
@@ -964,27 +883,26 @@ BreakLinesOnDelimiter(BTextView* textView, const BString& delimiter, bool keepDe
 void
 TrimWhitespace(BTextView* textView)
 {
-	BString text = GetText(textView, true);
-
-	BString updatedText;
-	int32 start = 0;
-	int32 end;
-
-	while ((end = text.FindFirst('\n', start)) >= 0) {
-		BString line(text.String() + start, end - start);
-		line.Trim();
-		updatedText << line << "\n";
-		start = end + 1;
-	}
-
-	if (start < text.Length()) {
-		BString line(text.String() + start, text.Length() - start);
-		line.Trim();
-		updatedText << line << "\n";
+	std::string_view text = GetTextRange(textView, true);
+	LineRange lines = _GetLines(textView);
+
+	int32 lineCount = lines.CountLines();
+	if (lines.LineAt(lineCount - 1).empty())
+		lineCount--;
+
+	TextBuilder updatedText(text.length() + 1);
+	for (int32 i = 0; i < lineCount; i++) {
+		std::string_view line = lines.LineAt(i);
+		while (!line.empty() && isspace((uint8)line.front()))
+			line.remove_prefix(1);
+		while (!line.empty() && isspace((uint8)line.back()))
+			line.remove_suffix(1);
+		updatedText << line << '\n';
 	}
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, updatedText.String(), updatedText.Length());
+	if (!_IsBuilt(updatedText))
+		return;
+	ReplaceText(textView, selStart, selEnd, updatedText.View());
 	BString status;
 	if (appliedToSelection)
 		status.SetToFormat(B_TRANSLATE("Whitespace trimmed from lines in selection"));
@@ -998,36 +916,27 @@ TrimWhitespace(BTextView* textView)
 void
 TrimEmptyLines(BTextView* textView)
 {
-	BString text = GetText(textView, true);
+	std::string_view text = GetTextRange(textView, true);
+	LineRange lines = _GetLines(textView);
 
-	int32 start = 0;
-	int32 end;
 	int32 removedLineCount = 0;
+	TextBuilder updatedText(text.length());
 
-	BString updatedText;
+	for (int32 i = 0; i < lines.CountLines(); i++) {
+		std::string_view line = lines.LineAt(i);
+		bool isLastLine = i == lines.CountLines() - 1;
 
-	while ((end = text.FindFirst('\n', start)) >= 0) {
-		BString line(text.String() + start, end - start);
-
-		if (line.Length() > 0)
-			updatedText << line << '\n';
-		else
-			removedLineCount++;
-
-		start = end + 1;
-	}
-
-	// Handle last line if no '\n'
-	if (start < text.Length()) {
-		BString lastLine(text.String() + start, text.Length() - start);
-		if (lastLine.Length() > 0)
-			updatedText.Append(lastLine);
-		else
+		if (!line.empty()) {
+			updatedText << line;
+			if (!isLastLine)
+				updatedText << '\n';
+		} else if (!isLastLine)
 			removedLineCount++;
 	}
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, updatedText.String(), updatedText.Length());
+	if (!_IsBuilt(updatedText))
+		return;
+	ReplaceText(textView, selStart, selEnd, updatedText.View());
 	BString status;
 	if (appliedToSelection) {
 		status.SetToFormat(B_TRANSLATE("%d empty lines removed from selection"), removedLineCount);
@@ -1040,48 +949,50 @@ TrimEmptyLines(BTextView* textView)
 }
 
 
-bool
-IsFullWord(const BString& text, int32 pos, int32 length)
-{
-	bool startOk = (pos == 0) || !isalnum(text.ByteAt(pos - 1));
-	bool endOk = (pos + length >= text.Length() || !isalnum(text.ByteAt(pos + length)));
-	return startOk && endOk;
-}
-
-
 void
 ReplaceAll(BTextView* textView, BString find, BString replaceWith, bool caseSensitive,
-	bool fullWordsOnly)
+	bool fullWordsOnly, bool useRegex)
 {
-	BString text = GetText(textView, false);
-	int32 replacementCount = 0;
+	std::string_view text = GetTextRange(textView, false);
 
 	if (find.IsEmpty())
 		return;
 
-	int32 pos = 0;
-	int32 findLength = find.Length();
-
-	while (true) {
-		pos = caseSensitive ? text.FindFirst(find.String(), pos)
-							: text.IFindFirst(find.String(), pos);
-
-		if (pos < 0)
-			break;
+	TextBuilder updatedText(text.length());
+	int32 replacementCount = 0;
 
-		if (fullWordsOnly && !IsFullWord(text, pos, findLength)) {
-			pos += findLength;
-			continue;
+	if (useRegex) {
+		BString error;
+		if (RegexReplaceAll(text.data(), text.length(), find, replaceWith, caseSensitive,
+				fullWordsOnly, updatedText, replacementCount, error) != B_OK) {
+			SendStatusMessage(error);
+			return;
 		}
-
-		text.Remove(pos, findLength);
-		text.Insert(replaceWith, pos);
-		pos += replaceWith.Length();
-		replacementCount++;
+	} else {
+		std::vector<TextMatch> matches;
+		replacementCount = FindAllMatches(text.data(), text.length(), find, caseSensitive,
+			fullWordsOnly, matches);
+
+		// Rebuild the text in one pass instead of editing it in place per match
+		size_t matchedLength = 0;
+		for (const TextMatch& match : matches)
+			matchedLength += match.end - match.start;
+		updatedText.Reserve(text.length() - matchedLength + matches.size() * replaceWith.Length());
+		if (!_IsBuilt(updatedText))
+			return;
+
+		int32 last = 0;
+		for (const TextMatch& match : matches) {
+			updatedText.Append(text.data() + last, match.start - last);
+			updatedText << replaceWith;
+			last = match.end;
+		}
+		updatedText.Append(text.data() + last, text.length() - last);
 	}
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, text.String(), text.Length());
+	if (!_IsBuilt(updatedText))
+		return;
+	ReplaceText(textView, selStart, selEnd, updatedText.View());
 	BString status;
 
 	if (appliedToSelection) {
@@ -1093,31 +1004,149 @@ ReplaceAll(BTextView* textView, BString find, BString replaceWith, bool caseSens
 	}
 
 	SendStatusMessage(status);
-	RestoreCursorPosition(textView, text.Length());
+	RestoreCursorPosition(textView, updatedText.Length());
 }
 
 
+static BString
+_UnescapeField(const char* field, int32 length)
+{
+	BString result;
+	for (int32 i = 0; i < length; i++) {
+		if (field[i] == '\\' && i + 1 < length) {
+			char next = field[++i];
+			if (next == 't')
+				result << '\t';
+			else if (next == 'n')
+				result << '\n';
+			else
+				result << next;
+		} else {
+			result << field[i];
+		}
+	}
+	return result;
+}
+
+
+// Applies a table of find/replace pairs in a single pass. Each line of pairs
+// holds one pair, separated by a tab or by " => ". "\t", "\n" and "\\" can be
+// used in either field. When the same search string is listed twice, the
+// last replacement wins.
 void
-SortLines(BTextView* textView, bool ascending, bool caseSensitive)
+BatchReplace(BTextView* textView, const BString& pairs, bool caseSensitive)
 {
-	BString text = GetText(textView, true);
+	std::string_view text = GetTextRange(textView, false);
 
-	// Split text into lines
-	std::vector<BString> lines;
-	int32_t start = 0;
-	while (true) {
-		int32_t end = text.FindFirst('\n', start);
-		BString line;
-		if (end >= 0) {
-			text.CopyInto(line, start, end - start);
-			start = end + 1;
-		} else {
-			text.CopyInto(line, start, text.Length() - start);
-			lines.push_back(line);
-			break;
+	AhoCorasick automaton;
+	std::vector<BString> replacements;
+
+	int32 start = 0;
+	while (start < pairs.Length()) {
+		int32 end = pairs.FindFirst('\n', start);
+		if (end < 0)
+			end = pairs.Length();
+
+		BString line(pairs.String() + start, end - start);
+		start = end + 1;
+		line.RemoveAll("\r");
+
+		int32 separator = line.FindFirst('\t');
+		int32 separatorLength = 1;
+		if (separator < 0) {
+			separator = line.FindFirst(" => ");
+			separatorLength = 4;
+		}
+		if (separator < 0) {
+			separator = line.Length();
+			separatorLength = 0;
+		}
+
+		BString find = _UnescapeField(line.String(), separator);
+		BString replacement = _UnescapeField(line.String() + separator + separatorLength,
+			line.Length() - separator - separatorLength);
+		if (find.IsEmpty())
+			continue;
+
+		FoldedText foldedFind;
+		if (!caseSensitive) {
+			foldedFind.SetTo(find.String(), find.Length());
+			find.SetTo(foldedFind.String(), foldedFind.Length());
 		}
-		lines.push_back(line);
+
+		int32 index = automaton.AddPattern(find.String(), find.Length());
+		if (index == (int32)replacements.size())
+			replacements.push_back(replacement);
+		else
+			replacements[index] = replacement;
+	}
+
+	if (automaton.CountPatterns() == 0) {
+		SendStatusMessage(B_TRANSLATE("No search and replace pairs given"));
+		return;
+	}
+	automaton.Build();
+
+	FoldedText foldedText;
+	const char* haystack = text.data();
+	int32 haystackLength = text.length();
+	if (!caseSensitive) {
+		foldedText.SetTo(text.data(), text.length());
+		haystack = foldedText.String();
+		haystackLength = foldedText.Length();
+	}
+
+	std::vector<PatternMatch> matches;
+	automaton.FindAll(haystack, haystackLength, matches);
+
+	TextBuilder updatedText(text.length());
+	int32 replacementCount = 0;
+	int32 last = 0;
+	for (const PatternMatch& match : matches) {
+		int32 matchStart = match.start;
+		int32 matchEnd = match.end;
+		if (!caseSensitive) {
+			// Skip matches that cover only part of a folded character
+			if (!foldedText.IsCharBoundary(matchStart) || !foldedText.IsCharBoundary(matchEnd))
+				continue;
+			matchStart = foldedText.SourceOffset(matchStart);
+			matchEnd = foldedText.SourceOffset(matchEnd);
+		}
+
+		updatedText.Append(text.data() + last, matchStart - last);
+		updatedText << replacements[match.pattern];
+		last = matchEnd;
+		replacementCount++;
+	}
+	updatedText.Append(text.data() + last, text.length() - last);
+
+	if (!_IsBuilt(updatedText))
+		return;
+	ReplaceText(textView, selStart, selEnd, updatedText.View());
+
+	BString status;
+	if (appliedToSelection) {
+		status.SetToFormat(B_TRANSLATE("%d replacements made from %d pairs in selection"),
+			replacementCount, automaton.CountPatterns());
+	} else {
+		status.SetToFormat(B_TRANSLATE("%d replacements made from %d pairs in entire text"),
+			replacementCount, automaton.CountPatterns());
 	}
+	SendStatusMessage(status);
+	RestoreCursorPosition(textView, updatedText.Length());
+}
+
+
+void
+SortLines(BTextView* textView, bool ascending, bool caseSensitive)
+{
+	std::string_view text = GetTextRange(textView, true);
+
+	// Split text into lines
+	LineRange lineRange = _GetLines(textView);
+	std::vector<std::string_view> lines(lineRange.CountLines());
+	for (int32 i = 0; i < lineRange.CountLines(); i++)
+		lines[i] = lineRange.LineAt(i);
 
 	// Create ICU Collator
 	UErrorCode status = U_ZERO_ERROR;
@@ -1130,9 +1159,11 @@ SortLines(BTextView* textView, bool ascending, bool caseSensitive)
 	);
 
 	// Sort using ICU
-	std::sort(lines.begin(), lines.end(), [&](const BString& a, const BString& b) {
-		icu::UnicodeString ua = icu::UnicodeString::fromUTF8(a.String());
-		icu::UnicodeString ub = icu::UnicodeString::fromUTF8(b.String());
+	std::sort(lines.begin(), lines.end(), [&](std::string_view a, std::string_view b) {
+		icu::UnicodeString ua
+			= icu::UnicodeString::fromUTF8(icu::StringPiece(a.data(), a.length()));
+		icu::UnicodeString ub
+			= icu::UnicodeString::fromUTF8(icu::StringPiece(b.data(), b.length()));
 		UErrorCode cmpStatus = U_ZERO_ERROR;
 		UCollationResult result = collator->compare(ua, ub, cmpStatus);
 		if (U_FAILURE(cmpStatus))
@@ -1142,15 +1173,16 @@ SortLines(BTextView* textView, bool ascending, bool caseSensitive)
 	});
 
 	// Reconstruct the sorted text
-	BString updatedText;
+	TextBuilder updatedText(text.length());
 	for (size_t i = 0; i < lines.size(); ++i) {
 		updatedText << lines[i];
 		if (i != lines.size() - 1)
 			updatedText << '\n';
 	}
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, updatedText.String(), updatedText.Length());
+	if (!_IsBuilt(updatedText))
+		return;
+	ReplaceText(textView, selStart, selEnd, updatedText.View());
 	BString order = ascending ? B_TRANSLATE("ascending") : B_TRANSLATE("descending");
 
 	BString statusMsg;
@@ -1171,36 +1203,27 @@ SortLines(BTextView* textView, bool ascending, bool caseSensitive)
 void
 SortLinesByLength(BTextView* textView, bool ascending, bool caseSensitive)
 {
-	BString text = GetText(textView, true);
+	std::string_view text = GetTextRange(textView, true);
 
 	// Split text into lines
-	std::vector<BString> lines;
-	int32_t start = 0;
-	while (true) {
-		int32_t end = text.FindFirst('\n', start);
-		BString line;
-		if (end >= 0) {
-			text.CopyInto(line, start, end - start);
-			start = end + 1;
-		} else {
-			text.CopyInto(line, start, text.Length() - start);
-			lines.push_back(line);
-			break;
-		}
-		lines.push_back(line);
-	}
+	LineRange lineRange = _GetLines(textView);
+	std::vector<std::string_view> lines(lineRange.CountLines());
+	for (int32 i = 0; i < lineRange.CountLines(); i++)
+		lines[i] = lineRange.LineAt(i);
 
 	// Sort by length, with optional case-aware tiebreaker
-	std::sort(lines.begin(), lines.end(), [&](const BString& a, const BString& b) {
-		int32_t lenA = a.Length();
-		int32_t lenB = b.Length();
+	std::sort(lines.begin(), lines.end(), [&](std::string_view a, std::string_view b) {
+		int32_t lenA = a.length();
+		int32_t lenB = b.length();
 
 		if (lenA != lenB)
 			return ascending ? (lenA < lenB) : (lenA > lenB);
 
 		// Tie-breaker: case-sensitive or insensitive compare
-		icu::UnicodeString ua = icu::UnicodeString::fromUTF8(a.String());
-		icu::UnicodeString ub = icu::UnicodeString::fromUTF8(b.String());
+		icu::UnicodeString ua
+			= icu::UnicodeString::fromUTF8(icu::StringPiece(a.data(), a.length()));
+		icu::UnicodeString ub
+			= icu::UnicodeString::fromUTF8(icu::StringPiece(b.data(), b.length()));
 
 		if (!caseSensitive) {
 			ua.toLower();
@@ -1212,15 +1235,16 @@ SortLinesByLength(BTextView* textView, bool ascending, bool caseSensitive)
 	});
 
 	// Reconstruct sorted text
-	BString updatedText;
+	TextBuilder updatedText(text.length());
 	for (size_t i = 0; i < lines.size(); ++i) {
 		updatedText << lines[i];
 		if (i != lines.size() - 1)
 			updatedText << '\n';
 	}
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, updatedText.String(), updatedText.Length());
+	if (!_IsBuilt(updatedText))
+		return;
+	ReplaceText(textView, selStart, selEnd, updatedText.View());
 	BString order = ascending ? B_TRANSLATE("ascending") : B_TRANSLATE("descending");
 
 	BString statusMsg;
@@ -1241,31 +1265,21 @@ SortLinesByLength(BTextView* textView, bool ascending, bool caseSensitive)
 void
 RemoveDuplicateLines(BTextView* textView, bool caseSensitive)
 {
-	BString text = GetText(textView, true);
+	std::string_view text = GetTextRange(textView, true);
 
 	// Split text into lines
-	std::vector<BString> lines;
-	int32_t start = 0;
-	while (true) {
-		int32_t end = text.FindFirst('\n', start);
-		BString line;
-		if (end >= 0) {
-			text.CopyInto(line, start, end - start);
-			start = end + 1;
-		} else {
-			text.CopyInto(line, start, text.Length() - start);
-			lines.push_back(line);
-			break;
-		}
-		lines.push_back(line);
-	}
+	LineRange lineRange = _GetLines(textView);
+	std::vector<std::string_view> lines(lineRange.CountLines());
+	for (int32 i = 0; i < lineRange.CountLines(); i++)
+		lines[i] = lineRange.LineAt(i);
 
 	// Store seen lines using ICU UnicodeString for proper comparison
 	std::set<icu::UnicodeString> seen;
-	std::vector<BString> uniqueLines;
+	std::vector<std::string_view> uniqueLines;
 
-	for (const BString& line : lines) {
-		icu::UnicodeString uLine = icu::UnicodeString::fromUTF8(line.String());
+	for (std::string_view line : lines) {
+		icu::UnicodeString uLine
+			= icu::UnicodeString::fromUTF8(icu::StringPiece(line.data(), line.length()));
 
 		if (!caseSensitive)
 			uLine.toLower();
@@ -1277,7 +1291,7 @@ RemoveDuplicateLines(BTextView* textView, bool caseSensitive)
 	}
 
 	// Reconstruct unique lines into a single string
-	BString updatedText;
+	TextBuilder updatedText(text.length());
 	for (size_t i = 0; i < uniqueLines.size(); ++i) {
 		updatedText << uniqueLines[i];
 		if (i != uniqueLines.size() - 1)
@@ -1286,8 +1300,9 @@ RemoveDuplicateLines(BTextView* textView, bool caseSensitive)
 
 	int32 linesRemoved = lines.size() - uniqueLines.size();
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, updatedText.String(), updatedText.Length());
+	if (!_IsBuilt(updatedText))
+		return;
+	ReplaceText(textView, selStart, selEnd, updatedText.View());
 	BString statusMsg;
 	if (appliedToSelection) {
 		statusMsg.SetToFormat(B_TRANSLATE("%i duplicated lines removed from selection"),
@@ -1307,11 +1322,16 @@ IndentLines(BTextView* textView, bool useTabs, int32 count)
 	if (count <= 0)
 		return;
 
-	BString text = GetText(textView, true);
+	std::string_view text = GetTextRange(textView, true);
+	LineRange lines = _GetLines(textView);
 
-	BString updatedText;
+	// A line break at the end does not start another line
+	int32 lineCount = lines.CountLines();
+	if (lines.LineAt(lineCount - 1).empty())
+		lineCount--;
+
+	TextBuilder updatedText(text.length() + lineCount * count);
 	BString indent;
-	int32 lineCount = 0;
 
 	// Create the indentation string
 	if (useTabs) {
@@ -1322,25 +1342,15 @@ IndentLines(BTextView* textView, bool useTabs, int32 count)
 			indent << ' ';
 	}
 
-	int32 start = 0;
-	int32 end;
-
-	while ((end = text.FindFirst('\n', start)) >= 0) {
-		BString line(text.String() + start, end - start);
-		updatedText << indent << line << '\n';
-		start = end + 1;
-		lineCount++;
-	}
-
-	// Handle last line if no newline at the end
-	if (start < text.Length()) {
-		BString line(text.String() + start, text.Length() - start);
-		updatedText << indent << line;
-		lineCount++;
+	for (int32 i = 0; i < lineCount; i++) {
+		updatedText << indent << lines.LineAt(i);
+		if (i < lines.CountLines() - 1)
+			updatedText << '\n';
 	}
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, updatedText.String(), updatedText.Length());
+	if (!_IsBuilt(updatedText))
+		return;
+	ReplaceText(textView, selStart, selEnd, updatedText.View());
 	BString statusMsg;
 	BString indentationType = useTabs ? B_TRANSLATE("tabs") : B_TRANSLATE("spaces");
 	if (appliedToSelection) {
@@ -1361,9 +1371,10 @@ UnindentLines(BTextView* textView, bool useTabs, int32 count)
 	if (count <= 0)
 		return;
 
-	BString text = GetText(textView, true);
+	std::string_view text = GetTextRange(textView, true);
+	LineRange lines = _GetLines(textView);
 
-	BString updatedText;
+	TextBuilder updatedText(text.length());
 	BString indent;
 	int32 lineCount = 0;
 
@@ -1376,56 +1387,34 @@ UnindentLines(BTextView* textView, bool useTabs, int32 count)
 			indent << ' ';
 	}
 
-	int32 start = 0;
-	int32 end;
+	int32 lastLine = lines.CountLines() - 1;
+	if (lines.LineAt(lastLine).empty())
+		lastLine--;
 
-	while ((end = text.FindFirst('\n', start)) >= 0) {
-		BString line(text.String() + start, end - start);
+	for (int32 i = 0; i <= lastLine; i++) {
+		std::string_view line = lines.LineAt(i);
 
-		if (line.StartsWith(indent)) {
-			line.Remove(0, indent.Length());
+		if (_StartsWith(line, indent)) {
+			line.remove_prefix(indent.Length());
 			lineCount++;
 		} else {
 			// Try to remove as much as possible
-			int32 i = 0;
-			while (i < count && line.Length() > 0) {
-				if ((useTabs && line.ByteAt(0) == '\t') || (!useTabs && line.ByteAt(0) == ' ')) {
-					line.Remove(0, 1);
-					lineCount++;
-					i++;
-				} else {
-					break;
-				}
+			char indentChar = useTabs ? '\t' : ' ';
+			for (int32 removed = 0; removed < count && !line.empty() && line.front() == indentChar;
+				removed++) {
+				line.remove_prefix(1);
+				lineCount++;
 			}
 		}
 
-		updatedText << line << '\n';
-		start = end + 1;
-	}
-
-	// Handle last line
-	if (start < text.Length()) {
-		BString line(text.String() + start, text.Length() - start);
-		if (line.StartsWith(indent)) {
-			line.Remove(0, indent.Length());
-			lineCount++;
-		} else {
-			int32 i = 0;
-			while (i < count && line.Length() > 0) {
-				if ((useTabs && line.ByteAt(0) == '\t') || (!useTabs && line.ByteAt(0) == ' ')) {
-					line.Remove(0, 1);
-					lineCount++;
-					i++;
-				} else {
-					break;
-				}
-			}
-		}
 		updatedText << line;
+		if (i < lines.CountLines() - 1)
+			updatedText << '\n';
 	}
 
-	textView->Delete(selStart, selEnd);
-	textView->Insert(selStart, updatedText.String(), updatedText.Length());
+	if (!_IsBuilt(updatedText))
+		return;
+	ReplaceText(textView, selStart, selEnd, updatedText.View());
 	BString statusMsg;
 	BString indentationType = useTabs ? B_TRANSLATE("tabs") : B_TRANSLATE("spaces");
 	if (appliedToSelection) {
@@ -1440,101 +1429,131 @@ UnindentLines(BTextView* textView, bool useTabs, int32 count)
 }
 
 
-void
-ShowTextStats(BTextView* textView)
+// Checks a file for binary data, up to scanLength bytes or all of it if that
+// is negative. Text in a legacy encoding or in UTF-16 counts as text too, the
+// loader converts it, and so does compressed text.
+bool
+IsProbablyText(BFile& file, off_t scanLength)
 {
-	BString text = GetText(textView, false);
-	if (text.IsEmpty()) {
-		SendStatusMessage(B_TRANSLATE("No text selected"));
-		return;
-	}
+	const size_t kBlockSize = 64 * 1024;
+	std::unique_ptr<char[]> buffer(new(std::nothrow) char[kBlockSize]);
+	if (!buffer || file.Seek(0, SEEK_SET) != 0)
+		return false;
+
+	DecompressingIO input(&file);
+	TextScanner scanner;
+	off_t offset = 0;
+	size_t length = 0;
+	for (;;) {
+		size_t wanted = kBlockSize - length;
+		if (scanLength >= 0)
+			wanted = std::min(wanted, (size_t)(scanLength - offset));
+		ssize_t bytesRead = wanted > 0 ? input.Read(buffer.get() + length, wanted) : 0;
+		if (bytesRead < 0)
+			return false;
+		if (offset == 0 && (DetectByteOrderMark(buffer.get(), bytesRead) > 0
+				|| DetectUTF16(buffer.get(), bytesRead))) {
+			return true;
+		}
 
-	icu::UnicodeString unicodeText = icu::UnicodeString::fromUTF8(text.String());
-	BString statsMsg;
+		offset += bytesRead;
+		length += bytesRead;
+		if (bytesRead == 0) {
+			scanner.Add(buffer.get(), length);
+			break;
+		}
 
-	int32 charCount = unicodeText.countChar32();
-	int32 lineCount = CountLines(text);
-	int32 maxLineLength = 0;
-	int32 totalWordLength = 0;
-	int32 wordCount = CountWords(text);
-	int32 sentenceCount = CountSentences(text);
-
-	std::map<std::string, int> wordFrequency;
-
-	// Max line length
-	int32 start = 0, end;
-	while ((end = text.FindFirst('\n', start)) >= 0) {
-		int32 lineLen = end - start;
-		if (lineLen > maxLineLength)
-			maxLineLength = lineLen;
-		start = end + 1;
-	}
-	if (start < text.Length()) {
-		int32 lineLen = text.Length() - start;
-		if (lineLen > maxLineLength)
-			maxLineLength = lineLen;
+		// Keep the last character, which may be incomplete, for the next block
+		size_t end = CharacterBoundary(buffer.get(), length, length - 1);
+		scanner.Add(buffer.get(), end);
+		memmove(buffer.get(), buffer.get() + end, length - end);
+		length -= end;
 	}
 
+	return !scanner.Result().IsBinary();
+}
 
-	// ICU word iterator
-	UErrorCode status = U_ZERO_ERROR;
-	std::unique_ptr<icu::BreakIterator> wordIter(
-		icu::BreakIterator::createWordInstance(icu::Locale::getDefault(), status));
-	wordIter->setText(unicodeText);
-
-	int32_t startWord = wordIter->first();
-	for (int32_t endWord = wordIter->next(); endWord != icu::BreakIterator::DONE;
-		startWord = endWord, endWord = wordIter->next()) {
-		icu::UnicodeString word = unicodeText.tempSubStringBetween(startWord, endWord);
-		if (word.trim().isEmpty())
-			continue;
-		if (word.char32At(0) >= 0x30 && u_isalnum(word.char32At(0))) {
-			totalWordLength += word.countChar32();
-			word.toLower();
-			std::string utf8;
-			word.toUTF8String(utf8);
-			if (utf8.length() > 2)
-				wordFrequency[utf8]++;
-		}
+
+// Keeps the word list in wordList when it is to be exported, so the export has
+// the words counted here, whatever the selection is by then.
+void
+ShowTextStats(BTextView* textView, WordFrequency& wordList, int32 topWordCount)
+{
+	std::string_view text = GetTextRange(textView, false);
+	if (text.empty()) {
+		SendStatusMessage(B_TRANSLATE("No text selected"));
+		return;
 	}
 
-	// Most common words
-	std::vector<std::pair<BString, int>> sortedWords;
-	for (const auto& entry : wordFrequency)
-		sortedWords.emplace_back(BString(entry.first.c_str()), entry.second);
-	std::sort(sortedWords.begin(), sortedWords.end(), [](const auto& a, const auto& b) {
-		if (a.second != b.second)
-			return a.second > b.second; // Highest frequency first
-		return a.first.ICompare(b.first) < 0; // Alphabetical for tie-breaking
-	});
+	TextStatistics stats;
+	if (CountTextStatistics(text.data(), text.length(), stats) != B_OK) {
+		SendStatusMessage(B_TRANSLATE("Could not count text statistics"));
+		return;
+	}
+	BString statsMsg;
 
+	// Most common words
+	std::vector<WordCount> topWords;
+	stats.wordFrequency.GetTopWords(std::max(topWordCount, (int32)0), topWords);
 
 	statsMsg.SetToFormat(B_TRANSLATE("STATISTICS FOR CURRENT TEXT\n\n"
-									 "Characters: %d\n"
-									 "Words: %d\n"
-									 "Lines: %d\n"
-									 "Sentences: %d\n"
-									 "Longest line: %d chars\n"
+									 "Characters: %" B_PRId64 "\n"
+									 "Words: %" B_PRId64 "\n"
+									 "Lines: %" B_PRId64 "\n"
+									 "Sentences: %" B_PRId64 "\n"
+									 "Longest line: %" B_PRId64 " chars\n"
 									 "Average word length: %.2f\n\n"
 									 "Most used words:\n"),
-		charCount, wordCount, lineCount, sentenceCount, maxLineLength,
-		wordCount > 0 ? (float)totalWordLength / wordCount : 0.0);
+		stats.characters, stats.words, stats.lines, stats.sentences, stats.longestLine,
+		stats.words > 0 ? (float)stats.wordCharacters / stats.words : 0.0);
 
-	int shown = 0;
-	for (const auto& [word, freq] : sortedWords) {
-		statsMsg << "  " << word << ": " << freq << '\n';
-		if (++shown == 10)
-			break;
+	for (const WordCount& word : topWords) {
+		statsMsg << "  ";
+		statsMsg.Append(word.word.data(), word.word.length());
+		statsMsg << ": " << word.count << '\n';
+	}
+
+	BAlert* alert = new BAlert("Stats", statsMsg.String(),
+		B_TRANSLATE("Export word list" B_UTF8_ELLIPSIS), B_TRANSLATE("OK"), NULL,
+		B_WIDTH_AS_USUAL, B_IDEA_ALERT);
+	alert->SetShortcut(1, B_ESCAPE);
+	if (alert->Go() == 0 && textView->Window() != NULL) {
+		wordList = std::move(stats.wordFrequency);
+		textView->Window()->PostMessage(M_EXPORT_WORD_FREQUENCY);
 	}
-	(new BAlert("Stats", statsMsg.String(), B_TRANSLATE("OK"), NULL, NULL, B_WIDTH_AS_USUAL,
-		 B_IDEA_ALERT))
-		->Go();
+}
+
+
+void
+ExportWordFrequency(const WordFrequency& wordList, const char* path)
+{
+	BFile file;
+	status_t status = file.SetTo(path, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	if (status == B_OK)
+		status = WriteWordFrequencyCSV(wordList, &file);
+	if (status != B_OK) {
+		SendStatusMessage(B_TRANSLATE("Could not write the word list"));
+		return;
+	}
+
+	BNodeInfo nodeInfo(&file);
+	nodeInfo.SetType("text/csv");
+
+	BString statusMsg;
+	statusMsg.SetToFormat(B_TRANSLATE("Exported %" B_PRId32 " words to the word list"),
+		wordList.CountWords());
+	SendStatusMessage(statusMsg);
 }
 
 
 void
 SendStatusMessage(const BString& text)
 {
+	if (sStatusCapture != nullptr) {
+		*sStatusCapture = text;
+		return;
+	}
+
 	BWindow* window = be_app->WindowAt(0);
 	if (window) {
 		BMessage msg(M_SHOW_STATUS);
@@ -1546,11 +1565,18 @@ SendStatusMessage(const BString& text)
 }
 
 
+void
+SetStatusMessageCapture(BString* capture)
+{
+	sStatusCapture = capture;
+}
+
+
 int32
-_CountCharChanges(const BString& original, const BString& transformed)
+_CountCharChanges(std::string_view original, std::string_view transformed)
 {
 	int32 count = 0;
-	int32 len = MIN(original.Length(), transformed.Length());
+	int32 len = std::min(original.length(), transformed.length());
 
 	for (int32 i = 0; i < len; i++) {
 		if (original[i] != transformed[i])
@@ -1584,31 +1610,7 @@ CountLines(const BString& text)
 int32
 CountWords(const BString& text)
 {
-	UErrorCode status = U_ZERO_ERROR;
-	icu::UnicodeString utext(text.String());
-
-	std::unique_ptr<icu::BreakIterator> bi(
-		icu::BreakIterator::createWordInstance(icu::Locale::getDefault(), status));
-
-	if (U_FAILURE(status) || !bi)
-		return 0;
-
-	bi->setText(utext);
-
-	int32_t count = 0;
-	for (int32_t start = bi->first(), end = bi->next(); end != icu::BreakIterator::DONE;
-		start = end, end = bi->next()) {
-
-		// Check if the boundary is a word (letters or numbers)
-		icu::UnicodeString word = utext.tempSubStringBetween(start, end);
-		if (word.trim().length() > 0
-			&& u_getIntPropertyValue(word.char32At(0), UCHAR_GENERAL_CATEGORY)
-				!= U_SPACE_SEPARATOR) {
-			count++;
-		}
-	}
-
-	return count;
+	return CountTextWords(text.String(), text.Length());
 }
 
 
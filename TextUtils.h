@@ -6,80 +6,14 @@
 #ifndef TEXT_UTILS_H
 #define TEXT_UTILS_H
 
-#include <TextView.h>
-
-struct HtmlEntity {
-	const char* name;
-	uint32 codepoint;
-};
+#include "TextCodecs.h"
 
-static const HtmlEntity kEntities[] = {
-	// Most common
-		{ "amp",   '&'  },
-		{ "lt",    '<'  },
-		{ "gt",    '>'  },
-		{ "quot",  '"'  },
-		{ "apos",  '\'' },
-		// Extended
-		{ "nbsp",   160 },
-		{ "iexcl",  161 },
-		{ "cent",   162 },
-		{ "pound",  163 },
-		{ "curren", 164 },
-		{ "yen",    165 },
-		{ "brvbar", 166 },
-		{ "sect",   167 },
-		{ "uml",    168 },
-		{ "copy",   169 },
-		{ "ordf",   170 },
-		{ "laquo",  171 },
-		{ "not",    172 },
-		{ "shy",    173 },
-		{ "reg",    174 },
-		{ "macr",   175 },
-		{ "deg",    176 },
-		{ "plusmn", 177 },
-		{ "sup2",   178 },
-		{ "sup3",   179 },
-		{ "acute",  180 },
-		{ "micro",  181 },
-		{ "para",   182 },
-		{ "middot", 183 },
-		{ "cedil",  184 },
-		{ "sup1",   185 },
-		{ "ordm",   186 },
-		{ "raquo",  187 },
-		{ "frac14", 188 },
-		{ "frac12", 189 },
-		{ "frac34", 190 },
-		{ "iquest", 191 },
-		{ "Agrave", 192 }, { "Aacute", 193 }, { "Acirc",  194 },
-		{ "Atilde", 195 }, { "Auml",   196 }, { "Aring",  197 },
-		{ "AElig",  198 }, { "Ccedil", 199 }, { "Egrave", 200 },
-		{ "Eacute", 201 }, { "Ecirc",  202 }, { "Euml",   203 },
-		{ "Igrave", 204 }, { "Iacute", 205 }, { "Icirc",  206 },
-		{ "Iuml",   207 }, { "ETH",    208 }, { "Ntilde", 209 },
-		{ "Ograve", 210 }, { "Oacute", 211 }, { "Ocirc",  212 },
-		{ "Otilde", 213 }, { "Ouml",   214 }, { "times",  215 },
-		{ "Oslash", 216 }, { "Ugrave", 217 }, { "Uacute", 218 },
-		{ "Ucirc",  219 }, { "Uuml",   220 }, { "Yacute", 221 },
-		{ "THORN",  222 }, { "szlig",  223 },
-		{ "agrave", 224 }, { "aacute", 225 }, { "acirc",  226 },
-		{ "atilde", 227 }, { "auml",   228 }, { "aring",  229 },
-		{ "aelig",  230 }, { "ccedil", 231 }, { "egrave", 232 },
-		{ "eacute", 233 }, { "ecirc",  234 }, { "euml",   235 },
-		{ "igrave", 236 }, { "iacute", 237 }, { "icirc",  238 },
-		{ "iuml",   239 }, { "eth",    240 }, { "ntilde", 241 },
-		{ "ograve", 242 }, { "oacute", 243 }, { "ocirc",  244 },
-		{ "otilde", 245 }, { "ouml",   246 }, { "divide", 247 },
-		{ "oslash", 248 }, { "ugrave", 249 }, { "uacute", 250 },
-		{ "ucirc",  251 }, { "uuml",   252 }, { "yacute", 253 },
-		{ "thorn",  254 }, { "yuml",   255 },
-};
+#include <TextView.h>
+#include <string_view>
 
-static const int32 kEntityCount =
-	(int32)(sizeof(kEntities) / sizeof(kEntities[0]));
+class WordFrequency;
 
+std::string_view GetTextRange(BTextView* textView, bool isLineBased);
 BString GetText(BTextView* textView, bool isLineBased);
 void SaveCursorPosition(BTextView* textView);
 void RestoreCursorPosition(BTextView* textView);
@@ -101,11 +35,12 @@ void TrimWhitespace(BTextView* textView);
 void TrimEmptyLines(BTextView* textView);
 void RemoveDuplicateLines(BTextView* textView, bool caseSensitive = true);
 void ReplaceAll(BTextView* textView, BString find, BString replaceWith, bool caseSensitive,
-	bool fullWordsOnly);
+	bool fullWordsOnly, bool useRegex = false);
+void BatchReplace(BTextView* textView, const BString& pairs, bool caseSensitive);
 
-void URLEncode(BTextView* textView);
-void URLDecode(BTextView* textView);
-void Base64(BTextView* textView);
+void URLEncode(BTextView* textView, UrlEncodeSet set = URL_ENCODE_COMPONENT);
+void URLDecode(BTextView* textView, UrlEncodeSet set = URL_ENCODE_COMPONENT);
+void Base64(BTextView* textView, Base64Variant variant = BASE64_STANDARD);
 void EncodeHTMLEntities(BTextView* textView, bool encodeByName);
 void DecodeHTMLEntities(BTextView* textView);
 void ConvertToROT13(BTextView* textView);
@@ -116,13 +51,15 @@ void RemoveStringsFromEachLine(BTextView* textView, const BString& startString,
 void IndentLines(BTextView* textView, bool useTabs = true, int32 count = 1);
 void UnindentLines(BTextView* textView, bool useTabs = true, int32 count = 1);
 
-bool IsProbablyText(BFile& file);
-void ShowTextStats(BTextView* textView);
+bool IsProbablyText(BFile& file, off_t scanLength = 1024 * 1024);
+void ShowTextStats(BTextView* textView, WordFrequency& wordList, int32 topWordCount = 10);
+void ExportWordFrequency(const WordFrequency& wordList, const char* path);
 
 void SortLines(BTextView* textView, bool ascending = true, bool caseSensitive = true);
 void SortLinesByLength(BTextView* textView, bool ascending = true, bool caseSensitive = true);
 void SendStatusMessage(const BString& text);
-int32 _CountCharChanges(const BString& original, const BString& transformed);
+void SetStatusMessageCapture(BString* capture);
+int32 _CountCharChanges(std::string_view original, std::string_view transformed);
 int32 CountLines(const BString& text);
 int32 CountWords(const BString& text);
 int32 CountSentences(const BString& text);
@@ -5,13 +5,280 @@
 
 #include "UndoableTextView.h"
 #include "Constants.h"
+#include "SessionJournal.h"
 #include <Application.h>
+#include <Autolock.h>
+#include <Locker.h>
 #include <Message.h>
 #include <Messenger.h>
+#include <OS.h>
 #include <Region.h>
 #include <Window.h>
 
-enum { M_COALESCE_TIMEOUT = '_cut' };
+#include <algorithm>
+#include <memory>
+
+enum {
+	M_COALESCE_TIMEOUT = '_cut',
+	M_MATCHES_INDEXED = '_mix'
+};
+
+struct MatchIndexerData {
+	BString find;
+	bool caseSensitive;
+	bool fullWordsOnly;
+	int32 generation;
+	int32 request;
+};
+
+static const rgb_color kMatchHighlightColor = { 255, 214, 0, 255 };
+
+// The indexer looks for a newer request after each chunk of text
+static const int32 kIndexChunkSize = 1024 * 1024;
+
+// Edits made while indexing are applied to the index when it arrives. After
+// more than these, the text is indexed again instead.
+static const size_t kMaxIndexEdits = 256;
+
+static const bigtime_t kIndexSendTimeout = 1000000;
+
+// How long the indexer waits for the window at a time before it looks for a
+// newer request
+static const bigtime_t kIndexLockTimeout = 50000;
+
+// Edits that insert more than this are left to the indexer, rather than
+// searched on the window thread
+static const int32 kMaxPatchLength = 4096;
+
+
+// Builds match indexes on a thread of its own. Only the newest request counts:
+// it replaces the one still waiting, and stops the one running after its
+// current chunk of text.
+class MatchIndexer {
+public:
+	MatchIndexer(UndoableTextView* view);
+	~MatchIndexer();
+
+	status_t InitCheck() const { return fThread >= B_OK ? B_OK : fThread; }
+
+	// Takes over the data
+	void Request(MatchIndexerData* data);
+	void Cancel();
+
+private:
+	static status_t _Thread(void* data);
+	bool _CopyText(const MatchIndexerData& data, BString& text, int32& changeCount);
+	bool _Index(const MatchIndexerData& data, const BString& text,
+		std::vector<TextMatch>& matches);
+
+	UndoableTextView* fView;
+	BMessenger fTarget;
+	BLocker fLock;
+	MatchIndexerData* fPending;
+	sem_id fSemaphore;
+	thread_id fThread;
+	int32 fRequest;
+	bool fQuitting;
+};
+
+
+MatchIndexer::MatchIndexer(UndoableTextView* view)
+	:
+	fView(view),
+	fTarget(view),
+	fLock("match indexer"),
+	fPending(nullptr),
+	fSemaphore(create_sem(0, "match indexer")),
+	fThread(-1),
+	fRequest(0),
+	fQuitting(false)
+{
+	if (fSemaphore < B_OK) {
+		fThread = fSemaphore;
+		return;
+	}
+
+	fThread = spawn_thread(_Thread, "match indexer", B_LOW_PRIORITY, this);
+	if (fThread >= B_OK && resume_thread(fThread) != B_OK) {
+		kill_thread(fThread);
+		fThread = B_ERROR;
+	}
+}
+
+
+MatchIndexer::~MatchIndexer()
+{
+	if (fThread >= B_OK) {
+		fLock.Lock();
+		fQuitting = true;
+		atomic_add(&fRequest, 1);
+		fLock.Unlock();
+		release_sem(fSemaphore);
+
+		status_t result;
+		wait_for_thread(fThread, &result);
+	}
+
+	if (fSemaphore >= B_OK)
+		delete_sem(fSemaphore);
+	delete fPending;
+}
+
+
+void
+MatchIndexer::Request(MatchIndexerData* data)
+{
+	BAutolock _(fLock);
+	delete fPending;
+	fPending = data;
+	fPending->request = atomic_add(&fRequest, 1) + 1;
+	release_sem(fSemaphore);
+}
+
+
+void
+MatchIndexer::Cancel()
+{
+	BAutolock _(fLock);
+	delete fPending;
+	fPending = nullptr;
+	atomic_add(&fRequest, 1);
+}
+
+
+status_t
+MatchIndexer::_Thread(void* _indexer)
+{
+	MatchIndexer* indexer = (MatchIndexer*)_indexer;
+
+	for (;;) {
+		status_t status = acquire_sem(indexer->fSemaphore);
+		if (status == B_INTERRUPTED)
+			continue;
+		if (status != B_OK)
+			break;
+
+		indexer->fLock.Lock();
+		bool quitting = indexer->fQuitting;
+		std::unique_ptr<MatchIndexerData> data(indexer->fPending);
+		indexer->fPending = nullptr;
+		indexer->fLock.Unlock();
+
+		if (quitting)
+			break;
+		if (!data)
+			continue;
+
+		BString text;
+		int32 changeCount;
+		if (!indexer->_CopyText(*data, text, changeCount))
+			continue;
+
+		std::vector<TextMatch>* matches = new std::vector<TextMatch>;
+		if (!indexer->_Index(*data, text, *matches)) {
+			delete matches;
+			continue;
+		}
+
+		BMessage message(M_MATCHES_INDEXED);
+		message.AddPointer("matches", matches);
+		message.AddInt32("generation", data->generation);
+		message.AddInt32("change count", changeCount);
+		if (indexer->fTarget.SendMessage(&message, (BHandler*)nullptr, kIndexSendTimeout)
+				!= B_OK) {
+			delete matches;
+		}
+	}
+
+	return B_OK;
+}
+
+
+// Copies the text on the indexer thread, with the window locked so that it
+// cannot change meanwhile. The change count tells which edits came after.
+bool
+MatchIndexer::_CopyText(const MatchIndexerData& data, BString& text, int32& changeCount)
+{
+	for (;;) {
+		status_t status = fTarget.LockTargetWithTimeout(kIndexLockTimeout);
+		if (status == B_OK)
+			break;
+		if (status != B_TIMED_OUT || atomic_get(&fRequest) != data.request)
+			return false;
+	}
+	if (atomic_get(&fRequest) != data.request) {
+		fView->Looper()->Unlock();
+		return false;
+	}
+
+	bool copied = true;
+	int32 length = fView->TextLength();
+	if (length > 0) {
+		char* buffer = text.LockBuffer(length);
+		copied = buffer != nullptr;
+		if (copied) {
+			// Unlike Text(), GetText() leaves the text buffer alone
+			fView->GetText(0, length, buffer);
+			text.UnlockBuffer(length);
+		}
+	}
+	changeCount = fView->ChangeCount();
+	fView->Looper()->Unlock();
+
+	return copied;
+}
+
+
+// Searches the text a chunk at a time, and gives up as soon as there is a
+// newer request.
+bool
+MatchIndexer::_Index(const MatchIndexerData& data, const BString& _text,
+	std::vector<TextMatch>& matches)
+{
+	const char* text = _text.String();
+	int32 length = _text.Length();
+
+	// A match may reach past the end of its chunk, by more than the length of
+	// the search term when case folding changes byte lengths
+	int32 overlap = data.find.Length() * 4 + 4;
+
+	std::vector<TextMatch> found;
+	int32 start = 0;
+	while (start < length) {
+		if (atomic_get(&fRequest) != data.request)
+			return false;
+
+		// Chunks start and end where a character does
+		int32 end = length - start > kIndexChunkSize ? start + kIndexChunkSize : length;
+		while (end < length && (text[end] & 0xc0) == 0x80)
+			end++;
+		int32 searchEnd = length - end > overlap ? end + overlap : length;
+		while (searchEnd < length && (text[searchEnd] & 0xc0) == 0x80)
+			searchEnd++;
+
+		FindAllMatches(text + start, searchEnd - start, data.find, data.caseSensitive, false,
+			found);
+
+		// Matches starting in the next chunk are found there; matches do not
+		// overlap, so the next chunk starts behind the last one found here
+		int32 next = end;
+		for (TextMatch match : found) {
+			if (match.start >= end - start)
+				break;
+
+			match.start += start;
+			match.end += start;
+			next = std::max(next, match.end);
+			if (data.fullWordsOnly && !IsFullWord(text, length, match.start, match.end))
+				continue;
+
+			matches.push_back(match);
+		}
+		start = next;
+	}
+
+	return atomic_get(&fRequest) == data.request;
+}
 
 
 UndoableTextView::UndoableTextView(const char* name)
@@ -19,9 +286,19 @@ UndoableTextView::UndoableTextView(const char* name)
 	BTextView(name, B_WILL_DRAW | B_SCROLL_VIEW_AWARE),
 	fCoalescing(false),
 	fRecording(true),
+	fGroupDepth(0),
+	fGroupStarted(false),
 	fHasFocus(false),
 	fSavedSelectionStart(0),
-	fSavedSelectionEnd(0)
+	fSavedSelectionEnd(0),
+	fSearchCaseSensitive(false),
+	fSearchFullWords(false),
+	fSearchGeneration(0),
+	fMatchIndexer(nullptr),
+	fIndexing(false),
+	fChangeCount(0),
+	fLineIndexChangeCount(-1),
+	fJournal(nullptr)
 {
 	rgb_color viewColor = ui_color(B_DOCUMENT_BACKGROUND_COLOR);
 	rgb_color textColor = ui_color(B_DOCUMENT_TEXT_COLOR);
@@ -35,6 +312,7 @@ UndoableTextView::UndoableTextView(const char* name)
 
 UndoableTextView::~UndoableTextView()
 {
+	delete fMatchIndexer;
 }
 
 
@@ -78,6 +356,9 @@ UndoableTextView::Draw(BRect updateRect)
 {
 	BTextView::Draw(updateRect);
 
+	if (!fMatches.empty())
+		_DrawMatches(updateRect);
+
 	if (fHasFocus)
 		return;
 
@@ -118,22 +399,30 @@ void
 UndoableTextView::InsertText(const char* text, int32 length, int32 offset,
 	const text_run_array* runs)
 {
-	if (fRecording && !fCoalescing)
-		PushUndoSnapshot();
+	if (fRecording)
+		_RecordEdit(offset, nullptr, 0, text, length);
 
-	StartCoalesceTimer();
 	BTextView::InsertText(text, length, offset, runs);
+	if (fJournal != nullptr)
+		fJournal->Insert(offset, text, length);
+
+	fChangeCount++;
+	_PatchMatches(offset, 0, length);
 }
 
 
 void
 UndoableTextView::DeleteText(int32 start, int32 finish)
 {
-	if (fRecording && !fCoalescing)
-		PushUndoSnapshot();
+	if (fRecording)
+		_RecordEdit(start, Text() + start, finish - start, nullptr, 0);
 
-	StartCoalesceTimer();
 	BTextView::DeleteText(start, finish);
+	if (fJournal != nullptr)
+		fJournal->Delete(start, finish);
+
+	fChangeCount++;
+	_PatchMatches(start, finish - start, 0);
 }
 
 
@@ -156,12 +445,30 @@ UndoableTextView::MouseDown(BPoint point)
 void
 UndoableTextView::SetTextWithUndo(const BString& newText)
 {
-	fRecording = false;
-	PushUndoSnapshot();
+	BeginUndoGroup();
 	SetText(newText.String());
 	Select(0, 0);
+	EndUndoGroup();
+}
+
+
+// Replaces the document, as when opening a file. Neither the old nor the new
+// text is copied into the undo history, which starts out empty, and the
+// journal starts over from the new text.
+void
+UndoableTextView::LoadText(const char* text, int32 length, const text_run_array* runs)
+{
 	StopCoalesceTimer();
+	fRecording = false;
+	SessionJournal* journal = fJournal;
+	fJournal = nullptr;
+	SetText(text, length, runs);
+	fJournal = journal;
 	fRecording = true;
+	ClearHistory();
+
+	if (fJournal != nullptr)
+		fJournal->Reset(Text(), TextLength());
 }
 
 
@@ -171,17 +478,13 @@ UndoableTextView::Undo()
 	if (fUndoStack.empty())
 		return;
 
-	TextSnapshot current;
-	current.text = Text();
-	GetSelection(&current.selectionStart, &current.selectionEnd);
-	fRedoStack.push(current);
+	UndoGroup group = std::move(fUndoStack.back());
+	fUndoStack.pop_back();
+	GetSelection(&group.redoSelectionStart, &group.redoSelectionEnd);
 
-	const TextSnapshot& snapshot = fUndoStack.top();
-	fRecording = false;
-	SetText(snapshot.text.String());
-	Select(snapshot.selectionStart, snapshot.selectionEnd);
-	fUndoStack.pop();
-	fRecording = true;
+	_ApplyGroup(group, true);
+	Select(group.selectionStart, group.selectionEnd);
+	fRedoStack.push_back(std::move(group));
 }
 
 
@@ -191,51 +494,123 @@ UndoableTextView::Redo()
 	if (fRedoStack.empty())
 		return;
 
-	TextSnapshot current;
-	current.text = Text();
-	GetSelection(&current.selectionStart, &current.selectionEnd);
-	fUndoStack.push(current);
+	UndoGroup group = std::move(fRedoStack.back());
+	fRedoStack.pop_back();
 
-	const TextSnapshot& snapshot = fRedoStack.top();
-	fRecording = false;
-	SetText(snapshot.text.String());
-	Select(snapshot.selectionStart, snapshot.selectionEnd);
-	fRedoStack.pop();
-	fRecording = true;
+	_ApplyGroup(group, false);
+	Select(group.redoSelectionStart, group.redoSelectionEnd);
+	fUndoStack.push_back(std::move(group));
 }
 
 
 void
 UndoableTextView::ClearHistory()
 {
-	while (!fUndoStack.empty()) fUndoStack.pop();
-	while (!fRedoStack.empty()) fRedoStack.pop();
+	fUndoStack.clear();
+	fRedoStack.clear();
+	StopCoalesceTimer();
+}
+
+
+// Edits between BeginUndoGroup() and EndUndoGroup() are undone as one step.
+// Groups may be nested, only the outermost one counts.
+void
+UndoableTextView::BeginUndoGroup()
+{
+	if (fGroupDepth++ == 0) {
+		fGroupStarted = false;
+		StopCoalesceTimer();
+	}
 }
 
 
 void
-UndoableTextView::PushUndoSnapshot()
+UndoableTextView::EndUndoGroup()
 {
-	TextSnapshot snapshot;
-	snapshot.text = Text();
+	if (fGroupDepth > 0)
+		fGroupDepth--;
+}
 
-	int32 selStart, selEnd;
-	GetSelection(&selStart, &selEnd);
-	snapshot.selectionStart = selStart;
-	snapshot.selectionEnd = selEnd;
 
-	// Avoid duplicate snapshots
-	if (!fUndoStack.empty() && fUndoStack.top().text == snapshot.text)
+// Records an edit as the delta it makes, so the history grows with the size of
+// the changes and not with the size of the text. Typing and deleting at one
+// place are merged into a single edit.
+void
+UndoableTextView::_RecordEdit(int32 offset, const char* removed, int32 removedLength,
+	const char* inserted, int32 insertedLength)
+{
+	if (removedLength <= 0 && insertedLength <= 0)
 		return;
 
-	fUndoStack.push(snapshot);
+	bool newGroup = fGroupDepth > 0 ? !fGroupStarted : !fCoalescing;
+	if (newGroup || fUndoStack.empty()) {
+		UndoGroup group;
+		GetSelection(&group.selectionStart, &group.selectionEnd);
+		group.redoSelectionStart = group.selectionStart;
+		group.redoSelectionEnd = group.selectionEnd;
+		fUndoStack.push_back(std::move(group));
+
+		if (fUndoStack.size() > kMaxUndoSteps)
+			fUndoStack.pop_front();
+		fRedoStack.clear();
+	}
 
-	// Trim stack
-	if (fUndoStack.size() > kMaxUndoSteps)
-		fUndoStack.pop();
+	if (fGroupDepth > 0)
+		fGroupStarted = true;
+	else
+		StartCoalesceTimer();
+
+	std::vector<TextEdit>& edits = fUndoStack.back().edits;
+	if (!edits.empty()) {
+		TextEdit& last = edits.back();
+		if (removedLength <= 0 && offset == last.offset + last.inserted.Length()) {
+			last.inserted.Append(inserted, insertedLength);
+			return;
+		}
+		if (insertedLength <= 0 && last.inserted.IsEmpty()) {
+			if (offset == last.offset) {
+				last.removed.Append(removed, removedLength);
+				return;
+			}
+			if (offset + removedLength == last.offset) {
+				last.removed.Prepend(removed, removedLength);
+				last.offset = offset;
+				return;
+			}
+		}
+	}
 
-	while (!fRedoStack.empty())
-		fRedoStack.pop();
+	TextEdit edit;
+	edit.offset = offset;
+	edit.removed.SetTo(removed, std::max(removedLength, (int32)0));
+	edit.inserted.SetTo(inserted, std::max(insertedLength, (int32)0));
+	edits.push_back(std::move(edit));
+}
+
+
+void
+UndoableTextView::_ApplyGroup(const UndoGroup& group, bool undo)
+{
+	StopCoalesceTimer();
+	fRecording = false;
+
+	if (undo) {
+		for (auto it = group.edits.rbegin(); it != group.edits.rend(); ++it) {
+			if (!it->inserted.IsEmpty())
+				Delete(it->offset, it->offset + it->inserted.Length());
+			if (!it->removed.IsEmpty())
+				Insert(it->offset, it->removed.String(), it->removed.Length());
+		}
+	} else {
+		for (const TextEdit& edit : group.edits) {
+			if (!edit.removed.IsEmpty())
+				Delete(edit.offset, edit.offset + edit.removed.Length());
+			if (!edit.inserted.IsEmpty())
+				Insert(edit.offset, edit.inserted.String(), edit.inserted.Length());
+		}
+	}
+
+	fRecording = true;
 }
 
 
@@ -272,6 +647,31 @@ UndoableTextView::MessageReceived(BMessage* msg)
 		case M_COALESCE_TIMEOUT:
 			StopCoalesceTimer();
 			break;
+		case M_MATCHES_INDEXED:
+		{
+			std::vector<TextMatch>* matches = nullptr;
+			int32 generation;
+			int32 changeCount;
+			if (msg->FindPointer("matches", (void**)&matches) != B_OK)
+				break;
+			std::unique_ptr<std::vector<TextMatch>> owner(matches);
+
+			if (msg->FindInt32("generation", &generation) != B_OK
+				|| msg->FindInt32("change count", &changeCount) != B_OK
+				|| generation != fSearchGeneration || !fIndexing)
+				break;
+
+			// Too much of the text changed while indexing to patch the index
+			if (fIndexEdits.size() > kMaxIndexEdits) {
+				_StartMatchIndexer();
+				break;
+			}
+
+			_ApplyMatchIndex(*matches, changeCount);
+			if (Window() != nullptr)
+				Window()->PostMessage(M_UPDATE_STATUSBAR);
+			break;
+		}
 		case B_COLORS_UPDATED:
 			SetColorsFromTheme();
 			break;
@@ -301,3 +701,313 @@ UndoableTextView::SetColorsFromTheme()
 	SetHighColor(textColor);
 	SetFontAndColor(nullptr, B_FONT_ALL, &textColor);
 }
+
+
+// Returns the line index of the text. It is built on first use after the
+// text changed, and shared by all line based operations until the next edit.
+const LineIndex&
+UndoableTextView::Lines()
+{
+	if (fLineIndexChangeCount != fChangeCount) {
+		fLineIndex.SetTo(Text(), TextLength());
+		fLineIndexChangeCount = fChangeCount;
+	}
+	return fLineIndex;
+}
+
+
+// Sets the text whose occurrences are highlighted. The match index is built on
+// a background thread and afterwards kept up to date on every edit.
+void
+UndoableTextView::SetSearchTerm(const BString& find, bool caseSensitive, bool fullWordsOnly)
+{
+	if (find == fSearchTerm && caseSensitive == fSearchCaseSensitive
+		&& fullWordsOnly == fSearchFullWords)
+		return;
+
+	fSearchTerm = find;
+	fSearchCaseSensitive = caseSensitive;
+	fSearchFullWords = fullWordsOnly;
+	fSearchGeneration++;
+	fIndexing = false;
+	fIndexEdits.clear();
+
+	if (!fMatches.empty()) {
+		_InvalidateMatches();
+		fMatches.clear();
+	}
+
+	if (!fSearchTerm.IsEmpty())
+		_StartMatchIndexer();
+	else if (fMatchIndexer != nullptr)
+		fMatchIndexer->Cancel();
+}
+
+
+int32
+UndoableTextView::CurrentMatchIndex() const
+{
+	int32 start;
+	int32 end;
+	GetSelection(&start, &end);
+
+	auto it = std::lower_bound(fMatches.begin(), fMatches.end(), start,
+		[](const TextMatch& match, int32 offset) { return match.start < offset; });
+	if (it == fMatches.end() || it->start != start || it->end != end)
+		return -1;
+
+	return it - fMatches.begin();
+}
+
+
+// Selects the next (or previous) match after the current selection, wrapping
+// around at the end of the text.
+bool
+UndoableTextView::SelectNextMatch(bool forward)
+{
+	if (fMatches.empty())
+		return false;
+
+	int32 start;
+	int32 end;
+	GetSelection(&start, &end);
+
+	std::vector<TextMatch>::const_iterator it;
+	if (forward) {
+		it = std::lower_bound(fMatches.begin(), fMatches.end(), end,
+			[](const TextMatch& match, int32 offset) { return match.start < offset; });
+		if (it == fMatches.end())
+			it = fMatches.begin();
+	} else {
+		it = std::lower_bound(fMatches.begin(), fMatches.end(), start,
+			[](const TextMatch& match, int32 offset) { return match.start < offset; });
+		if (it == fMatches.begin())
+			it = fMatches.end();
+		--it;
+	}
+
+	Select(it->start, it->end);
+	ScrollToSelection();
+	return true;
+}
+
+
+void
+UndoableTextView::_StartMatchIndexer()
+{
+	if (fMatchIndexer == nullptr) {
+		fMatchIndexer = new MatchIndexer(this);
+		if (fMatchIndexer->InitCheck() != B_OK) {
+			delete fMatchIndexer;
+			fMatchIndexer = nullptr;
+			return;
+		}
+	}
+
+	// The indexer copies the text itself
+	MatchIndexerData* data = new MatchIndexerData;
+	data->find = fSearchTerm;
+	data->caseSensitive = fSearchCaseSensitive;
+	data->fullWordsOnly = fSearchFullWords;
+	data->generation = ++fSearchGeneration;
+
+	fIndexing = true;
+	fIndexEdits.clear();
+	fMatchIndexer->Request(data);
+}
+
+
+// Takes over an index built from the text as it was at the given change
+// count, and brings it up to date with the edits made since.
+void
+UndoableTextView::_ApplyMatchIndex(std::vector<TextMatch>& matches, int32 changeCount)
+{
+	_InvalidateMatches();
+	fMatches.swap(matches);
+	fIndexing = false;
+
+	// The ranges of the edits, each moved along by the edits after it
+	std::vector<std::pair<int32, int32>> ranges;
+	for (const IndexEdit& edit : fIndexEdits) {
+		// Made before the indexer copied the text
+		if (edit.changeCount <= changeCount)
+			continue;
+
+		_ShiftMatches(edit.offset, edit.removedLength, edit.insertedLength);
+
+		int32 removedEnd = edit.offset + edit.removedLength;
+		int32 delta = edit.insertedLength - edit.removedLength;
+		for (std::pair<int32, int32>& range : ranges) {
+			if (range.first >= removedEnd)
+				range.first += delta;
+			else if (range.first > edit.offset)
+				range.first = edit.offset;
+			if (range.second >= removedEnd)
+				range.second += delta;
+			else if (range.second > edit.offset)
+				range.second = edit.offset + edit.insertedLength;
+		}
+		ranges.push_back(std::make_pair(edit.offset, edit.offset + edit.insertedLength));
+	}
+	fIndexEdits.clear();
+
+	for (const std::pair<int32, int32>& range : ranges)
+		_SearchAround(range.first, range.second);
+	_InvalidateMatches();
+}
+
+
+// Keeps the match index valid after an edit: matches behind the edit are
+// shifted, and only a small window around the edit is searched again. Large
+// insertions, as when a document is loaded or pasted, are indexed anew on the
+// indexer thread instead.
+void
+UndoableTextView::_PatchMatches(int32 offset, int32 removedLength, int32 insertedLength)
+{
+	if (fSearchTerm.IsEmpty())
+		return;
+
+	_ShiftMatches(offset, removedLength, insertedLength);
+	if (insertedLength > kMaxPatchLength) {
+		_StartMatchIndexer();
+		return;
+	}
+
+	if (fIndexing && fIndexEdits.size() <= kMaxIndexEdits)
+		fIndexEdits.push_back({ offset, removedLength, insertedLength, fChangeCount });
+
+	_SearchAround(offset, offset + insertedLength);
+}
+
+
+// Drops the matches touched by an edit and moves the ones behind it
+void
+UndoableTextView::_ShiftMatches(int32 offset, int32 removedLength, int32 insertedLength)
+{
+	int32 delta = insertedLength - removedLength;
+	int32 editEnd = offset + removedLength;
+
+	auto firstAffected = std::lower_bound(fMatches.begin(), fMatches.end(), offset,
+		[](const TextMatch& match, int32 value) { return match.end <= value; });
+	auto firstBehind = firstAffected;
+	while (firstBehind != fMatches.end() && firstBehind->start < editEnd)
+		++firstBehind;
+	for (auto it = firstBehind; it != fMatches.end(); ++it) {
+		it->start += delta;
+		it->end += delta;
+	}
+	fMatches.erase(firstAffected, firstBehind);
+}
+
+
+// Searches again around the edited range, where matches may have appeared or
+// where full word boundaries may have changed. Folding may change byte
+// lengths, so the window is generous.
+void
+UndoableTextView::_SearchAround(int32 start, int32 end)
+{
+	int32 textLength = TextLength();
+	int32 context = fSearchTerm.Length() * 4 + 4;
+	int32 windowStart = std::max((int32)0, start - context);
+	int32 windowEnd = std::min(textLength, end + context);
+
+	auto first = std::lower_bound(fMatches.begin(), fMatches.end(), windowStart,
+		[](const TextMatch& match, int32 value) { return match.end <= value; });
+	auto last = first;
+	while (last != fMatches.end() && last->start < windowEnd)
+		++last;
+	if (first != last) {
+		windowStart = std::min(windowStart, first->start);
+		windowEnd = std::max(windowEnd, (last - 1)->end);
+	}
+
+	// Copy the window with a few bytes of surrounding context, so that word
+	// boundaries at its edges can be checked. GetText() copies only the range
+	// and leaves the text buffer alone.
+	int32 copyStart = std::max((int32)0, windowStart - 4);
+	int32 copyEnd = std::min(textLength, windowEnd + 4);
+	std::vector<char> buffer(copyEnd - copyStart + 1);
+	GetText(copyStart, copyEnd - copyStart, buffer.data());
+
+	std::vector<TextMatch> found;
+	FindAllMatches(buffer.data() + windowStart - copyStart, windowEnd - windowStart, fSearchTerm,
+		fSearchCaseSensitive, false, found);
+
+	std::vector<TextMatch> patched;
+	for (TextMatch match : found) {
+		match.start += windowStart - copyStart;
+		match.end += windowStart - copyStart;
+		if (fSearchFullWords
+			&& !IsFullWord(buffer.data(), copyEnd - copyStart, match.start, match.end))
+			continue;
+
+		patched.push_back({ match.start + copyStart, match.end + copyStart });
+	}
+
+	first = fMatches.erase(first, last);
+	fMatches.insert(first, patched.begin(), patched.end());
+
+	// Matches dropped or found by the edit all lie in the window
+	_InvalidateRange(windowStart, windowEnd);
+}
+
+
+void
+UndoableTextView::_InvalidateRange(int32 start, int32 end)
+{
+	if (start >= end || Window() == nullptr)
+		return;
+
+	BRegion region;
+	GetTextRegion(start, end, &region);
+	Invalidate(region.Frame());
+}
+
+
+// Redraws the visible lines that have matches
+void
+UndoableTextView::_InvalidateMatches()
+{
+	BRect bounds = Bounds();
+	int32 firstOffset = OffsetAt(bounds.LeftTop());
+	int32 lastOffset = OffsetAt(bounds.RightBottom());
+
+	auto first = std::lower_bound(fMatches.begin(), fMatches.end(), firstOffset,
+		[](const TextMatch& match, int32 offset) { return match.end <= offset; });
+	auto last = first;
+	while (last != fMatches.end() && last->start <= lastOffset)
+		++last;
+	if (first != last)
+		_InvalidateRange(first->start, (last - 1)->end);
+}
+
+
+// Highlights the matches in the visible part of the text only.
+void
+UndoableTextView::_DrawMatches(BRect updateRect)
+{
+	int32 firstOffset = OffsetAt(updateRect.LeftTop());
+	int32 lastOffset = OffsetAt(updateRect.RightBottom());
+
+	auto it = std::lower_bound(fMatches.begin(), fMatches.end(), firstOffset,
+		[](const TextMatch& match, int32 offset) { return match.end <= offset; });
+
+	BRegion region;
+	for (; it != fMatches.end() && it->start <= lastOffset; ++it) {
+		BRegion matchRegion;
+		GetTextRegion(it->start, it->end, &matchRegion);
+		region.Include(&matchRegion);
+	}
+
+	if (region.CountRects() == 0)
+		return;
+
+	PushState();
+
+	SetDrawingMode(B_OP_BLEND);
+	SetHighColor(kMatchHighlightColor);
+
+	FillRegion(&region);
+
+	PopState();
+}
@@ -5,14 +5,32 @@
 #ifndef UNDOABLE_TEXT_VIEW_H
 #define UNDOABLE_TEXT_VIEW_H
 
+#include "LineIndex.h"
+#include "TextSearch.h"
+
 #include <MessageRunner.h>
 #include <TextView.h>
-#include <stack>
+#include <deque>
+#include <vector>
+
+class MatchIndexer;
+class SessionJournal;
+
+// One edit: "removed" was replaced by "inserted" at offset
+struct TextEdit {
+	int32 offset;
+	BString removed;
+	BString inserted;
+};
 
-struct TextSnapshot {
-	BString text;
+// The edits undone and redone as one step, with the selection from before
+// and after them
+struct UndoGroup {
+	std::vector<TextEdit> edits;
 	int32 selectionStart;
 	int32 selectionEnd;
+	int32 redoSelectionStart;
+	int32 redoSelectionEnd;
 };
 
 class UndoableTextView : public BTextView {
@@ -33,33 +51,83 @@ public:
 	void SetColorsFromTheme();
 
 	void SetTextWithUndo(const BString& newText);
+	void LoadText(const char* text, int32 length, const text_run_array* runs = nullptr);
 	void Undo();
 	void Redo();
 	void ClearHistory();
+	void BeginUndoGroup();
+	void EndUndoGroup();
 
 	bool CanUndo() const { return !fUndoStack.empty(); }
 	bool CanRedo() const { return !fRedoStack.empty(); }
 
+	void SetSearchTerm(const BString& find, bool caseSensitive, bool fullWordsOnly);
+	int32 CountMatches() const { return (int32)fMatches.size(); }
+	int32 CurrentMatchIndex() const;
+	bool SelectNextMatch(bool forward);
+
+	int32 ChangeCount() const { return fChangeCount; }
+	const LineIndex& Lines();
+
+	// Edits are passed on to the journal, if there is one
+	void SetJournal(SessionJournal* journal) { fJournal = journal; }
+
 private:
-	void PushUndoSnapshot();
+	void _RecordEdit(int32 offset, const char* removed, int32 removedLength,
+		const char* inserted, int32 insertedLength);
+	void _ApplyGroup(const UndoGroup& group, bool undo);
 	void StartCoalesceTimer();
 	void StopCoalesceTimer();
 
 	static const bigtime_t kCoalesceDelay = 1500000; // 1.5 seconds
 	static const size_t kMaxUndoSteps = 100;
 
-	std::stack<TextSnapshot> fUndoStack;
-	std::stack<TextSnapshot> fRedoStack;
+	std::deque<UndoGroup> fUndoStack;
+	std::vector<UndoGroup> fRedoStack;
 
 	bool fCoalescing;
 	bool fRecording;
+	int32 fGroupDepth;
+	bool fGroupStarted;
 
 	void _DrawInactiveSelection();
 	void _InvalidateSelection();
 
+	// An edit made while the match index was being built
+	struct IndexEdit {
+		int32 offset;
+		int32 removedLength;
+		int32 insertedLength;
+		int32 changeCount;
+	};
+
+	void _StartMatchIndexer();
+	void _ApplyMatchIndex(std::vector<TextMatch>& matches, int32 changeCount);
+	void _PatchMatches(int32 offset, int32 removedLength, int32 insertedLength);
+	void _ShiftMatches(int32 offset, int32 removedLength, int32 insertedLength);
+	void _SearchAround(int32 start, int32 end);
+	void _InvalidateRange(int32 start, int32 end);
+	void _InvalidateMatches();
+	void _DrawMatches(BRect updateRect);
+
 	bool fHasFocus;
 	int32 fSavedSelectionStart;
 	int32 fSavedSelectionEnd;
+
+	BString fSearchTerm;
+	bool fSearchCaseSensitive;
+	bool fSearchFullWords;
+	int32 fSearchGeneration;
+	std::vector<TextMatch> fMatches;
+	MatchIndexer* fMatchIndexer;
+	bool fIndexing;
+	std::vector<IndexEdit> fIndexEdits;
+	int32 fChangeCount;
+
+	LineIndex fLineIndex;
+	int32 fLineIndexChangeCount;
+
+	SessionJournal* fJournal;
 };
 
 
@@ -0,0 +1,269 @@
+/*
+ * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+// Randomized checks of the fast paths against slow references that are easy
+// to trust. The texts are generated from fixed seeds, so a failure can be
+// reproduced. Whether the SSE2 or the scalar code is checked depends on the
+// target the checks are built for.
+//
+// Usage: TextChecks [entity cases]
+// The entity cases are written by entity_cases.py.
+
+#include "HtmlEntities.h"
+#include "TextEncoding.h"
+#include "TextStats.h"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unicode/brkiter.h>
+#include <unicode/locid.h>
+#include <unicode/uchar.h>
+#include <unicode/unistr.h>
+#include <unicode/utf8.h>
+#include <vector>
+
+static const int32 kRandomTexts = 100000;
+static const int32 kMaxReports = 5;
+
+
+static void
+_Print(const std::string& text)
+{
+	for (unsigned char c : text) {
+		if (c < 0x20 || c >= 0x7f)
+			printf("\\x%02x", c);
+		else
+			putchar(c);
+	}
+}
+
+
+//	#pragma mark - Word counts
+
+
+// Counts the words as ICU splits them: every piece that is not white space
+static int64
+_ReferenceWordCount(icu::BreakIterator* iterator, const std::string& text)
+{
+	icu::UnicodeString unicode = icu::UnicodeString::fromUTF8(text);
+	iterator->setText(unicode);
+
+	int64 words = 0;
+	int32 start = iterator->first();
+	for (int32 end = iterator->next(); end != icu::BreakIterator::DONE;
+		start = end, end = iterator->next()) {
+		icu::UnicodeString word = unicode.tempSubStringBetween(start, end);
+		if (word.trim().length() > 0 && u_charType(word.char32At(0)) != U_SPACE_SEPARATOR)
+			words++;
+	}
+	return words;
+}
+
+
+static int32
+_CheckWordCounts()
+{
+	static const char* kASCII[] = { "Hello", "world", "a", "B", "3", "42", "_", "__", ".", ",",
+		";", ":", "'", "\"", " ", "  ", "\t", "\n", "\r\n", "\r", "\v", "\f", "\x1c", "\x01",
+		"\x7f", "!", "?", "-", "(", ")", "e.g", "3.14", "1,000", "don't", "x_y", "@", "#", "/",
+		"\\", "`", "~", "[", "]", "{", "}", "|", "+", "=", "*", "&", "^", "%", "$", "<", ">" };
+	static const char* kUnicode[] = { "D\xc3\xa9j\xc3\xa0", "\xc3\x89""COLE", "\xc3\x9f",
+		"\xef\xac\x81", "\xe2\x80\x99", "\xe2\x80\x98", "\xc2\xab", "\xc2\xbb", "\xc2\xa0",
+		"\xe2\x80\x83", "\xe2\x80\xa8", "\xc2\x85", "\xc2\xb7", "\xef\xbc\x9a", "\xef\xb9\x95",
+		"\xe2\x80\x94", "\xe2\x80\xa6", "\xe2\x82\xac", "\xd9\xa3",
+		"\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82", "\xce\xa9\xce\xbc\xce\xad",
+		"\xe2\x80\xaf", "\xe3\x80\x80", "\xcc\x81", "\xe2\x80\x8b", "\xc2\xad",
+		"\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e", "\xe3\x83\x86\xe3\x82\xb9\xe3\x83\x88",
+		"\xe0\xb8\xa0\xe0\xb8\xb2\xe0\xb8\xa9\xe0\xb8\xb2", "\xd7\xa9\xd7\x9c\xd7\x95\xd7\x9d",
+		"\xf0\x9f\x98\x80", "\xe2\x80\x8d", "\xf0\x9f\x87\xb3\xf0\x9f\x87\xb4", "\x80", "\xc3",
+		"\xe2\x82", "\xff", "\xed\x95\x9c\xea\xb5\xad\xec\x96\xb4", "\xef\xbc\x91\xef\xbc\x92",
+		"\xef\xbd\x81\xef\xbd\x82", "\xef\xbc\x8e", "\xef\xbc\x8c" };
+
+	UErrorCode status = U_ZERO_ERROR;
+	std::unique_ptr<icu::BreakIterator> iterator(
+		icu::BreakIterator::createWordInstance(icu::Locale::getDefault(), status));
+	if (U_FAILURE(status)) {
+		printf("word counts: no word break iterator\n");
+		return 1;
+	}
+
+	std::mt19937 random(11);
+	int32 failures = 0;
+	for (int32 i = 0; i < kRandomTexts; i++) {
+		// Pure ASCII, a little beyond ASCII, and mostly beyond ASCII
+		int32 unicodeRate = i % 3 == 0 ? 0 : i % 3 == 1 ? 5 : 50;
+		std::string text;
+		for (int32 count = random() % 30; count > 0; count--) {
+			if ((int32)(random() % 100) < unicodeRate)
+				text += kUnicode[random() % B_COUNT_OF(kUnicode)];
+			else
+				text += kASCII[random() % B_COUNT_OF(kASCII)];
+		}
+
+		int64 expected = _ReferenceWordCount(iterator.get(), text);
+		int64 counted = CountTextWords(text.data(), text.length());
+		if (counted != expected && failures++ < kMaxReports) {
+			printf("word counts: %" B_PRId64 " instead of %" B_PRId64 " in \"", counted,
+				expected);
+			_Print(text);
+			printf("\"\n");
+		}
+	}
+
+	printf("word counts: %" B_PRId32 " texts, %" B_PRId32 " mismatches\n", kRandomTexts,
+		failures);
+	return failures;
+}
+
+
+//	#pragma mark - Text scans
+
+
+// Decodes one character at a time with ICU, which takes the same maximal
+// subparts of invalid sequences as TextScanner
+static TextScan
+_ReferenceScan(const std::string& text)
+{
+	TextScan scan;
+	scan.length = text.length();
+	const uint8* bytes = (const uint8*)text.data();
+	int32 length = text.length();
+	for (int32 i = 0; i < length;) {
+		int32 start = i;
+		UChar32 c;
+		U8_NEXT(bytes, i, length, c);
+		if (c < 0) {
+			if (scan.firstInvalid < 0)
+				scan.firstInvalid = start;
+			scan.invalidSequences++;
+		} else if (c == '\n')
+			scan.lineFeeds++;
+		else if (c == '\r') {
+			scan.carriageReturns++;
+			if (i < length && bytes[i] == '\n')
+				scan.crlfPairs++;
+		} else if (c == 0)
+			scan.nulBytes++;
+		else if ((c < 0x20 && (c < '\t' || c > '\r') && c != 0x1b) || c == 0x7f)
+			scan.controlBytes++;
+	}
+	return scan;
+}
+
+
+static bool
+_SameScan(const TextScan& a, const TextScan& b)
+{
+	return a.length == b.length && a.invalidSequences == b.invalidSequences
+		&& a.firstInvalid == b.firstInvalid && a.nulBytes == b.nulBytes
+		&& a.controlBytes == b.controlBytes && a.lineFeeds == b.lineFeeds
+		&& a.carriageReturns == b.carriageReturns && a.crlfPairs == b.crlfPairs;
+}
+
+
+static int32
+_CheckTextScans()
+{
+	// Valid and invalid characters, overlong forms, surrogates and code points
+	// beyond U+10FFFF, and runs long enough to fill whole SSE2 chunks
+	static const char* kPieces[] = { "a", "b ", "\n", "\r\n", "\r", "\xc3\xa9", "\xe2\x82\xac",
+		"\xf0\x9f\x98\x80", "\x80", "\xc3", "\xe2\x82", "\xed\xa0\x80", "\xf4\x90\x80\x80", "\x01",
+		"\x7f", "\x1b", "\t", "\xc0\xaf", "\xe0\x80\x80", "abcdefghijklmnopqrstuvwxyz0123" };
+
+	std::mt19937 random(7);
+	int32 failures = 0;
+	for (int32 i = 0; i < kRandomTexts; i++) {
+		std::string text;
+		for (int32 count = random() % 40; count > 0; count--) {
+			// One in 21 is a zero byte
+			uint32 piece = random() % (B_COUNT_OF(kPieces) + 1);
+			if (piece == B_COUNT_OF(kPieces))
+				text += '\0';
+			else
+				text += kPieces[piece];
+		}
+		TextScan expected = _ReferenceScan(text);
+
+		TextScanner whole;
+		whole.Add(text.data(), text.length());
+		bool same = _SameScan(whole.Result(), expected);
+
+		// Blocks have to end where a character starts, which only valid text
+		// is sure to do
+		if (same && expected.invalidSequences == 0) {
+			TextScanner blocks;
+			for (size_t offset = 0; offset < text.length();) {
+				size_t end = CharacterBoundary(text.data(), text.length(),
+					offset + 1 + random() % 50);
+				if (end <= offset) {
+					// The rest of the character the block would have ended in
+					end = offset + 1;
+					while (end < text.length() && ((uint8)text[end] & 0xc0) == 0x80)
+						end++;
+				}
+				blocks.Add(text.data() + offset, end - offset);
+				offset = end;
+			}
+			same = _SameScan(blocks.Result(), expected);
+		}
+
+		if (!same && failures++ < kMaxReports) {
+			printf("text scans: mismatch in \"");
+			_Print(text);
+			printf("\"\n");
+		}
+	}
+
+	printf("text scans: %" B_PRId32 " texts, %" B_PRId32 " mismatches\n", kRandomTexts,
+		failures);
+	return failures;
+}
+
+
+//	#pragma mark - HTML entities
+
+
+// Reads pairs of input and the expected output, each ended by a zero byte
+static int32
+_CheckEntities(const char* path)
+{
+	std::ifstream cases(path, std::ios::binary);
+	if (!cases) {
+		printf("HTML entities: could not read %s\n", path);
+		return 1;
+	}
+
+	int32 count = 0;
+	int32 failures = 0;
+	std::string input;
+	std::string expected;
+	while (std::getline(cases, input, '\0') && std::getline(cases, expected, '\0')) {
+		std::vector<char> output(HtmlDecodedMaxLength(input.length()));
+		size_t length = HtmlDecode(input.data(), input.length(), output.data());
+		if (std::string(output.data(), length) != expected && failures++ < kMaxReports) {
+			printf("HTML entities: \"%s\" decoded to \"%.*s\" instead of \"%s\"\n",
+				input.c_str(), (int)length, output.data(), expected.c_str());
+		}
+		count++;
+	}
+
+	printf("HTML entities: %" B_PRId32 " texts, %" B_PRId32 " mismatches\n", count, failures);
+	return failures;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 failures = _CheckWordCounts();
+	failures += _CheckTextScans();
+	if (argc > 1)
+		failures += _CheckEntities(argv[1]);
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+#
+# Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+# All rights reserved. Distributed under the terms of the MIT license.
+#
+# Writes random texts with named, legacy, truncated and numeric character
+# references, each followed by what Python's html.unescape() makes of it.
+# Both end with a zero byte. The seed is fixed, so the cases stay the same.
+#
+# Usage: tests/entity_cases.py > entity_cases
+
+import html
+import random
+import sys
+from html.entities import html5
+
+CASES = 3000
+
+
+def random_case(names):
+	parts = []
+	for _ in range(random.randint(0, 8)):
+		r = random.random()
+		if r < 0.4:
+			parts.append('&' + random.choice(names))
+		elif r < 0.5:
+			# A name cut short or continued
+			parts.append('&' + random.choice(names)[:-1] + random.choice('abz;'))
+		elif r < 0.6:
+			value = random.choice([0, 9, 65, 128, 150, 159, 0xD800, 0x10FFFD, 0x110000,
+				99999999999, 233])
+			parts.append('&#' + str(value) + random.choice(['', ';', 'a']))
+		elif r < 0.7:
+			value = random.choice([0x41, 0x80, 0x2022, 0x1F600])
+			parts.append('&#x' + format(value, 'x') + random.choice(['', ';']))
+		elif r < 0.75:
+			parts.append('&#;&#x;&')
+		else:
+			parts.append(random.choice(['abc', ' ', 'é', '&', ';', 'x&amp', '&ampx']))
+	return ''.join(parts)
+
+
+def main():
+	random.seed(4)
+	names = list(html5)
+	out = sys.stdout.buffer
+	for _ in range(CASES):
+		case = random_case(names)
+		# Lone surrogates from numeric references are written as they are
+		for text in (case, html.unescape(case)):
+			out.write(text.encode('utf-8', 'surrogatepass') + b'\0')
+
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+#
+# Copyright 2025, Johan Wagenheim <johan@dospuntos.no>
+# All rights reserved. Distributed under the terms of the MIT license.
+#
+# Generates HtmlEntityTrie.h from the WHATWG named character references,
+# as shipped with Python in html.entities.html5.
+#
+# Usage: tools/generate_entity_trie.py > HtmlEntityTrie.h
+
+from collections import deque
+from html.entities import html5
+
+
+def build_trie(entities):
+	children = [{}]
+	values = [None]
+	for name, value in entities.items():
+		node = 0
+		for c in name:
+			if c not in children[node]:
+				children.append({})
+				values.append(None)
+				children[node][c] = len(children) - 1
+			node = children[node][c]
+		values[node] = value
+
+	# Number the nodes breadth first, so the edges of a node are contiguous
+	order = []
+	queue = deque([0])
+	while queue:
+		node = queue.popleft()
+		order.append(node)
+		for c in sorted(children[node]):
+			queue.append(children[node][c])
+	number = {node: i for i, node in enumerate(order)}
+
+	first_edge = []
+	labels = []
+	targets = []
+	node_values = []
+	codepoints = [(0, 0)]
+	value_index = {}
+	for node in order:
+		first_edge.append(len(labels))
+		for c in sorted(children[node]):
+			labels.append(c)
+			targets.append(number[children[node][c]])
+		value = values[node]
+		if value is None:
+			node_values.append(0)
+			continue
+		pair = tuple(ord(c) for c in value) + (0,) * (2 - len(value))
+		if pair not in value_index:
+			value_index[pair] = len(codepoints)
+			codepoints.append(pair)
+		node_values.append(value_index[pair])
+	first_edge.append(len(labels))
+
+	return first_edge, node_values, labels, targets, codepoints
+
+
+def format_list(items, per_line):
+	lines = []
+	for i in range(0, len(items), per_line):
+		lines.append("\t" + ", ".join(items[i:i + per_line]) + ",")
+	return "\n".join(lines)
+
+
+def main():
+	first_edge, node_values, labels, targets, codepoints = build_trie(html5)
+	assert len(first_edge) < 65536 and len(codepoints) < 65536
+
+	print("/*")
+	print(" * Copyright 2025, Johan Wagenheim <johan@dospuntos.no>")
+	print(" * All rights reserved. Distributed under the terms of the MIT license.")
+	print(" *")
+	print(" * Generated by tools/generate_entity_trie.py from the %d WHATWG named"
+		% len(html5))
+	print(" * character references. Do not edit.")
+	print(" */")
+	print("#ifndef HTML_ENTITY_TRIE_H")
+	print("#define HTML_ENTITY_TRIE_H")
+	print()
+	print("#include <SupportDefs.h>")
+	print()
+	print("// Nodes are numbered breadth first, node 0 is the root. The edges of node n")
+	print("// are kEntityTrieLabels[kEntityTrieFirstEdge[n] .. kEntityTrieFirstEdge[n + 1]],")
+	print("// sorted by label. Names ending in ';' and the legacy names without it are")
+	print("// both in the trie, so the longest match decides.")
+	print("static const int32 kEntityTrieNodeCount = %d;" % (len(first_edge) - 1))
+	print()
+	print("static const uint16 kEntityTrieFirstEdge[] = {")
+	print(format_list([str(v) for v in first_edge], 12))
+	print("};")
+	print()
+	print("// Index into kEntityTrieCodepoints for nodes that end a name, 0 otherwise")
+	print("static const uint16 kEntityTrieValues[] = {")
+	print(format_list([str(v) for v in node_values], 12))
+	print("};")
+	print()
+	print("static const char kEntityTrieLabels[] = {")
+	print(format_list(["'%s'" % c for c in labels], 16))
+	print("};")
+	print()
+	print("static const uint16 kEntityTrieTargets[] = {")
+	print(format_list([str(v) for v in targets], 12))
+	print("};")
+	print()
+	print("// Some references expand to two code points, the second one is 0 otherwise")
+	print("static const uint32 kEntityTrieCodepoints[][2] = {")
+	print(format_list(["{ %d, %d }" % pair for pair in codepoints], 6))
+	print("};")
+	print()
+	print("#endif // HTML_ENTITY_TRIE_H")
+
+
+if __name__ == "__main__":
+	main()